@@ -0,0 +1,71 @@
+#include <Arduino.h>
+#include <SPI.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+namespace {
+const auto processStart = std::chrono::steady_clock::now();
+}
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+void delay(const unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+void yield() { std::this_thread::yield(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  thread_local char task;
+  return &task;
+}
+
+size_t Print::print(const String& str) { return write(str.c_str(), str.length()); }
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuffer[256];
+  va_list args;
+  va_start(args, format);
+  va_list copy;
+  va_copy(copy, args);
+  const int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+  va_end(args);
+  if (length < 0) {
+    va_end(copy);
+    return 0;
+  }
+  if (static_cast<size_t>(length) < sizeof(stackBuffer)) {
+    va_end(copy);
+    return write(reinterpret_cast<const uint8_t*>(stackBuffer), length);
+  }
+  std::vector<char> heapBuffer(length + 1);
+  vsnprintf(heapBuffer.data(), heapBuffer.size(), format, copy);
+  va_end(copy);
+  return write(reinterpret_cast<const uint8_t*>(heapBuffer.data()), length);
+}
+
+size_t HardwareSerial::write(const uint8_t c) {
+  if (!enabled) {
+    return 1;
+  }
+  return fputc(c, stderr) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, const size_t size) {
+  if (!enabled) {
+    return size;
+  }
+  return fwrite(buffer, 1, size, stderr);
+}
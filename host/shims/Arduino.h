@@ -0,0 +1,39 @@
+#pragma once
+// Host stand-in for the Arduino core, just enough for the libraries under lib/ to build and run on a PC
+
+#include <HardwareSerial.h>
+#include <Print.h>
+#include <WString.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+
+using std::max;
+using std::min;
+
+// Milliseconds and microseconds since the process started
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+// No PSRAM on the host, allocations come from the regular heap
+inline void* ps_malloc(const size_t size) { return malloc(size); }
+
+// The FreeRTOS calls the libraries make. Each host thread stands in for a task, all running on core 0.
+using TaskHandle_t = void*;
+TaskHandle_t xTaskGetCurrentTaskHandle();
+inline int xPortGetCoreID() { return 0; }
@@ -0,0 +1,121 @@
+#include <HalDisplay.h>
+
+#include <cstdio>
+#include <cstring>
+
+HalDisplay::HalDisplay()
+    : frameBuffer(BUFFER_SIZE, 0xFF),
+      grayFrameBuffer(GRAY_BUFFER_SIZE, 0xFF),
+      grayscaleLsbBuffer(BUFFER_SIZE, 0xFF),
+      grayscaleMsbBuffer(BUFFER_SIZE, 0xFF) {}
+
+HalDisplay::~HalDisplay() = default;
+
+void HalDisplay::begin() { clearScreen(0xFF); }
+
+void HalDisplay::clearScreen(const uint8_t color) const { memset(frameBuffer.data(), color, BUFFER_SIZE); }
+
+void HalDisplay::drawImage(const uint8_t* imageData, const uint16_t x, const uint16_t y, const uint16_t w,
+                           const uint16_t h, bool) const {
+  if (!imageData) {
+    return;
+  }
+  const uint16_t imageWidthBytes = w / 8;
+  for (uint16_t row = 0; row < h && y + row < DISPLAY_HEIGHT; row++) {
+    for (uint16_t col = 0; col < imageWidthBytes && x / 8 + col < DISPLAY_WIDTH_BYTES; col++) {
+      frameBuffer[(y + row) * DISPLAY_WIDTH_BYTES + x / 8 + col] = imageData[row * imageWidthBytes + col];
+    }
+  }
+}
+
+void HalDisplay::displayBuffer(RefreshMode) { displayCount++; }
+
+void HalDisplay::displayWindow(uint16_t, uint16_t, uint16_t, uint16_t) { displayCount++; }
+
+void HalDisplay::refreshDisplay(const RefreshMode mode, bool) { displayBuffer(mode); }
+
+void HalDisplay::deepSleep() {}
+
+uint8_t* HalDisplay::getFrameBuffer() const { return frameBuffer.data(); }
+
+void HalDisplay::copyGrayscaleBuffers(const uint8_t* lsbBuffer, const uint8_t* msbBuffer) {
+  copyGrayscaleLsbBuffers(lsbBuffer);
+  copyGrayscaleMsbBuffers(msbBuffer);
+}
+
+void HalDisplay::copyGrayscaleLsbBuffers(const uint8_t* lsbBuffer) {
+  memcpy(grayscaleLsbBuffer.data(), lsbBuffer, BUFFER_SIZE);
+}
+
+void HalDisplay::copyGrayscaleMsbBuffers(const uint8_t* msbBuffer) {
+  memcpy(grayscaleMsbBuffer.data(), msbBuffer, BUFFER_SIZE);
+}
+
+void HalDisplay::cleanupGrayscaleBuffers(const uint8_t*) {}
+
+void HalDisplay::displayGrayBuffer() { displayBuffer(FAST_REFRESH); }
+
+uint8_t* HalDisplay::getGrayFrameBuffer() { return grayFrameBuffer.data(); }
+
+void HalDisplay::clearGrayFrameBuffer(const uint8_t color) {
+  memset(grayFrameBuffer.data(), color, GRAY_BUFFER_SIZE);
+}
+
+void HalDisplay::displayGrayFrameBuffer(const RefreshMode mode) {
+  displayBuffer(mode);
+  // Same 4bpp -> 1bpp fold as the panel adapter path, so BW overlays drawn next start from this page
+  for (uint32_t i = 0; i < BUFFER_SIZE; i++) {
+    const uint8_t* src = grayFrameBuffer.data() + i * 4;
+    uint8_t bits = 0;
+    for (int j = 0; j < 4; j++) {
+      bits <<= 2;
+      bits |= ((src[j] & 0x80) ? 0x02 : 0x00) | ((src[j] & 0x08) ? 0x01 : 0x00);
+    }
+    frameBuffer[i] = bits;
+  }
+}
+
+// Portrait x runs down the panel from its bottom edge and portrait y along it, see GfxRenderer::rotateCoordinates
+bool HalDisplay::saveBufferAsPBM(const uint8_t* buffer, const char* filename) {
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  constexpr int outWidth = DISPLAY_HEIGHT;
+  constexpr int outHeight = DISPLAY_WIDTH;
+  constexpr int outWidthBytes = (outWidth + 7) / 8;
+  fprintf(file, "P4\n%d %d\n", outWidth, outHeight);
+  std::vector<uint8_t> row(outWidthBytes);
+  for (int outY = 0; outY < outHeight; outY++) {
+    std::fill(row.begin(), row.end(), 0);
+    for (int outX = 0; outX < outWidth; outX++) {
+      const int panelY = DISPLAY_HEIGHT - 1 - outX;
+      const bool white = (buffer[panelY * DISPLAY_WIDTH_BYTES + outY / 8] >> (7 - (outY % 8))) & 1;
+      if (!white) {  // e-ink white = 1, PBM black = 1
+        row[outX / 8] |= 1 << (7 - (outX % 8));
+      }
+    }
+    fwrite(row.data(), 1, row.size(), file);
+  }
+  return fclose(file) == 0;
+}
+
+bool HalDisplay::saveGrayBufferAsPGM(const uint8_t* buffer, const char* filename) {
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  constexpr int outWidth = DISPLAY_HEIGHT;
+  constexpr int outHeight = DISPLAY_WIDTH;
+  fprintf(file, "P5\n%d %d\n15\n", outWidth, outHeight);
+  std::vector<uint8_t> row(outWidth);
+  for (int outY = 0; outY < outHeight; outY++) {
+    for (int outX = 0; outX < outWidth; outX++) {
+      const uint32_t pixel = static_cast<uint32_t>(DISPLAY_HEIGHT - 1 - outX) * DISPLAY_WIDTH + outY;
+      const uint8_t byte = buffer[pixel / 2];
+      row[outX] = (pixel % 2 == 0) ? byte >> 4 : byte & 0x0F;
+    }
+    fwrite(row.data(), 1, row.size(), file);
+  }
+  return fclose(file) == 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+// Host stand-in for lib/hal/HalDisplay: the same interface over in-memory 1bpp and 4bpp frame buffers.
+// The host build uses the M5 panel geometry, matching the primary m5papers3 target.
+#include <Arduino.h>
+
+#include <vector>
+
+class HalDisplay {
+ public:
+  HalDisplay();
+  ~HalDisplay();
+
+  enum RefreshMode { FULL_REFRESH, HALF_REFRESH, FAST_REFRESH };
+
+  void begin();
+
+  static constexpr uint16_t DISPLAY_WIDTH = 960;
+  static constexpr uint16_t DISPLAY_HEIGHT = 540;
+  static constexpr uint16_t DISPLAY_WIDTH_BYTES = DISPLAY_WIDTH / 8;
+  static constexpr uint32_t BUFFER_SIZE = DISPLAY_WIDTH_BYTES * DISPLAY_HEIGHT;
+
+  void clearScreen(uint8_t color = 0xFF) const;
+  void drawImage(const uint8_t* imageData, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                 bool fromProgmem = false) const;
+
+  void displayBuffer(RefreshMode mode = RefreshMode::FAST_REFRESH);
+  void displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+  void refreshDisplay(RefreshMode mode = RefreshMode::FAST_REFRESH, bool turnOffScreen = false);
+
+  void deepSleep();
+
+  uint8_t* getFrameBuffer() const;
+
+  void copyGrayscaleBuffers(const uint8_t* lsbBuffer, const uint8_t* msbBuffer);
+  void copyGrayscaleLsbBuffers(const uint8_t* lsbBuffer);
+  void copyGrayscaleMsbBuffers(const uint8_t* msbBuffer);
+  void cleanupGrayscaleBuffers(const uint8_t* bwBuffer);
+
+  void displayGrayBuffer();
+
+  static constexpr uint32_t GRAY_BUFFER_SIZE = DISPLAY_WIDTH * DISPLAY_HEIGHT / 2;
+  uint8_t* getGrayFrameBuffer();
+  void clearGrayFrameBuffer(uint8_t color = 0xFF);
+  void displayGrayFrameBuffer(RefreshMode mode = RefreshMode::FAST_REFRESH);
+
+  // Host only: how many times a frame was pushed to the "panel"
+  uint32_t getDisplayCount() const { return displayCount; }
+  // Host only: the planes last handed to copyGrayscale*Buffers, all white until then
+  const uint8_t* getGrayscaleLsbBuffer() const { return grayscaleLsbBuffer.data(); }
+  const uint8_t* getGrayscaleMsbBuffer() const { return grayscaleMsbBuffer.data(); }
+  // Host only: writes a buffer as a portrait image (the panel turned like GfxRenderer::Portrait), black = ink.
+  // 1bpp buffers (frame buffer, LSB/MSB planes) go out as binary PBM, the 4bpp gray buffer as 16-level PGM.
+  static bool saveBufferAsPBM(const uint8_t* buffer, const char* filename);
+  static bool saveGrayBufferAsPGM(const uint8_t* buffer, const char* filename);
+  bool saveFrameBufferAsPBM(const char* filename) const { return saveBufferAsPBM(frameBuffer.data(), filename); }
+
+ private:
+  mutable std::vector<uint8_t> frameBuffer;
+  std::vector<uint8_t> grayFrameBuffer;
+  std::vector<uint8_t> grayscaleLsbBuffer;
+  std::vector<uint8_t> grayscaleMsbBuffer;
+  uint32_t displayCount = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+class String;
+
+// Byte sink with the write/print surface of the Arduino core's Print
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      if (!write(*buffer++)) break;
+      n++;
+    }
+    return n;
+  }
+  size_t write(const char* str) { return str ? write(reinterpret_cast<const uint8_t*>(str), strlen(str)) : 0; }
+  size_t write(const char* buffer, const size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+  virtual void flush() {}
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(const String& str);
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t print(unsigned int value) { return printf("%u", value); }
+  size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    const size_t n = print(value);
+    return n + println();
+  }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
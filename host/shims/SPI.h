@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+class SPIClass {
+ public:
+  void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+  void end() {}
+};
+
+extern SPIClass SPI;
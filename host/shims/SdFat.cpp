@@ -0,0 +1,223 @@
+#include <SdFat.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <ctime>
+
+namespace {
+std::string& rootDir() {
+  static std::string root = [] {
+    const char* env = getenv("OMNIPAPER_SD_ROOT");
+    return std::string(env && *env ? env : ".");
+  }();
+  return root;
+}
+
+std::string joinPath(const std::string& dir, const std::string& name) {
+  if (dir.empty() || dir.back() == '/') return dir + name;
+  return dir + "/" + name;
+}
+
+// fopen mode matching the SdFat open flags, after the file was created or truncated by open(2)
+const char* modeFor(const oflag_t oflag) {
+  const int access = oflag & O_ACCMODE;
+  if (oflag & O_APPEND) return access == O_RDWR ? "a+b" : "ab";
+  if (access == O_RDONLY) return "rb";
+  return access == O_RDWR ? "r+b" : "wb";
+}
+}  // namespace
+
+struct FsFile::Handle {
+  std::string path;
+  std::string name;
+  FILE* file = nullptr;
+  DIR* dir = nullptr;
+  // stdio needs a seek between writing and reading the same stream, SdFat doesn't
+  bool writing = false;
+
+  void switchTo(const bool write) {
+    if (writing != write) {
+      fseeko(file, 0, SEEK_CUR);
+      writing = write;
+    }
+  }
+
+  ~Handle() {
+    if (file) fclose(file);
+    if (dir) closedir(dir);
+  }
+};
+
+bool FsFile::isOpen() const { return handle && (handle->file || handle->dir); }
+
+bool FsFile::isDirectory() const { return handle && handle->dir; }
+
+bool FsFile::close() {
+  handle.reset();
+  return true;
+}
+
+int FsFile::read() {
+  if (!handle || !handle->file) return -1;
+  handle->switchTo(false);
+  return fgetc(handle->file);
+}
+
+int FsFile::read(void* buffer, const size_t count) {
+  if (!handle || !handle->file) return -1;
+  handle->switchTo(false);
+  return static_cast<int>(fread(buffer, 1, count, handle->file));
+}
+
+int FsFile::peek() {
+  if (!handle || !handle->file) return -1;
+  handle->switchTo(false);
+  const int c = fgetc(handle->file);
+  if (c != EOF) ungetc(c, handle->file);
+  return c;
+}
+
+int FsFile::available() const {
+  if (!handle || !handle->file) return 0;
+  const uint64_t remaining = size() - position();
+  return remaining > INT32_MAX ? INT32_MAX : static_cast<int>(remaining);
+}
+
+size_t FsFile::write(const uint8_t c) { return write(&c, 1); }
+
+size_t FsFile::write(const uint8_t* buffer, const size_t count) {
+  if (!handle || !handle->file) return 0;
+  handle->switchTo(true);
+  return fwrite(buffer, 1, count, handle->file);
+}
+
+void FsFile::flush() {
+  if (handle && handle->file) fflush(handle->file);
+}
+
+bool FsFile::seekSet(const uint64_t position) {
+  return handle && handle->file && fseeko(handle->file, static_cast<off_t>(position), SEEK_SET) == 0;
+}
+
+bool FsFile::seekCur(const int64_t offset) {
+  return handle && handle->file && fseeko(handle->file, static_cast<off_t>(offset), SEEK_CUR) == 0;
+}
+
+bool FsFile::seekEnd(const int64_t offset) {
+  return handle && handle->file && fseeko(handle->file, static_cast<off_t>(offset), SEEK_END) == 0;
+}
+
+uint64_t FsFile::position() const {
+  if (!handle || !handle->file) return 0;
+  const off_t pos = ftello(handle->file);
+  return pos < 0 ? 0 : static_cast<uint64_t>(pos);
+}
+
+uint64_t FsFile::size() const {
+  if (!handle || !handle->file) return 0;
+  fflush(handle->file);
+  struct stat st = {};
+  return fstat(fileno(handle->file), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+bool FsFile::truncate(const uint64_t length) {
+  if (!handle || !handle->file) return false;
+  fflush(handle->file);
+  return ftruncate(fileno(handle->file), static_cast<off_t>(length)) == 0 && seekSet(length);
+}
+
+FsFile FsFile::openNextFile(const oflag_t oflag) {
+  FsFile next;
+  if (!handle || !handle->dir) return next;
+  while (const dirent* entry = readdir(handle->dir)) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    const std::string path = joinPath(handle->path, entry->d_name);
+    SdFat sd;
+    next = sd.open(path.c_str(), oflag);
+    if (next) return next;
+  }
+  return next;
+}
+
+void FsFile::rewindDirectory() {
+  if (handle && handle->dir) rewinddir(handle->dir);
+}
+
+size_t FsFile::getName(char* name, const size_t size) const {
+  if (!handle || size == 0) return 0;
+  const size_t length = std::min(handle->name.size(), size - 1);
+  memcpy(name, handle->name.data(), length);
+  name[length] = '\0';
+  return length;
+}
+
+bool FsFile::getModifyDateTime(uint16_t* pdate, uint16_t* ptime) {
+  if (!handle || !handle->file) return false;
+  fflush(handle->file);
+  struct stat st = {};
+  if (fstat(fileno(handle->file), &st) != 0) return false;
+  struct tm local = {};
+  localtime_r(&st.st_mtime, &local);
+  *pdate = static_cast<uint16_t>((local.tm_year - 80) << 9 | (local.tm_mon + 1) << 5 | local.tm_mday);
+  *ptime = static_cast<uint16_t>(local.tm_hour << 11 | local.tm_min << 5 | local.tm_sec / 2);
+  return true;
+}
+
+void SdFat::setRoot(const std::string& root) { rootDir() = root; }
+
+std::string SdFat::hostPath(const char* path) {
+  std::string relative = path ? path : "";
+  while (!relative.empty() && relative.front() == '/') relative.erase(relative.begin());
+  return joinPath(rootDir(), relative);
+}
+
+FsFile SdFat::open(const char* path, const oflag_t oflag) {
+  FsFile file;
+  if (!path) return file;
+  const std::string host = hostPath(path);
+  auto handle = std::make_shared<FsFile::Handle>();
+  handle->path = path;
+  const std::string cardPath = path;
+  const size_t slash = cardPath.find_last_of('/');
+  handle->name = slash == std::string::npos ? cardPath : cardPath.substr(slash + 1);
+
+  struct stat st = {};
+  if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    handle->dir = opendir(host.c_str());
+  } else {
+    const int fd = ::open(host.c_str(), oflag, 0644);
+    if (fd >= 0) {
+      handle->file = fdopen(fd, modeFor(oflag));
+      if (!handle->file) ::close(fd);
+    }
+  }
+  if (handle->file || handle->dir) file.handle = handle;
+  return file;
+}
+
+bool SdFat::exists(const char* path) {
+  struct stat st = {};
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool SdFat::mkdir(const char* path, const bool pFlag) {
+  const std::string host = hostPath(path);
+  if (!pFlag) return ::mkdir(host.c_str(), 0755) == 0;
+  bool created = false;
+  for (size_t pos = rootDir().size() + 1; pos <= host.size(); pos++) {
+    if (pos == host.size() || host[pos] == '/') {
+      created = ::mkdir(host.substr(0, pos).c_str(), 0755) == 0;
+    }
+  }
+  return created;
+}
+
+bool SdFat::remove(const char* path) { return unlink(hostPath(path).c_str()) == 0; }
+
+bool SdFat::rmdir(const char* path) { return ::rmdir(hostPath(path).c_str()) == 0; }
+
+bool SdFat::rename(const char* oldPath, const char* newPath) {
+  return ::rename(hostPath(oldPath).c_str(), hostPath(newPath).c_str()) == 0;
+}
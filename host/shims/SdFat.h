@@ -0,0 +1,82 @@
+#pragma once
+// Host stand-in for SdFat: FsFile is a POSIX file under a host directory that plays the SD card root
+
+#include <Arduino.h>
+#include <fcntl.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+typedef int oflag_t;
+#ifndef O_READ
+#define O_READ O_RDONLY
+#endif
+#ifndef O_WRITE
+#define O_WRITE O_WRONLY
+#endif
+#ifndef O_AT_END
+#define O_AT_END O_APPEND
+#endif
+
+class FsFile : public Print {
+  struct Handle;
+  // Shared like SdFat's file objects, which are copied around freely
+  std::shared_ptr<Handle> handle;
+
+  friend class SdFat;
+
+ public:
+  FsFile() = default;
+
+  explicit operator bool() const { return isOpen(); }
+  bool isOpen() const;
+  bool isDirectory() const;
+  bool close();
+
+  int read();
+  int read(void* buffer, size_t count);
+  int peek();
+  int available() const;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t count) override;
+  size_t write(const void* buffer, const size_t count) { return write(static_cast<const uint8_t*>(buffer), count); }
+  using Print::write;
+  void flush() override;
+  bool sync() {
+    flush();
+    return true;
+  }
+
+  bool seek(uint64_t position) { return seekSet(position); }
+  bool seekSet(uint64_t position);
+  bool seekCur(int64_t offset);
+  bool seekEnd(int64_t offset = 0);
+  uint64_t position() const;
+  uint64_t curPosition() const { return position(); }
+  uint64_t size() const;
+  uint64_t fileSize() const { return size(); }
+  bool truncate(uint64_t length);
+
+  FsFile openNextFile(oflag_t oflag = O_RDONLY);
+  void rewindDirectory();
+  size_t getName(char* name, size_t size) const;
+  // FAT encoded local modification time, as SdFat reports it
+  bool getModifyDateTime(uint16_t* pdate, uint16_t* ptime);
+};
+
+class SdFat {
+ public:
+  // Host directory that stands in for the card, "." unless OMNIPAPER_SD_ROOT is set or setRoot() was called
+  static void setRoot(const std::string& root);
+  static std::string hostPath(const char* path);
+
+  bool begin(uint8_t = 0, uint32_t = 0) { return true; }
+  FsFile open(const char* path, oflag_t oflag = O_RDONLY);
+  bool exists(const char* path);
+  bool mkdir(const char* path, bool pFlag = true);
+  bool remove(const char* path);
+  bool rmdir(const char* path);
+  bool rename(const char* oldPath, const char* newPath);
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+
+// Arduino String on top of std::string, covering what the SD card manager and libraries use
+class String {
+  std::string value;
+
+ public:
+  String() = default;
+  String(const char* str) : value(str ? str : "") {}
+  String(const std::string& str) : value(str) {}
+  explicit String(char c) : value(1, c) {}
+  explicit String(int number) : value(std::to_string(number)) {}
+  explicit String(unsigned int number) : value(std::to_string(number)) {}
+  explicit String(long number) : value(std::to_string(number)) {}
+  explicit String(unsigned long number) : value(std::to_string(number)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool isEmpty() const { return value.empty(); }
+  void reserve(const unsigned int size) { value.reserve(size); }
+  char operator[](const unsigned int index) const { return value[index]; }
+  bool startsWith(const String& prefix) const { return value.rfind(prefix.value, 0) == 0; }
+  bool endsWith(const String& suffix) const {
+    return value.size() >= suffix.value.size() &&
+           value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+  }
+  int indexOf(const char c) const {
+    const auto pos = value.find(c);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+  }
+  String substring(const unsigned int from) const { return String(value.substr(from)); }
+  String substring(const unsigned int from, const unsigned int to) const {
+    return String(value.substr(from, to - from));
+  }
+
+  String& operator+=(const String& other) {
+    value += other.value;
+    return *this;
+  }
+  String& operator+=(const char* other) {
+    value += other;
+    return *this;
+  }
+  String& operator+=(const char c) {
+    value += c;
+    return *this;
+  }
+  friend String operator+(String lhs, const String& rhs) { return lhs += rhs; }
+  friend String operator+(String lhs, const char* rhs) { return lhs += rhs; }
+  bool operator==(const String& other) const { return value == other.value; }
+  bool operator==(const char* other) const { return value == other; }
+  bool operator!=(const String& other) const { return value != other.value; }
+};
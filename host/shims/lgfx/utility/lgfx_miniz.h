@@ -0,0 +1,19 @@
+#pragma once
+// The M5 builds inflate with the copy of tinfl bundled in LovyanGFX; on the host the same code runs on lib/miniz
+
+#include <miniz.h>
+
+using lgfx_tinfl_decompressor = tinfl_decompressor;
+using lgfx_tinfl_status = tinfl_status;
+
+inline void lgfx_tinfl_init(lgfx_tinfl_decompressor* r) { tinfl_init(r); }
+
+inline lgfx_tinfl_status lgfx_tinfl_decompress(lgfx_tinfl_decompressor* r, const mz_uint8* pIn_buf_next,
+                                               size_t* pIn_buf_size, mz_uint8* pOut_buf_start,
+                                               mz_uint8* pOut_buf_next, size_t* pOut_buf_size,
+                                               const mz_uint32 decomp_flags) {
+  return tinfl_decompress(r, pIn_buf_next, pIn_buf_size, pOut_buf_start, pOut_buf_next, pOut_buf_size, decomp_flags);
+}
+
+// Callers map the tinfl names onto the lgfx ones with their own macros
+#undef tinfl_init
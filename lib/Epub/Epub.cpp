@@ -4,7 +4,9 @@
 #include <HardwareSerial.h>
 #include <JpegToBmpConverter.h>
 #include <SDCardManager.h>
+#include <Trace.h>
 #include <ZipFile.h>
+#include <ZipSession.h>
 
 #include "Epub/parsers/ContainerParser.h"
 #include "Epub/parsers/ContentOpfParser.h"
@@ -99,50 +101,24 @@ bool Epub::parseTocNcxFile() const {
 
   Serial.printf("[%lu] [EBP] Parsing toc ncx file: %s\n", millis(), tocNcxItem.c_str());
 
-  const auto tmpNcxPath = getCachePath() + "/toc.ncx";
-  FsFile tempNcxFile;
-  if (!SdMan.openFileForWrite("EBP", tmpNcxPath, tempNcxFile)) {
+  size_t ncxSize;
+  if (!getItemSize(tocNcxItem, &ncxSize)) {
+    Serial.printf("[%lu] [EBP] Could not get size of toc ncx\n", millis());
     return false;
   }
-  readItemContentsToStream(tocNcxItem, tempNcxFile, 1024);
-  tempNcxFile.close();
-  if (!SdMan.openFileForRead("EBP", tmpNcxPath, tempNcxFile)) {
-    return false;
-  }
-  const auto ncxSize = tempNcxFile.size();
 
   TocNcxParser ncxParser(contentBasePath, ncxSize, bookMetadataCache.get());
 
   if (!ncxParser.setup()) {
     Serial.printf("[%lu] [EBP] Could not setup toc ncx parser\n", millis());
-    tempNcxFile.close();
     return false;
   }
 
-  const auto ncxBuffer = static_cast<uint8_t*>(malloc(1024));
-  if (!ncxBuffer) {
-    Serial.printf("[%lu] [EBP] Could not allocate memory for toc ncx parser\n", millis());
-    tempNcxFile.close();
+  if (!readItemContentsToStream(tocNcxItem, ncxParser, 1024)) {
+    Serial.printf("[%lu] [EBP] Could not process all toc ncx data\n", millis());
     return false;
   }
 
-  while (tempNcxFile.available()) {
-    const auto readSize = tempNcxFile.read(ncxBuffer, 1024);
-    if (readSize == 0) break;
-    const auto processedSize = ncxParser.write(ncxBuffer, readSize);
-
-    if (processedSize != readSize) {
-      Serial.printf("[%lu] [EBP] Could not process all toc ncx data\n", millis());
-      free(ncxBuffer);
-      tempNcxFile.close();
-      return false;
-    }
-  }
-
-  free(ncxBuffer);
-  tempNcxFile.close();
-  SdMan.remove(tmpNcxPath.c_str());
-
   Serial.printf("[%lu] [EBP] Parsed TOC items\n", millis());
   return true;
 }
@@ -156,17 +132,11 @@ bool Epub::parseTocNavFile() const {
 
   Serial.printf("[%lu] [EBP] Parsing toc nav file: %s\n", millis(), tocNavItem.c_str());
 
-  const auto tmpNavPath = getCachePath() + "/toc.nav";
-  FsFile tempNavFile;
-  if (!SdMan.openFileForWrite("EBP", tmpNavPath, tempNavFile)) {
+  size_t navSize;
+  if (!getItemSize(tocNavItem, &navSize)) {
+    Serial.printf("[%lu] [EBP] Could not get size of toc nav\n", millis());
     return false;
   }
-  readItemContentsToStream(tocNavItem, tempNavFile, 1024);
-  tempNavFile.close();
-  if (!SdMan.openFileForRead("EBP", tmpNavPath, tempNavFile)) {
-    return false;
-  }
-  const auto navSize = tempNavFile.size();
 
   // Note: We can't use `contentBasePath` here as the nav file may be in a different folder to the content.opf
   // and the HTMLX nav file will have hrefs relative to itself
@@ -178,34 +148,18 @@ bool Epub::parseTocNavFile() const {
     return false;
   }
 
-  const auto navBuffer = static_cast<uint8_t*>(malloc(1024));
-  if (!navBuffer) {
-    Serial.printf("[%lu] [EBP] Could not allocate memory for toc nav parser\n", millis());
+  if (!readItemContentsToStream(tocNavItem, navParser, 1024)) {
+    Serial.printf("[%lu] [EBP] Could not process all toc nav data\n", millis());
     return false;
   }
 
-  while (tempNavFile.available()) {
-    const auto readSize = tempNavFile.read(navBuffer, 1024);
-    const auto processedSize = navParser.write(navBuffer, readSize);
-
-    if (processedSize != readSize) {
-      Serial.printf("[%lu] [EBP] Could not process all toc nav data\n", millis());
-      free(navBuffer);
-      tempNavFile.close();
-      return false;
-    }
-  }
-
-  free(navBuffer);
-  tempNavFile.close();
-  SdMan.remove(tmpNavPath.c_str());
-
   Serial.printf("[%lu] [EBP] Parsed TOC nav items\n", millis());
   return true;
 }
 
 // load in the meta data for the epub file
 bool Epub::load(const bool buildIfMissing) {
+  TRACE_SCOPE("epub", "open");
   Serial.printf("[%lu] [EBP] Loading ePub: %s\n", millis(), filepath.c_str());
 
   // Initialize spine/TOC cache
@@ -213,6 +167,7 @@ bool Epub::load(const bool buildIfMissing) {
 
   // Try to load existing cache first
   if (bookMetadataCache->load()) {
+    loadZipIndex();
     Serial.printf("[%lu] [EBP] Loaded ePub: %s\n", millis(), filepath.c_str());
     return true;
   }
@@ -227,6 +182,8 @@ bool Epub::load(const bool buildIfMissing) {
   setupCacheDir();
 
   const uint32_t indexingStart = millis();
+  // Index the central directory first so the OPF and TOC lookups below already use it
+  loadZipIndex();
 
   // Begin building cache - stream entries to disk immediately
   if (!bookMetadataCache->beginWrite()) {
@@ -313,6 +270,20 @@ bool Epub::load(const bool buildIfMissing) {
   return true;
 }
 
+Epub::~Epub() = default;
+
+void Epub::loadZipIndex() {
+  const std::string indexPath = cachePath + "/zip.idx";
+  if (ZipFile(filepath).ensureIndex(indexPath)) {
+    zipIndexPath = indexPath;
+  } else {
+    Serial.printf("[%lu] [EBP] No zip index, falling back to central directory scans\n", millis());
+    zipIndexPath.clear();
+  }
+  // The session opened before the index was known would keep scanning the central directory
+  zipSession.reset(new ZipSession(filepath, getZipIndexPath()));
+}
+
 bool Epub::clearCache() const {
   if (!SdMan.exists(cachePath.c_str())) {
     Serial.printf("[%lu] [EPB] Cache does not exist, no action needed\n", millis());
@@ -500,7 +471,7 @@ uint8_t* Epub::readItemContentsToBytes(const std::string& itemHref, size_t* size
 
   const std::string path = FsHelpers::normalisePath(itemHref);
 
-  const auto content = ZipFile(filepath).readFileToMemory(path.c_str(), size, trailingNullByte);
+  const auto content = getZipSession().readFileToMemory(path.c_str(), size, trailingNullByte);
   if (!content) {
     Serial.printf("[%lu] [EBP] Failed to read item %s\n", millis(), path.c_str());
     return nullptr;
@@ -516,12 +487,12 @@ bool Epub::readItemContentsToStream(const std::string& itemHref, Print& out, con
   }
 
   const std::string path = FsHelpers::normalisePath(itemHref);
-  return ZipFile(filepath).readFileToStream(path.c_str(), out, chunkSize);
+  return getZipSession().readFileToStream(path.c_str(), out, chunkSize);
 }
 
 bool Epub::getItemSize(const std::string& itemHref, size_t* size) const {
   const std::string path = FsHelpers::normalisePath(itemHref);
-  return ZipFile(filepath).getInflatedFileSize(path.c_str(), size);
+  return getZipSession().getInflatedFileSize(path.c_str(), size);
 }
 
 int Epub::getSpineItemsCount() const {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Print.h>
+#include <ZipSession.h>
 
 #include <memory>
 #include <string>
@@ -9,8 +10,6 @@
 
 #include "Epub/BookMetadataCache.h"
 
-class ZipFile;
-
 class Epub {
   // the ncx file (EPUB 2)
   std::string tocNcxItem;
@@ -24,18 +23,27 @@ class Epub {
   std::string cachePath;
   // Spine and TOC cache
   std::unique_ptr<BookMetadataCache> bookMetadataCache;
+  // Central directory index of the zip, empty until load() has verified or built it
+  std::string zipIndexPath;
+  // Open zip and inflate buffers shared by every item read. Only load() replaces it (once the index is known), before
+  // any reader task can get at the book, so the render and look-ahead tasks never race to create it.
+  std::unique_ptr<ZipSession> zipSession;
 
   bool findContentOpfFile(std::string* contentOpfFile) const;
   bool parseContentOpf(BookMetadataCache::BookMetadata& bookMetadata);
   bool parseTocNcxFile() const;
   bool parseTocNavFile() const;
+  void loadZipIndex();
+  const std::string* getZipIndexPath() const { return zipIndexPath.empty() ? nullptr : &zipIndexPath; }
+  ZipSession& getZipSession() const { return *zipSession; }
 
  public:
-  explicit Epub(std::string filepath, const std::string& cacheDir) : filepath(std::move(filepath)) {
+  explicit Epub(std::string filepath, const std::string& cacheDir)
+      : filepath(std::move(filepath)), zipSession(new ZipSession(this->filepath)) {
     // create a cache key based on the filepath
     cachePath = cacheDir + "/epub_" + std::to_string(std::hash<std::string>{}(this->filepath));
   }
-  ~Epub() = default;
+  ~Epub();
   std::string& getBasePath() { return contentBasePath; }
   bool load(bool buildIfMissing = true);
   bool clearCache() const;
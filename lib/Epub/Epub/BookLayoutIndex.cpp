@@ -0,0 +1,215 @@
+#include "BookLayoutIndex.h"
+
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+#include <Serialization.h>
+
+#include <algorithm>
+
+namespace {
+constexpr uint8_t LAYOUT_INDEX_VERSION = 1;
+constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(int) + sizeof(float) + sizeof(bool) + sizeof(uint8_t) +
+                                 sizeof(uint16_t) + sizeof(uint16_t) + sizeof(bool) + sizeof(uint16_t);
+}  // namespace
+
+bool BookLayoutIndex::matches(const int fontId, const float lineCompression, const bool extraParagraphSpacing,
+                              const uint8_t paragraphAlignment, const uint16_t viewportWidth,
+                              const uint16_t viewportHeight, const bool hyphenationEnabled) const {
+  return this->fontId == fontId && this->lineCompression == lineCompression &&
+         this->extraParagraphSpacing == extraParagraphSpacing && this->paragraphAlignment == paragraphAlignment &&
+         this->viewportWidth == viewportWidth && this->viewportHeight == viewportHeight &&
+         this->hyphenationEnabled == hyphenationEnabled;
+}
+
+bool BookLayoutIndex::begin(const int fontId, const float lineCompression, const bool extraParagraphSpacing,
+                            const uint8_t paragraphAlignment, const uint16_t viewportWidth,
+                            const uint16_t viewportHeight, const bool hyphenationEnabled, const int spineCount) {
+  if (loaded && static_cast<int>(pageCounts.size()) == spineCount &&
+      matches(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth, viewportHeight,
+              hyphenationEnabled)) {
+    return true;
+  }
+
+  // Counts still pending belong to the layout being left
+  flush();
+  this->fontId = fontId;
+  this->lineCompression = lineCompression;
+  this->extraParagraphSpacing = extraParagraphSpacing;
+  this->paragraphAlignment = paragraphAlignment;
+  this->viewportWidth = viewportWidth;
+  this->viewportHeight = viewportHeight;
+  this->hyphenationEnabled = hyphenationEnabled;
+  loaded = false;
+
+  if (spineCount <= 0 || spineCount >= UINT16_MAX) {
+    return false;
+  }
+
+  if (loadFromFile(spineCount)) {
+    loaded = true;
+    unsavedCount = 0;
+    rebuildCumulativePages();
+    Serial.printf("[%lu] [BLI] Loaded layout index: %d of %d spine items missing\n", millis(), missingCount,
+                  spineCount);
+    return true;
+  }
+
+  // Nothing usable on disk, start counting from scratch for this layout. The file is written with the first counts.
+  pageCounts.assign(spineCount, UNKNOWN_PAGE_COUNT);
+  missingCount = spineCount;
+  unsavedCount = 0;
+  cumulativePages.clear();
+  loaded = true;
+  Serial.printf("[%lu] [BLI] Started new layout index for %d spine items\n", millis(), spineCount);
+  return true;
+}
+
+bool BookLayoutIndex::loadFromFile(const int spineCount) {
+  FsFile file;
+  if (!SdMan.openFileForRead("BLI", filePath, file)) {
+    return false;
+  }
+
+  if (file.size() != HEADER_SIZE + sizeof(uint16_t) * spineCount) {
+    file.close();
+    return false;
+  }
+
+  uint8_t version;
+  int fileFontId;
+  float fileLineCompression;
+  bool fileExtraParagraphSpacing;
+  uint8_t fileParagraphAlignment;
+  uint16_t fileViewportWidth, fileViewportHeight;
+  bool fileHyphenationEnabled;
+  uint16_t fileSpineCount;
+  serialization::readPod(file, version);
+  serialization::readPod(file, fileFontId);
+  serialization::readPod(file, fileLineCompression);
+  serialization::readPod(file, fileExtraParagraphSpacing);
+  serialization::readPod(file, fileParagraphAlignment);
+  serialization::readPod(file, fileViewportWidth);
+  serialization::readPod(file, fileViewportHeight);
+  serialization::readPod(file, fileHyphenationEnabled);
+  serialization::readPod(file, fileSpineCount);
+
+  if (version != LAYOUT_INDEX_VERSION || fileSpineCount != spineCount ||
+      !matches(fileFontId, fileLineCompression, fileExtraParagraphSpacing, fileParagraphAlignment, fileViewportWidth,
+               fileViewportHeight, fileHyphenationEnabled)) {
+    Serial.printf("[%lu] [BLI] Layout index is for another layout, discarding\n", millis());
+    file.close();
+    return false;
+  }
+
+  pageCounts.resize(spineCount);
+  const size_t countsSize = sizeof(uint16_t) * spineCount;
+  const bool ok = file.read(reinterpret_cast<uint8_t*>(pageCounts.data()), countsSize) == static_cast<int>(countsSize);
+  file.close();
+  if (!ok) {
+    return false;
+  }
+
+  missingCount = static_cast<int>(std::count(pageCounts.begin(), pageCounts.end(), UNKNOWN_PAGE_COUNT));
+  return true;
+}
+
+bool BookLayoutIndex::save() const {
+  FsFile file;
+  if (!SdMan.openFileForWrite("BLI", filePath, file)) {
+    return false;
+  }
+
+  serialization::writePod(file, LAYOUT_INDEX_VERSION);
+  serialization::writePod(file, fontId);
+  serialization::writePod(file, lineCompression);
+  serialization::writePod(file, extraParagraphSpacing);
+  serialization::writePod(file, paragraphAlignment);
+  serialization::writePod(file, viewportWidth);
+  serialization::writePod(file, viewportHeight);
+  serialization::writePod(file, hyphenationEnabled);
+  serialization::writePod(file, static_cast<uint16_t>(pageCounts.size()));
+  file.write(reinterpret_cast<const uint8_t*>(pageCounts.data()), sizeof(uint16_t) * pageCounts.size());
+  file.close();
+  return true;
+}
+
+void BookLayoutIndex::rebuildCumulativePages() {
+  cumulativePages.clear();
+  if (missingCount != 0) {
+    return;
+  }
+
+  cumulativePages.reserve(pageCounts.size() + 1);
+  uint32_t total = 0;
+  cumulativePages.push_back(total);
+  for (const uint16_t count : pageCounts) {
+    total += count;
+    cumulativePages.push_back(total);
+  }
+}
+
+int BookLayoutIndex::nextMissingSpineIndex(const int from) const {
+  if (!loaded || missingCount == 0 || from < 0 || from >= static_cast<int>(pageCounts.size())) {
+    return -1;
+  }
+
+  const auto it = std::find(pageCounts.begin() + from, pageCounts.end(), UNKNOWN_PAGE_COUNT);
+  return it == pageCounts.end() ? -1 : static_cast<int>(it - pageCounts.begin());
+}
+
+bool BookLayoutIndex::setSectionPageCount(const int spineIndex, const uint16_t pageCount) {
+  if (!loaded || spineIndex < 0 || spineIndex >= static_cast<int>(pageCounts.size()) ||
+      pageCount == UNKNOWN_PAGE_COUNT) {
+    return false;
+  }
+
+  uint16_t& slot = pageCounts[spineIndex];
+  if (slot == pageCount) {
+    return true;
+  }
+
+  if (slot == UNKNOWN_PAGE_COUNT) {
+    missingCount--;
+    if (missingCount == 0) {
+      Serial.printf("[%lu] [BLI] Layout index complete\n", millis());
+    }
+  }
+  slot = pageCount;
+  rebuildCumulativePages();
+  unsavedCount++;
+  if (missingCount == 0 || unsavedCount >= SAVE_INTERVAL) {
+    return flush();
+  }
+  return true;
+}
+
+bool BookLayoutIndex::flush() {
+  if (!loaded || unsavedCount == 0) {
+    return true;
+  }
+  if (!save()) {
+    return false;
+  }
+  unsavedCount = 0;
+  return true;
+}
+
+uint32_t BookLayoutIndex::getTotalPages() const { return isComplete() ? cumulativePages.back() : 0; }
+
+uint32_t BookLayoutIndex::getGlobalPage(const int spineIndex, const int page) const {
+  if (!isComplete() || spineIndex < 0 || spineIndex >= static_cast<int>(pageCounts.size())) {
+    return 0;
+  }
+  return cumulativePages[spineIndex] + std::max(0, page);
+}
+
+bool BookLayoutIndex::findSection(const uint32_t globalPage, int* spineIndex, int* page) const {
+  if (!isComplete() || globalPage >= getTotalPages()) {
+    return false;
+  }
+  // The last spine item starting at or before globalPage, empty items start where the next one does
+  const auto next = std::upper_bound(cumulativePages.begin(), cumulativePages.end(), globalPage);
+  *spineIndex = static_cast<int>(next - cumulativePages.begin()) - 1;
+  *page = static_cast<int>(globalPage - cumulativePages[*spineIndex]);
+  return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Page count of every spine item for one layout tuple, kept in layout.bin next to book.bin.
+// Counts are filled in as sections get laid out (possibly over several sessions); once every spine item is known,
+// global page numbers are plain table lookups.
+class BookLayoutIndex {
+  std::string filePath;
+  bool loaded = false;
+  int fontId = 0;
+  float lineCompression = 0;
+  bool extraParagraphSpacing = false;
+  uint8_t paragraphAlignment = 0;
+  uint16_t viewportWidth = 0;
+  uint16_t viewportHeight = 0;
+  bool hyphenationEnabled = false;
+  std::vector<uint16_t> pageCounts;
+  // Pages before each spine item, only valid once the index is complete
+  std::vector<uint32_t> cumulativePages;
+  int missingCount = 0;
+  // Counts set since the last save
+  int unsavedCount = 0;
+
+  bool matches(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
+               uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled) const;
+  bool loadFromFile(int spineCount);
+  bool save() const;
+  void rebuildCumulativePages();
+
+ public:
+  static constexpr uint16_t UNKNOWN_PAGE_COUNT = UINT16_MAX;
+  // New counts collected before layout.bin is rewritten, so a pass over a long book doesn't write it per section
+  static constexpr int SAVE_INTERVAL = 8;
+
+  explicit BookLayoutIndex(const std::string& cachePath) : filePath(cachePath + "/layout.bin") {}
+
+  // Loads the index for this layout, or starts an empty one if the stored index was built for another layout.
+  // Cheap when the index is already loaded for the same layout.
+  bool begin(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
+             uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled, int spineCount);
+  bool isComplete() const { return loaded && missingCount == 0; }
+  // First spine item from `from` on without a page count, -1 when there is none
+  int nextMissingSpineIndex(int from = 0) const;
+  // Saved every SAVE_INTERVAL new counts and once the index is complete, so an interrupted pass resumes close to where
+  // it stopped. flush() saves the rest.
+  bool setSectionPageCount(int spineIndex, uint16_t pageCount);
+  bool flush();
+
+  // Only meaningful once isComplete()
+  uint32_t getTotalPages() const;
+  uint32_t getGlobalPage(int spineIndex, int page) const;
+  // Spine item and page within it of a global page counted from 0, false past the last page
+  bool findSection(uint32_t globalPage, int* spineIndex, int* page) const;
+};
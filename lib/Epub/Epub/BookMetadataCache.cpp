@@ -153,7 +153,7 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
   // Loop through spines from spine file matching up TOC indexes, calculating cumulative size and writing to book.bin
 
   // Build spineIndex->tocIndex mapping in one pass (O(n) instead of O(n*m))
-  std::vector<int16_t> spineToTocIndex(spineCount, -1);
+  IndexVector<int16_t> spineToTocIndex(spineCount, -1);
   tocFile.seek(0);
   for (int j = 0; j < tocCount; j++) {
     auto tocEntry = readTocEntry(tocFile);
@@ -182,6 +182,7 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
   // See: https://github.com/crosspoint-reader/crosspoint-reader/issues/134
 
   std::vector<uint32_t> spineSizes;
+  memtrack::Charge spineSizesCharge(memtrack::Tag::MetadataCache);
   bool useBatchSizes = false;
 
   if (spineCount >= LARGE_SPINE_THRESHOLD) {
@@ -189,6 +190,7 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
 
     std::vector<ZipFile::SizeTarget> targets;
     targets.reserve(spineCount);
+    memtrack::Charge targetsCharge(memtrack::Tag::MetadataCache, targets.capacity() * sizeof(ZipFile::SizeTarget));
 
     spineFile.seek(0);
     for (int i = 0; i < spineCount; i++) {
@@ -207,11 +209,13 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
     });
 
     spineSizes.resize(spineCount, 0);
+    spineSizesCharge.set(spineSizes.capacity() * sizeof(uint32_t));
     int matched = zip.fillUncompressedSizes(targets, spineSizes);
     Serial.printf("[%lu] [BMC] Batch lookup matched %d/%d spine items\n", millis(), matched, spineCount);
 
     targets.clear();
     targets.shrink_to_fit();
+    targetsCharge.set(0);
 
     useBatchSizes = true;
   }
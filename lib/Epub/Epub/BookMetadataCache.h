@@ -1,5 +1,6 @@
 #pragma once
 
+#include <MemTrack.h>
 #include <SDCardManager.h>
 
 #include <algorithm>
@@ -44,7 +45,7 @@ class BookMetadataCache {
 
  private:
   std::string cachePath;
-  size_t lutOffset;
+  uint32_t lutOffset;
   uint16_t spineCount;
   uint16_t tocCount;
   bool loaded;
@@ -61,7 +62,9 @@ class BookMetadataCache {
     uint16_t hrefLen;   // length for collision reduction
     int16_t spineIndex;
   };
-  std::vector<SpineHrefIndexEntry> spineHrefIndex;
+  template <typename T>
+  using IndexVector = std::vector<T, memtrack::Allocator<T, memtrack::Tag::MetadataCache>>;
+  IndexVector<SpineHrefIndexEntry> spineHrefIndex;
   bool useSpineHrefIndex = false;
 
   static constexpr uint16_t LARGE_SPINE_THRESHOLD = 400;
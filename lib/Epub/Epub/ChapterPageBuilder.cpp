@@ -0,0 +1,158 @@
+#include "ChapterPageBuilder.h"
+
+#include <GfxRenderer.h>
+#include <HardwareSerial.h>
+
+#include <algorithm>
+
+#include "Page.h"
+
+namespace {
+// Lay out and consume all but the last line once a paragraph buffers this many words. There should be enough here to
+// build out 1-2 full pages and doing this will free up a lot of memory.
+// Spotted when reading Intermezzo, there are some really long text blocks in there.
+constexpr size_t MAX_BUFFERED_WORDS = 750;
+}  // namespace
+
+bool ChapterPageBuilder::buildPages(ChapterTokens::Reader& tokens) {
+  ChapterTokens::Token token;
+  while (tokens.next(token)) {
+    switch (token.type) {
+      case ChapterTokens::TOKEN_BLOCK: {
+        // The paragraph alignment setting is resolved here so the tokens stay layout independent
+        const uint8_t style = token.style == ChapterTokens::PARAGRAPH_STYLE ? paragraphAlignment : token.style;
+        startNewTextBlock(static_cast<TextBlock::Style>(style));
+        break;
+      }
+      case ChapterTokens::TOKEN_WORD:
+        addWord(token.text, token.length, static_cast<EpdFontFamily::Style>(token.style));
+        break;
+      case ChapterTokens::TOKEN_IMAGE:
+        if (currentTextBlock && !currentTextBlock->isEmpty()) {
+          makePages();
+        }
+        addImageToPage(std::string(token.text, token.length), token.width, token.height);
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (tokens.hasFailed()) {
+    Serial.printf("[%lu] [CPB] Token stream ended early\n", millis());
+    return false;
+  }
+
+  // Process last page if there is still text
+  if (currentTextBlock) {
+    makePages();
+    completePageFn(std::move(currentPage));
+    currentPage.reset();
+    currentTextBlock.reset();
+  }
+  return true;
+}
+
+// start a new text block if needed
+void ChapterPageBuilder::startNewTextBlock(const TextBlock::Style style) {
+  if (currentTextBlock) {
+    if (!currentTextBlock->isEmpty()) {
+      makePages();
+    }
+    // Reuse the running text block so its word arena keeps its capacity for the next paragraph
+    currentTextBlock->reset(style);
+    return;
+  }
+  currentTextBlock.reset(new ParsedText(style, extraParagraphSpacing, hyphenationEnabled));
+}
+
+void ChapterPageBuilder::addWord(const char* word, const size_t length, const EpdFontFamily::Style style) {
+  if (!currentTextBlock) {
+    startNewTextBlock(static_cast<TextBlock::Style>(paragraphAlignment));
+  }
+  currentTextBlock->addWord(word, length, style);
+
+  if (currentTextBlock->size() > MAX_BUFFERED_WORDS) {
+    Serial.printf("[%lu] [CPB] Text block too long, splitting into multiple pages\n", millis());
+    currentTextBlock->layoutAndExtractLines(
+        renderer, fontId, viewportWidth,
+        [this](const std::shared_ptr<TextBlock>& textBlock) { addLineToPage(textBlock); }, false);
+  }
+}
+
+void ChapterPageBuilder::addLineToPage(std::shared_ptr<TextBlock> line) {
+  const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
+
+  if (!currentPage) {
+    currentPage.reset(new Page());
+    currentPageNextY = 0;
+  }
+
+  if (currentPageNextY + lineHeight > viewportHeight) {
+    completePageFn(std::move(currentPage));
+    currentPage.reset(new Page());
+    currentPageNextY = 0;
+  }
+
+  currentPage->elements.push_back(std::make_shared<PageLine>(line, 0, currentPageNextY));
+  currentPageNextY += lineHeight;
+}
+
+void ChapterPageBuilder::addImageToPage(const std::string& bmpPath, uint16_t imageWidth, uint16_t imageHeight) {
+  if (bmpPath.empty() || imageWidth == 0 || imageHeight == 0) {
+    return;
+  }
+
+  if (!currentPage) {
+    currentPage.reset(new Page());
+    currentPageNextY = 0;
+  }
+
+  int drawWidth = imageWidth;
+  int drawHeight = imageHeight;
+
+  if (drawWidth > viewportWidth) {
+    drawHeight = static_cast<int>((static_cast<uint32_t>(drawHeight) * viewportWidth) / std::max(1, drawWidth));
+    drawWidth = viewportWidth;
+  }
+
+  constexpr int kVerticalPadding = 8;
+  const int maxImageHeight = std::max(40, static_cast<int>(viewportHeight) - 40);
+  if (drawHeight > maxImageHeight) {
+    drawWidth = static_cast<int>((static_cast<uint32_t>(drawWidth) * maxImageHeight) / std::max(1, drawHeight));
+    drawHeight = maxImageHeight;
+  }
+
+  if (currentPageNextY + drawHeight > viewportHeight) {
+    completePageFn(std::move(currentPage));
+    currentPage.reset(new Page());
+    currentPageNextY = 0;
+  }
+
+  const int x = std::max(0, (static_cast<int>(viewportWidth) - drawWidth) / 2);
+  currentPage->elements.push_back(
+      std::make_shared<PageImage>(bmpPath, static_cast<int16_t>(x), static_cast<int16_t>(currentPageNextY),
+                                  static_cast<uint16_t>(drawWidth), static_cast<uint16_t>(drawHeight)));
+  currentPageNextY += drawHeight + kVerticalPadding;
+}
+
+void ChapterPageBuilder::makePages() {
+  if (!currentTextBlock) {
+    Serial.printf("[%lu] [CPB] !! No text block to make pages for !!\n", millis());
+    return;
+  }
+
+  if (!currentPage) {
+    currentPage.reset(new Page());
+    currentPageNextY = 0;
+  }
+
+  const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
+  currentTextBlock->layoutAndExtractLines(
+      renderer, fontId, viewportWidth,
+      [this](const std::shared_ptr<TextBlock>& textBlock) { addLineToPage(textBlock); });
+  // Extra paragraph spacing if enabled
+  if (extraParagraphSpacing) {
+    currentPageNextY += lineHeight / 2;
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "ChapterTokens.h"
+#include "ParsedText.h"
+#include "blocks/TextBlock.h"
+
+class Page;
+class GfxRenderer;
+
+// Lays out a tokenized chapter into pages for one font and viewport.
+class ChapterPageBuilder {
+  GfxRenderer& renderer;
+  std::function<void(std::unique_ptr<Page>)> completePageFn;
+  std::unique_ptr<ParsedText> currentTextBlock = nullptr;
+  std::unique_ptr<Page> currentPage = nullptr;
+  int16_t currentPageNextY = 0;
+  int fontId;
+  float lineCompression;
+  bool extraParagraphSpacing;
+  uint8_t paragraphAlignment;
+  uint16_t viewportWidth;
+  uint16_t viewportHeight;
+  bool hyphenationEnabled;
+
+  void startNewTextBlock(TextBlock::Style style);
+  void addWord(const char* word, size_t length, EpdFontFamily::Style style);
+  void makePages();
+  void addLineToPage(std::shared_ptr<TextBlock> line);
+  void addImageToPage(const std::string& bmpPath, uint16_t imageWidth, uint16_t imageHeight);
+
+ public:
+  explicit ChapterPageBuilder(GfxRenderer& renderer, const int fontId, const float lineCompression,
+                              const bool extraParagraphSpacing, const uint8_t paragraphAlignment,
+                              const uint16_t viewportWidth, const uint16_t viewportHeight,
+                              const bool hyphenationEnabled,
+                              const std::function<void(std::unique_ptr<Page>)>& completePageFn)
+      : renderer(renderer),
+        completePageFn(completePageFn),
+        fontId(fontId),
+        lineCompression(lineCompression),
+        extraParagraphSpacing(extraParagraphSpacing),
+        paragraphAlignment(paragraphAlignment),
+        viewportWidth(viewportWidth),
+        viewportHeight(viewportHeight),
+        hyphenationEnabled(hyphenationEnabled) {}
+  // Replays every token and hands out the finished pages, false if the stream ended early
+  bool buildPages(ChapterTokens::Reader& tokens);
+};
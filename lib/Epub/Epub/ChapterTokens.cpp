@@ -0,0 +1,173 @@
+#include "ChapterTokens.h"
+
+#include <HardwareSerial.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace ChapterTokens {
+namespace {
+constexpr size_t WRITE_CHUNK_SIZE = 1024;
+constexpr size_t READ_CHUNK_SIZE = 1024;
+}  // namespace
+
+Writer::Writer(FsFile& file) : file(file) {
+  buffer.reserve(WRITE_CHUNK_SIZE + MAX_TOKEN_TEXT + 8);
+  serialization::writePod(file, TOKEN_FILE_VERSION);
+  serialization::writePod(file, static_cast<uint32_t>(0));  // Placeholder until the chapter is complete
+}
+
+void Writer::flush() {
+  if (buffer.empty()) {
+    return;
+  }
+  if (file.write(buffer.data(), buffer.size()) != buffer.size()) {
+    failed = true;
+  }
+  tokenBytes += buffer.size();
+  buffer.clear();
+}
+
+void Writer::block(const uint8_t style) {
+  buffer.push_back(TOKEN_BLOCK);
+  buffer.push_back(style);
+  if (buffer.size() >= WRITE_CHUNK_SIZE) flush();
+}
+
+void Writer::word(const char* text, const size_t length, const EpdFontFamily::Style style) {
+  if (length == 0 || length > MAX_TOKEN_TEXT) {
+    return;
+  }
+  buffer.push_back(TOKEN_WORD | (static_cast<uint8_t>(style) & 0x3));
+  buffer.push_back(static_cast<uint8_t>(length));
+  buffer.insert(buffer.end(), text, text + length);
+  if (buffer.size() >= WRITE_CHUNK_SIZE) flush();
+}
+
+bool Writer::image(const std::string& path, const uint16_t width, const uint16_t height) {
+  if (path.empty() || path.size() > MAX_TOKEN_TEXT) {
+    return false;
+  }
+  buffer.push_back(TOKEN_IMAGE);
+  serialization::appendPod(buffer, width);
+  serialization::appendPod(buffer, height);
+  buffer.push_back(static_cast<uint8_t>(path.size()));
+  buffer.insert(buffer.end(), path.begin(), path.end());
+  if (buffer.size() >= WRITE_CHUNK_SIZE) flush();
+  return true;
+}
+
+bool Writer::finish() {
+  flush();
+  if (failed || tokenBytes == 0 || !file.seek(sizeof(TOKEN_FILE_VERSION))) {
+    return false;
+  }
+  serialization::writePod(file, tokenBytes);
+  return true;
+}
+
+Reader::Reader(FsFile& file, const std::function<bool()>& continueFn) : file(file), continueFn(continueFn) {}
+
+bool Reader::begin() {
+  uint8_t version = 0;
+  uint32_t tokenBytes = 0;
+  failed = false;
+  stopped = false;
+  serialization::readPod(file, version);
+  serialization::readPod(file, tokenBytes);
+  if (version != TOKEN_FILE_VERSION || tokenBytes == 0 || file.size() != HEADER_SIZE + tokenBytes) {
+    Serial.printf("[%lu] [CTK] Token file is stale or incomplete (version %u, %u bytes)\n", millis(), version,
+                  tokenBytes);
+    failed = true;
+    return false;
+  }
+  remaining = tokenBytes;
+  buffer.clear();
+  bufferPos = 0;
+  buffer.reserve(READ_CHUNK_SIZE + MAX_TOKEN_TEXT + 8);
+  return true;
+}
+
+// Makes sure count bytes are buffered, keeping the unread tail at the front
+bool Reader::ensure(const size_t count) {
+  if (buffer.size() - bufferPos >= count) {
+    return true;
+  }
+  if (remaining == 0) {
+    return false;
+  }
+  if (continueFn && !continueFn()) {
+    failed = true;
+    stopped = true;
+    return false;
+  }
+
+  buffer.erase(buffer.begin(), buffer.begin() + bufferPos);
+  bufferPos = 0;
+  const size_t kept = buffer.size();
+  const size_t toRead = std::min<size_t>(remaining, READ_CHUNK_SIZE);
+  buffer.resize(kept + toRead);
+  if (file.read(buffer.data() + kept, toRead) != static_cast<int>(toRead)) {
+    buffer.resize(kept);
+    failed = true;
+    return false;
+  }
+  remaining -= toRead;
+  return buffer.size() >= count;
+}
+
+bool Reader::next(Token& token) {
+  if (failed || !ensure(1)) {
+    return false;
+  }
+
+  const uint8_t tag = buffer[bufferPos];
+  size_t headerSize;
+  if (tag == TOKEN_BLOCK) {
+    headerSize = 2;
+  } else if ((tag & ~0x3) == TOKEN_WORD) {
+    headerSize = 2;
+  } else if (tag == TOKEN_IMAGE) {
+    headerSize = 6;
+  } else {
+    Serial.printf("[%lu] [CTK] Unknown token 0x%02x\n", millis(), tag);
+    failed = true;
+    return false;
+  }
+  if (!ensure(headerSize)) {
+    failed = true;
+    return false;
+  }
+
+  const uint8_t* cursor = buffer.data() + bufferPos + 1;
+  token.type = (tag & ~0x3) == TOKEN_WORD ? TOKEN_WORD : tag;
+  token.style = 0;
+  token.width = 0;
+  token.height = 0;
+  token.text = nullptr;
+  token.length = 0;
+  if (tag == TOKEN_BLOCK) {
+    token.style = cursor[0];
+    bufferPos += headerSize;
+    return true;
+  }
+
+  if (tag == TOKEN_IMAGE) {
+    memcpy(&token.width, cursor, sizeof(uint16_t));
+    memcpy(&token.height, cursor + 2, sizeof(uint16_t));
+    token.length = cursor[4];
+  } else {
+    token.style = tag & 0x3;
+    token.length = cursor[0];
+  }
+  // ensure() may move the buffer, so the text pointer is taken afterwards
+  if (!ensure(headerSize + token.length)) {
+    failed = true;
+    return false;
+  }
+  token.text = reinterpret_cast<const char*>(buffer.data() + bufferPos + headerSize);
+  bufferPos += headerSize + token.length;
+  return true;
+}
+}  // namespace ChapterTokens
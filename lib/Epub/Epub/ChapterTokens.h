@@ -0,0 +1,75 @@
+#pragma once
+#include <EpdFontFamily.h>
+#include <SdFat.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Layout-independent form of a chapter, cached as sections/<n>.tok next to the laid out sections/<n>.bin.
+// The XHTML is inflated and parsed once into this stream; a font, margin or alignment change only replays it.
+//   header: uint8 version, uint32 size of the token bytes (0 until the chapter was tokenized completely)
+//   block:  TOKEN_BLOCK, uint8 TextBlock::Style or PARAGRAPH_STYLE for the user's paragraph alignment
+//   word:   TOKEN_WORD | EpdFontFamily::Style, uint8 length, UTF-8 bytes
+//   image:  TOKEN_IMAGE, uint16 width, uint16 height, uint8 length, cached BMP path
+namespace ChapterTokens {
+constexpr uint8_t TOKEN_FILE_VERSION = 1;
+constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+constexpr uint8_t TOKEN_BLOCK = 0x01;
+constexpr uint8_t TOKEN_IMAGE = 0x02;
+constexpr uint8_t TOKEN_WORD = 0x10;
+constexpr uint8_t PARAGRAPH_STYLE = 0xFF;
+constexpr size_t MAX_TOKEN_TEXT = UINT8_MAX;
+
+struct Token {
+  uint8_t type;
+  uint8_t style;
+  uint16_t width;
+  uint16_t height;
+  // Points into the reader's buffer, valid until the next call to next()
+  const char* text;
+  uint8_t length;
+};
+
+// Buffers tokens and appends them to a file opened for writing, patches the header once finished
+class Writer {
+  FsFile& file;
+  std::vector<uint8_t> buffer;
+  uint32_t tokenBytes = 0;
+  bool failed = false;
+
+  void flush();
+
+ public:
+  explicit Writer(FsFile& file);
+  void block(uint8_t style);
+  void word(const char* text, size_t length, EpdFontFamily::Style style);
+  bool image(const std::string& path, uint16_t width, uint16_t height);
+  // Flushes and marks the stream complete; false if anything failed to reach the file
+  bool finish();
+};
+
+// Reads tokens back in buffered chunks. continueFn runs before each chunk is read; returning false ends the stream.
+class Reader {
+  FsFile& file;
+  const std::function<bool()>& continueFn;
+  uint32_t remaining = 0;
+  std::vector<uint8_t> buffer;
+  size_t bufferPos = 0;
+  bool failed = false;
+  bool stopped = false;
+
+  bool ensure(size_t count);
+
+ public:
+  Reader(FsFile& file, const std::function<bool()>& continueFn);
+  // Validates the header of a file positioned at its start
+  bool begin();
+  bool next(Token& token);
+  // True if the stream stopped early: truncated or corrupt data, or continueFn asked to stop
+  bool hasFailed() const { return failed; }
+  // True if the stream stopped because continueFn returned false, the data itself is fine
+  bool wasStopped() const { return stopped; }
+};
+}  // namespace ChapterTokens
@@ -6,25 +6,37 @@
 #include <SDCardManager.h>
 #include <Serialization.h>
 
+#include <new>
+
+namespace {
+// Sanity check against a corrupt LUT; a full page of text is a few KB
+constexpr size_t MAX_PAGE_RECORD_SIZE = 64 * 1024;
+}  // namespace
+
 void PageLine::render(GfxRenderer& renderer, const int fontId, const int xOffset, const int yOffset) {
   block->render(renderer, fontId, xPos + xOffset, yPos + yOffset);
 }
 
-bool PageLine::serialize(FsFile& file) {
-  serialization::writePod(file, xPos);
-  serialization::writePod(file, yPos);
+void PageLine::serialize(std::vector<uint8_t>& out) const {
+  serialization::appendPod(out, xPos);
+  serialization::appendPod(out, yPos);
 
   // serialize TextBlock pointed to by PageLine
-  return block->serialize(file);
+  block->serialize(out);
 }
 
-std::unique_ptr<PageLine> PageLine::deserialize(FsFile& file) {
+std::unique_ptr<PageLine> PageLine::deserialize(const std::shared_ptr<const uint8_t>& storage, const uint8_t*& cursor,
+                                                const uint8_t* end) {
   int16_t xPos;
   int16_t yPos;
-  serialization::readPod(file, xPos);
-  serialization::readPod(file, yPos);
+  if (!serialization::readPod(cursor, end, xPos) || !serialization::readPod(cursor, end, yPos)) {
+    return nullptr;
+  }
 
-  auto tb = TextBlock::deserialize(file);
+  auto tb = TextBlock::deserialize(storage, cursor, end);
+  if (!tb) {
+    return nullptr;
+  }
   return std::unique_ptr<PageLine>(new PageLine(std::move(tb), xPos, yPos));
 }
 
@@ -41,26 +53,28 @@ void PageImage::render(GfxRenderer& renderer, int /*fontId*/, const int xOffset,
   file.close();
 }
 
-bool PageImage::serialize(FsFile& file) {
-  serialization::writePod(file, xPos);
-  serialization::writePod(file, yPos);
-  serialization::writePod(file, width);
-  serialization::writePod(file, height);
-  serialization::writeString(file, bmpPath);
-  return true;
+void PageImage::serialize(std::vector<uint8_t>& out) const {
+  serialization::appendPod(out, xPos);
+  serialization::appendPod(out, yPos);
+  serialization::appendPod(out, width);
+  serialization::appendPod(out, height);
+  serialization::appendVarint(out, bmpPath.size());
+  out.insert(out.end(), bmpPath.begin(), bmpPath.end());
 }
 
-std::unique_ptr<PageImage> PageImage::deserialize(FsFile& file) {
+std::unique_ptr<PageImage> PageImage::deserialize(const uint8_t*& cursor, const uint8_t* end) {
   int16_t xPos;
   int16_t yPos;
   uint16_t width;
   uint16_t height;
-  std::string bmpPath;
-  serialization::readPod(file, xPos);
-  serialization::readPod(file, yPos);
-  serialization::readPod(file, width);
-  serialization::readPod(file, height);
-  serialization::readString(file, bmpPath);
+  uint32_t pathSize;
+  if (!serialization::readPod(cursor, end, xPos) || !serialization::readPod(cursor, end, yPos) ||
+      !serialization::readPod(cursor, end, width) || !serialization::readPod(cursor, end, height) ||
+      !serialization::readVarint(cursor, end, pathSize) || static_cast<uint32_t>(end - cursor) < pathSize) {
+    return nullptr;
+  }
+  std::string bmpPath(reinterpret_cast<const char*>(cursor), pathSize);
+  cursor += pathSize;
   return std::unique_ptr<PageImage>(new PageImage(std::move(bmpPath), xPos, yPos, width, height));
 }
 
@@ -80,34 +94,67 @@ bool Page::hasImages() const {
 }
 
 bool Page::serialize(FsFile& file) const {
-  const uint16_t count = elements.size();
-  serialization::writePod(file, count);
+  std::vector<uint8_t> out;
+  serialization::appendPod(out, static_cast<uint16_t>(elements.size()));
 
   for (const auto& el : elements) {
-    serialization::writePod(file, static_cast<uint8_t>(el->tag()));
-    if (!el->serialize(file)) {
-      return false;
-    }
+    serialization::appendPod(out, static_cast<uint8_t>(el->tag()));
+    el->serialize(out);
   }
 
-  return true;
+  return file.write(out.data(), out.size()) == out.size();
 }
 
-std::unique_ptr<Page> Page::deserialize(FsFile& file) {
+std::unique_ptr<Page> Page::deserialize(FsFile& file, const size_t size) {
+  if (size < sizeof(uint16_t) || size > MAX_PAGE_RECORD_SIZE) {
+    Serial.printf("[%lu] [PGE] Deserialization failed: bad page size %u\n", millis(), static_cast<uint32_t>(size));
+    return nullptr;
+  }
+
+  // One read for the whole page; the lines keep the buffer alive and render straight out of it
+  const auto buffer =
+      std::shared_ptr<const uint8_t>(new (std::nothrow) uint8_t[size], std::default_delete<uint8_t[]>());
+  if (!buffer) {
+    Serial.printf("[%lu] [PGE] Deserialization failed: could not allocate %u bytes\n", millis(),
+                  static_cast<uint32_t>(size));
+    return nullptr;
+  }
+  if (file.read(const_cast<uint8_t*>(buffer.get()), size) != static_cast<int>(size)) {
+    Serial.printf("[%lu] [PGE] Deserialization failed: short read\n", millis());
+    return nullptr;
+  }
+
+  const uint8_t* cursor = buffer.get();
+  const uint8_t* end = cursor + size;
   auto page = std::unique_ptr<Page>(new Page());
 
   uint16_t count;
-  serialization::readPod(file, count);
+  if (!serialization::readPod(cursor, end, count)) {
+    Serial.printf("[%lu] [PGE] Deserialization failed: truncated page\n", millis());
+    return nullptr;
+  }
+  page->elements.reserve(count);
 
   for (uint16_t i = 0; i < count; i++) {
     uint8_t tag;
-    serialization::readPod(file, tag);
+    if (!serialization::readPod(cursor, end, tag)) {
+      Serial.printf("[%lu] [PGE] Deserialization failed: truncated page\n", millis());
+      return nullptr;
+    }
 
     if (tag == TAG_PageLine) {
-      auto pl = PageLine::deserialize(file);
+      auto pl = PageLine::deserialize(buffer, cursor, end);
+      if (!pl) {
+        Serial.printf("[%lu] [PGE] Deserialization failed: bad line %u\n", millis(), i);
+        return nullptr;
+      }
       page->elements.push_back(std::move(pl));
     } else if (tag == TAG_PageImage) {
-      auto pi = PageImage::deserialize(file);
+      auto pi = PageImage::deserialize(cursor, end);
+      if (!pi) {
+        Serial.printf("[%lu] [PGE] Deserialization failed: bad image %u\n", millis(), i);
+        return nullptr;
+      }
       page->elements.push_back(std::move(pi));
     } else {
       Serial.printf("[%lu] [PGE] Deserialization failed: Unknown tag %u\n", millis(), tag);
@@ -115,5 +162,12 @@ std::unique_ptr<Page> Page::deserialize(FsFile& file) {
     }
   }
 
+  // The LUT gives the record's exact extent, anything left over means the count or an element is off
+  if (cursor != end) {
+    Serial.printf("[%lu] [PGE] Deserialization failed: %u trailing bytes\n", millis(),
+                  static_cast<uint32_t>(end - cursor));
+    return nullptr;
+  }
+
   return page;
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <SdFat.h>
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,7 +21,7 @@ class PageElement {
   explicit PageElement(const int16_t xPos, const int16_t yPos) : xPos(xPos), yPos(yPos) {}
   virtual ~PageElement() = default;
   virtual void render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset) = 0;
-  virtual bool serialize(FsFile& file) = 0;
+  virtual void serialize(std::vector<uint8_t>& out) const = 0;
   [[nodiscard]] virtual uint8_t tag() const = 0;
 };
 
@@ -32,9 +33,10 @@ class PageLine final : public PageElement {
   PageLine(std::shared_ptr<TextBlock> block, const int16_t xPos, const int16_t yPos)
       : PageElement(xPos, yPos), block(std::move(block)) {}
   void render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset) override;
-  bool serialize(FsFile& file) override;
+  void serialize(std::vector<uint8_t>& out) const override;
   [[nodiscard]] uint8_t tag() const override { return TAG_PageLine; }
-  static std::unique_ptr<PageLine> deserialize(FsFile& file);
+  static std::unique_ptr<PageLine> deserialize(const std::shared_ptr<const uint8_t>& storage, const uint8_t*& cursor,
+                                               const uint8_t* end);
 };
 
 class PageImage final : public PageElement {
@@ -46,11 +48,13 @@ class PageImage final : public PageElement {
   PageImage(std::string bmpPath, const int16_t xPos, const int16_t yPos, const uint16_t width, const uint16_t height)
       : PageElement(xPos, yPos), bmpPath(std::move(bmpPath)), width(width), height(height) {}
   void render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset) override;
-  bool serialize(FsFile& file) override;
+  void serialize(std::vector<uint8_t>& out) const override;
   [[nodiscard]] uint8_t tag() const override { return TAG_PageImage; }
-  static std::unique_ptr<PageImage> deserialize(FsFile& file);
+  static std::unique_ptr<PageImage> deserialize(const uint8_t*& cursor, const uint8_t* end);
 };
 
+// On disk a page is one flat record (element count, then tag + element per element) with no length prefix; the
+// section LUT gives its extent, so loading a page is a single read into one buffer that its lines then point into.
 class Page {
  public:
   // the list of block index and line numbers on this page
@@ -58,5 +62,5 @@ class Page {
   void render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset) const;
   [[nodiscard]] bool hasImages() const;
   bool serialize(FsFile& file) const;
-  static std::unique_ptr<Page> deserialize(FsFile& file);
+  static std::unique_ptr<Page> deserialize(FsFile& file, size_t size);
 };
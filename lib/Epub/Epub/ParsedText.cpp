@@ -5,7 +5,6 @@
 #include <algorithm>
 #include <cmath>
 #include <functional>
-#include <iterator>
 #include <limits>
 #include <vector>
 
@@ -18,42 +17,51 @@ namespace {
 // Soft hyphen byte pattern used throughout EPUBs (UTF-8 for U+00AD).
 constexpr char SOFT_HYPHEN_UTF8[] = "\xC2\xAD";
 constexpr size_t SOFT_HYPHEN_BYTES = 2;
+// Em space put in front of the first word of an indented paragraph.
+constexpr char PARAGRAPH_INDENT_UTF8[] = "\xe2\x80\x83";
+constexpr size_t PARAGRAPH_INDENT_BYTES = 3;
 
-bool containsSoftHyphen(const std::string& word) { return word.find(SOFT_HYPHEN_UTF8) != std::string::npos; }
+}  // namespace
 
-// Removes every soft hyphen in-place so rendered glyphs match measured widths.
-void stripSoftHyphensInPlace(std::string& word) {
-  size_t pos = 0;
-  while ((pos = word.find(SOFT_HYPHEN_UTF8, pos)) != std::string::npos) {
-    word.erase(pos, SOFT_HYPHEN_BYTES);
-  }
+bool ParsedText::shouldIndent() const {
+  return !extraParagraphSpacing && (style == TextBlock::JUSTIFIED || style == TextBlock::LEFT_ALIGN);
 }
 
-// Returns the rendered width for a word while ignoring soft hyphen glyphs and optionally appending a visible hyphen.
-uint16_t measureWordWidth(const GfxRenderer& renderer, const int fontId, const std::string& word,
-                          const EpdFontFamily::Style style, const bool appendHyphen = false) {
-  const bool hasSoftHyphen = containsSoftHyphen(word);
-  if (!hasSoftHyphen && !appendHyphen) {
-    return renderer.getTextWidth(fontId, word.c_str(), style);
-  }
+void ParsedText::addWord(const char* word, const size_t length, const EpdFontFamily::Style fontStyle) {
+  if (length == 0) return;
 
-  std::string sanitized = word;
-  if (hasSoftHyphen) {
-    stripSoftHyphensInPlace(sanitized);
+  const auto offset = static_cast<uint32_t>(arena.size());
+  if (words.empty() && shouldIndent()) {
+    arena.insert(arena.end(), PARAGRAPH_INDENT_UTF8, PARAGRAPH_INDENT_UTF8 + PARAGRAPH_INDENT_BYTES);
   }
-  if (appendHyphen) {
-    sanitized.push_back('-');
-  }
-  return renderer.getTextWidth(fontId, sanitized.c_str(), style);
+  arena.insert(arena.end(), word, word + length);
+  words.push_back({offset, static_cast<uint16_t>(arena.size() - offset), 0, fontStyle, false});
 }
 
-}  // namespace
+void ParsedText::reset(const TextBlock::Style style) {
+  arena.clear();
+  words.clear();
+  this->style = style;
+}
 
-void ParsedText::addWord(std::string word, const EpdFontFamily::Style fontStyle) {
-  if (word.empty()) return;
+// Copies the word as it is rendered: soft hyphens dropped, inserted hyphen appended.
+void ParsedText::appendWordText(const Word& word, std::string& out) const {
+  const char* text = arena.data() + word.offset;
+  const char* end = text + word.length;
+  while (text < end) {
+    const char* softHyphen = std::search(text, end, SOFT_HYPHEN_UTF8, SOFT_HYPHEN_UTF8 + SOFT_HYPHEN_BYTES);
+    out.append(text, softHyphen);
+    text = softHyphen == end ? end : softHyphen + SOFT_HYPHEN_BYTES;
+  }
+  if (word.appendHyphen) {
+    out.push_back('-');
+  }
+}
 
-  words.push_back(std::move(word));
-  wordStyles.push_back(fontStyle);
+uint16_t ParsedText::measureWord(const GfxRenderer& renderer, const int fontId, const Word& word) {
+  wordScratch.clear();
+  appendWordText(word, wordScratch);
+  return renderer.getTextWidth(fontId, wordScratch.c_str(), word.style);
 }
 
 // Consumes data to minimize memory usage
@@ -64,55 +72,58 @@ void ParsedText::layoutAndExtractLines(const GfxRenderer& renderer, const int fo
     return;
   }
 
-  // Apply fixed transforms before any per-line layout work.
-  applyParagraphIndent();
-
   const int pageWidth = viewportWidth;
   const int spaceWidth = renderer.getSpaceWidth(fontId);
-  auto wordWidths = calculateWordWidths(renderer, fontId);
+  calculateWordWidths(renderer, fontId);
   std::vector<size_t> lineBreakIndices;
   if (hyphenationEnabled) {
     // Use greedy layout that can split words mid-loop when a hyphenated prefix fits.
-    lineBreakIndices = computeHyphenatedLineBreaks(renderer, fontId, pageWidth, spaceWidth, wordWidths);
+    lineBreakIndices = computeHyphenatedLineBreaks(renderer, fontId, pageWidth, spaceWidth);
   } else {
-    lineBreakIndices = computeLineBreaks(renderer, fontId, pageWidth, spaceWidth, wordWidths);
+    lineBreakIndices = computeLineBreaks(renderer, fontId, pageWidth, spaceWidth);
   }
   const size_t lineCount = includeLastLine ? lineBreakIndices.size() : lineBreakIndices.size() - 1;
 
   for (size_t i = 0; i < lineCount; ++i) {
-    extractLine(i, pageWidth, spaceWidth, wordWidths, lineBreakIndices, processLine);
+    extractLine(i, pageWidth, spaceWidth, lineBreakIndices, processLine);
   }
+  consumeWords(lineCount > 0 ? lineBreakIndices[lineCount - 1] : 0);
 }
 
-std::vector<uint16_t> ParsedText::calculateWordWidths(const GfxRenderer& renderer, const int fontId) {
-  const size_t totalWordCount = words.size();
-
-  std::vector<uint16_t> wordWidths;
-  wordWidths.reserve(totalWordCount);
-
-  auto wordsIt = words.begin();
-  auto wordStylesIt = wordStyles.begin();
-
-  while (wordsIt != words.end()) {
-    wordWidths.push_back(measureWordWidth(renderer, fontId, *wordsIt, *wordStylesIt));
+// Drops the first count words and slides the remaining bytes down to the start of the arena.
+void ParsedText::consumeWords(const size_t count) {
+  if (count >= words.size()) {
+    reset(style);
+    return;
+  }
+  if (count == 0) {
+    return;
+  }
 
-    std::advance(wordsIt, 1);
-    std::advance(wordStylesIt, 1);
+  words.erase(words.begin(), words.begin() + count);
+  const uint32_t base = words.front().offset;
+  arena.erase(arena.begin(), arena.begin() + base);
+  for (auto& word : words) {
+    word.offset -= base;
   }
+}
 
-  return wordWidths;
+void ParsedText::calculateWordWidths(const GfxRenderer& renderer, const int fontId) {
+  for (auto& word : words) {
+    word.width = measureWord(renderer, fontId, word);
+  }
 }
 
 std::vector<size_t> ParsedText::computeLineBreaks(const GfxRenderer& renderer, const int fontId, const int pageWidth,
-                                                  const int spaceWidth, std::vector<uint16_t>& wordWidths) {
+                                                  const int spaceWidth) {
   if (words.empty()) {
     return {};
   }
 
   // Ensure any word that would overflow even as the first entry on a line is split using fallback hyphenation.
-  for (size_t i = 0; i < wordWidths.size(); ++i) {
-    while (wordWidths[i] > pageWidth) {
-      if (!hyphenateWordAtIndex(i, pageWidth, renderer, fontId, wordWidths, /*allowFallbackBreaks=*/true)) {
+  for (size_t i = 0; i < words.size(); ++i) {
+    while (words[i].width > pageWidth) {
+      if (!hyphenateWordAtIndex(i, pageWidth, renderer, fontId, /*allowFallbackBreaks=*/true)) {
         break;
       }
     }
@@ -135,7 +146,7 @@ std::vector<size_t> ParsedText::computeLineBreaks(const GfxRenderer& renderer, c
 
     for (size_t j = i; j < totalWordCount; ++j) {
       // Current line length: previous width + space + current word width
-      currlen += wordWidths[j] + spaceWidth;
+      currlen += words[j].width + spaceWidth;
 
       if (currlen > pageWidth) {
         break;
@@ -195,32 +206,21 @@ std::vector<size_t> ParsedText::computeLineBreaks(const GfxRenderer& renderer, c
   return lineBreakIndices;
 }
 
-void ParsedText::applyParagraphIndent() {
-  if (extraParagraphSpacing || words.empty()) {
-    return;
-  }
-
-  if (style == TextBlock::JUSTIFIED || style == TextBlock::LEFT_ALIGN) {
-    words.front().insert(0, "\xe2\x80\x83");
-  }
-}
-
 // Builds break indices while opportunistically splitting the word that would overflow the current line.
 std::vector<size_t> ParsedText::computeHyphenatedLineBreaks(const GfxRenderer& renderer, const int fontId,
-                                                            const int pageWidth, const int spaceWidth,
-                                                            std::vector<uint16_t>& wordWidths) {
+                                                            const int pageWidth, const int spaceWidth) {
   std::vector<size_t> lineBreakIndices;
   size_t currentIndex = 0;
 
-  while (currentIndex < wordWidths.size()) {
+  while (currentIndex < words.size()) {
     const size_t lineStart = currentIndex;
     int lineWidth = 0;
 
     // Consume as many words as possible for current line, splitting when prefixes fit
-    while (currentIndex < wordWidths.size()) {
+    while (currentIndex < words.size()) {
       const bool isFirstWord = currentIndex == lineStart;
       const int spacing = isFirstWord ? 0 : spaceWidth;
-      const int candidateWidth = spacing + wordWidths[currentIndex];
+      const int candidateWidth = spacing + words[currentIndex].width;
 
       // Word fits on current line
       if (lineWidth + candidateWidth <= pageWidth) {
@@ -234,9 +234,9 @@ std::vector<size_t> ParsedText::computeHyphenatedLineBreaks(const GfxRenderer& r
       const bool allowFallbackBreaks = isFirstWord;  // Only for first word on line
 
       if (availableWidth > 0 &&
-          hyphenateWordAtIndex(currentIndex, availableWidth, renderer, fontId, wordWidths, allowFallbackBreaks)) {
+          hyphenateWordAtIndex(currentIndex, availableWidth, renderer, fontId, allowFallbackBreaks)) {
         // Prefix now fits; append it to this line and move to next line
-        lineWidth += spacing + wordWidths[currentIndex];
+        lineWidth += spacing + words[currentIndex].width;
         ++currentIndex;
         break;
       }
@@ -256,26 +256,19 @@ std::vector<size_t> ParsedText::computeHyphenatedLineBreaks(const GfxRenderer& r
 }
 
 // Splits words[wordIndex] into prefix (adding a hyphen only when needed) and remainder when a legal breakpoint fits the
-// available width.
+// available width. Both halves stay slices of the same arena bytes.
 bool ParsedText::hyphenateWordAtIndex(const size_t wordIndex, const int availableWidth, const GfxRenderer& renderer,
-                                      const int fontId, std::vector<uint16_t>& wordWidths,
-                                      const bool allowFallbackBreaks) {
+                                      const int fontId, const bool allowFallbackBreaks) {
   // Guard against invalid indices or zero available width before attempting to split.
   if (availableWidth <= 0 || wordIndex >= words.size()) {
     return false;
   }
 
-  // Get iterators to target word and style.
-  auto wordIt = words.begin();
-  auto styleIt = wordStyles.begin();
-  std::advance(wordIt, wordIndex);
-  std::advance(styleIt, wordIndex);
-
-  const std::string& word = *wordIt;
-  const auto style = *styleIt;
+  const Word word = words[wordIndex];
+  const std::string text(arena.data() + word.offset, word.length);
 
   // Collect candidate breakpoints (byte offsets and hyphen requirements).
-  auto breakInfos = Hyphenator::breakOffsets(word, allowFallbackBreaks);
+  auto breakInfos = Hyphenator::breakOffsets(text, allowFallbackBreaks);
   if (breakInfos.empty()) {
     return false;
   }
@@ -287,12 +280,13 @@ bool ParsedText::hyphenateWordAtIndex(const size_t wordIndex, const int availabl
   // Iterate over each legal breakpoint and retain the widest prefix that still fits.
   for (const auto& info : breakInfos) {
     const size_t offset = info.byteOffset;
-    if (offset == 0 || offset >= word.size()) {
+    if (offset == 0 || offset >= text.size()) {
       continue;
     }
 
     const bool needsHyphen = info.requiresInsertedHyphen;
-    const int prefixWidth = measureWordWidth(renderer, fontId, word.substr(0, offset), style, needsHyphen);
+    const int prefixWidth =
+        measureWord(renderer, fontId, {word.offset, static_cast<uint16_t>(offset), 0, word.style, needsHyphen});
     if (prefixWidth > availableWidth || prefixWidth <= chosenWidth) {
       continue;  // Skip if too wide or not an improvement
     }
@@ -307,28 +301,20 @@ bool ParsedText::hyphenateWordAtIndex(const size_t wordIndex, const int availabl
     return false;
   }
 
-  // Split the word at the selected breakpoint and append a hyphen if required.
-  std::string remainder = word.substr(chosenOffset);
-  wordIt->resize(chosenOffset);
-  if (chosenNeedsHyphen) {
-    wordIt->push_back('-');
-  }
-
-  // Insert the remainder word (with matching style) directly after the prefix.
-  auto insertWordIt = std::next(wordIt);
-  auto insertStyleIt = std::next(styleIt);
-  words.insert(insertWordIt, remainder);
-  wordStyles.insert(insertStyleIt, style);
-
-  // Update cached widths to reflect the new prefix/remainder pairing.
-  wordWidths[wordIndex] = static_cast<uint16_t>(chosenWidth);
-  const uint16_t remainderWidth = measureWordWidth(renderer, fontId, remainder, style);
-  wordWidths.insert(wordWidths.begin() + wordIndex + 1, remainderWidth);
+  // Shrink the word to the selected prefix and insert the remainder (with matching style) directly after it.
+  Word remainder = {word.offset + static_cast<uint32_t>(chosenOffset),
+                    static_cast<uint16_t>(word.length - chosenOffset), 0, word.style, word.appendHyphen};
+  remainder.width = measureWord(renderer, fontId, remainder);
+  Word& prefix = words[wordIndex];
+  prefix.length = static_cast<uint16_t>(chosenOffset);
+  prefix.width = static_cast<uint16_t>(chosenWidth);
+  prefix.appendHyphen = chosenNeedsHyphen;
+  words.insert(words.begin() + wordIndex + 1, remainder);
   return true;
 }
 
 void ParsedText::extractLine(const size_t breakIndex, const int pageWidth, const int spaceWidth,
-                             const std::vector<uint16_t>& wordWidths, const std::vector<size_t>& lineBreakIndices,
+                             const std::vector<size_t>& lineBreakIndices,
                              const std::function<void(std::shared_ptr<TextBlock>)>& processLine) {
   const size_t lineBreak = lineBreakIndices[breakIndex];
   const size_t lastBreakAt = breakIndex > 0 ? lineBreakIndices[breakIndex - 1] : 0;
@@ -337,7 +323,7 @@ void ParsedText::extractLine(const size_t breakIndex, const int pageWidth, const
   // Calculate total word width for this line
   int lineWordWidthSum = 0;
   for (size_t i = lastBreakAt; i < lineBreak; i++) {
-    lineWordWidthSum += wordWidths[i];
+    lineWordWidthSum += words[i].width;
   }
 
   // Calculate spacing
@@ -358,31 +344,18 @@ void ParsedText::extractLine(const size_t breakIndex, const int pageWidth, const
     xpos = (spareSpace - (lineWordCount - 1) * spaceWidth) / 2;
   }
 
-  // Pre-calculate X positions for words
-  std::list<uint16_t> lineXPos;
+  // Gather the line's words, x positions and styles; the words themselves are consumed once all lines are out
+  lineText.clear();
+  lineXPos.clear();
+  lineStyles.clear();
   for (size_t i = lastBreakAt; i < lineBreak; i++) {
-    const uint16_t currentWordWidth = wordWidths[i];
+    const Word& word = words[i];
+    appendWordText(word, lineText);
+    lineText.push_back('\0');
     lineXPos.push_back(xpos);
-    xpos += currentWordWidth + spacing;
+    lineStyles.push_back(word.style);
+    xpos += word.width + spacing;
   }
 
-  // Iterators always start at the beginning as we are moving content with splice below
-  auto wordEndIt = words.begin();
-  auto wordStyleEndIt = wordStyles.begin();
-  std::advance(wordEndIt, lineWordCount);
-  std::advance(wordStyleEndIt, lineWordCount);
-
-  // *** CRITICAL STEP: CONSUME DATA USING SPLICE ***
-  std::list<std::string> lineWords;
-  lineWords.splice(lineWords.begin(), words, words.begin(), wordEndIt);
-  std::list<EpdFontFamily::Style> lineWordStyles;
-  lineWordStyles.splice(lineWordStyles.begin(), wordStyles, wordStyles.begin(), wordStyleEndIt);
-
-  for (auto& word : lineWords) {
-    if (containsSoftHyphen(word)) {
-      stripSoftHyphensInPlace(word);
-    }
-  }
-
-  processLine(std::make_shared<TextBlock>(std::move(lineWords), std::move(lineXPos), std::move(lineWordStyles), style));
-}
\ No newline at end of file
+  processLine(std::make_shared<TextBlock>(lineText, lineXPos, lineStyles, style));
+}
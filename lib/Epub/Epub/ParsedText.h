@@ -3,7 +3,6 @@
 #include <EpdFontFamily.h>
 
 #include <functional>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,24 +11,43 @@
 
 class GfxRenderer;
 
+// Words of one paragraph waiting to be broken into lines.
+// Word bytes are bumped into a single arena and the words themselves are flat slices into it, so a paragraph costs
+// two growing buffers instead of a heap node per word. reset() keeps both capacities for the next paragraph.
 class ParsedText {
-  std::list<std::string> words;
-  std::list<EpdFontFamily::Style> wordStyles;
+  struct Word {
+    uint32_t offset;
+    uint16_t length;
+    uint16_t width;
+    EpdFontFamily::Style style;
+    // Set on hyphenation prefixes that need a visible hyphen after the slice
+    bool appendHyphen;
+  };
+
+  std::vector<char> arena;
+  std::vector<Word> words;
   TextBlock::Style style;
   bool extraParagraphSpacing;
   bool hyphenationEnabled;
 
-  void applyParagraphIndent();
-  std::vector<size_t> computeLineBreaks(const GfxRenderer& renderer, int fontId, int pageWidth, int spaceWidth,
-                                        std::vector<uint16_t>& wordWidths);
+  // Scratch buffers reused across words and lines
+  std::string wordScratch;
+  std::string lineText;
+  std::vector<uint16_t> lineXPos;
+  std::vector<EpdFontFamily::Style> lineStyles;
+
+  bool shouldIndent() const;
+  void appendWordText(const Word& word, std::string& out) const;
+  uint16_t measureWord(const GfxRenderer& renderer, int fontId, const Word& word);
+  std::vector<size_t> computeLineBreaks(const GfxRenderer& renderer, int fontId, int pageWidth, int spaceWidth);
   std::vector<size_t> computeHyphenatedLineBreaks(const GfxRenderer& renderer, int fontId, int pageWidth,
-                                                  int spaceWidth, std::vector<uint16_t>& wordWidths);
+                                                  int spaceWidth);
   bool hyphenateWordAtIndex(size_t wordIndex, int availableWidth, const GfxRenderer& renderer, int fontId,
-                            std::vector<uint16_t>& wordWidths, bool allowFallbackBreaks);
-  void extractLine(size_t breakIndex, int pageWidth, int spaceWidth, const std::vector<uint16_t>& wordWidths,
-                   const std::vector<size_t>& lineBreakIndices,
+                            bool allowFallbackBreaks);
+  void extractLine(size_t breakIndex, int pageWidth, int spaceWidth, const std::vector<size_t>& lineBreakIndices,
                    const std::function<void(std::shared_ptr<TextBlock>)>& processLine);
-  std::vector<uint16_t> calculateWordWidths(const GfxRenderer& renderer, int fontId);
+  void calculateWordWidths(const GfxRenderer& renderer, int fontId);
+  void consumeWords(size_t count);
 
  public:
   explicit ParsedText(const TextBlock::Style style, const bool extraParagraphSpacing,
@@ -37,7 +55,9 @@ class ParsedText {
       : style(style), extraParagraphSpacing(extraParagraphSpacing), hyphenationEnabled(hyphenationEnabled) {}
   ~ParsedText() = default;
 
-  void addWord(std::string word, EpdFontFamily::Style fontStyle);
+  void addWord(const char* word, size_t length, EpdFontFamily::Style fontStyle);
+  // Drops all words but keeps the allocated storage, for reuse by the next paragraph
+  void reset(TextBlock::Style style);
   void setStyle(const TextBlock::Style style) { this->style = style; }
   TextBlock::Style getStyle() const { return style; }
   size_t size() const { return words.size(); }
@@ -45,4 +65,4 @@ class ParsedText {
   void layoutAndExtractLines(const GfxRenderer& renderer, int fontId, uint16_t viewportWidth,
                              const std::function<void(std::shared_ptr<TextBlock>)>& processLine,
                              bool includeLastLine = true);
-};
\ No newline at end of file
+};
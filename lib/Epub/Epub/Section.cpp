@@ -5,20 +5,39 @@
 #include <JpegToBmpConverter.h>
 #include <SDCardManager.h>
 #include <Serialization.h>
+#include <Trace.h>
 
 #include <algorithm>
 #include <cctype>
 #include <cstring>
 
+#include "ChapterPageBuilder.h"
+#include "ChapterTokens.h"
 #include "Page.h"
 #include "hyphenation/Hyphenator.h"
 #include "parsers/ChapterHtmlSlimParser.h"
 
 namespace {
-constexpr uint8_t SECTION_FILE_VERSION = 11;
+constexpr uint8_t SECTION_FILE_VERSION = 12;
 constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(int) + sizeof(float) + sizeof(bool) + sizeof(uint8_t) +
                                  sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(bool) +
                                  sizeof(uint32_t);
+// Minimum chapter size (in bytes) to show indexing popup - smaller chapters don't benefit from it
+constexpr size_t MIN_SIZE_FOR_POPUP = 50 * 1024;  // 50KB
+
+// Sits between the inflater and the chapter parser so a background build can yield or be cancelled per chunk
+class InterruptiblePrint final : public Print {
+  Print& out;
+  const std::function<bool()>& continueFn;
+
+ public:
+  InterruptiblePrint(Print& out, const std::function<bool()>& continueFn) : out(out), continueFn(continueFn) {}
+  size_t write(const uint8_t data) override { return write(&data, 1); }
+  size_t write(const uint8_t* buffer, const size_t size) override {
+    // A short write makes the zip stream give up, which unwinds the parse
+    return continueFn() ? out.write(buffer, size) : 0;
+  }
+};
 
 std::string toLower(const std::string& input) {
   std::string out = input;
@@ -261,13 +280,35 @@ bool Section::loadSectionFile(const int fontId, const float lineCompression, con
   }
 
   serialization::readPod(file, pageCount);
-  file.close();
+  uint32_t lutOffset;
+  serialization::readPod(file, lutOffset);
+
+  // Keep the LUT in RAM and the file open, so a page turn is a single seek
+  pageLut.resize(pageCount);
+  const size_t lutSize = sizeof(uint32_t) * pageCount;
+  if (!file.seek(lutOffset) ||
+      file.read(reinterpret_cast<uint8_t*>(pageLut.data()), lutSize) != static_cast<int>(lutSize)) {
+    file.close();
+    pageLut.clear();
+    Serial.printf("[%lu] [SCT] Deserialization failed: Truncated LUT\n", millis());
+    clearCache();
+    return false;
+  }
+  pageLut.push_back(lutOffset);
+  pageCache.clear();
+
   Serial.printf("[%lu] [SCT] Deserialization succeeded: %d pages\n", millis(), pageCount);
   return true;
 }
 
 // Your updated class method (assuming you are using the 'SD' object, which is a wrapper for a specific filesystem)
-bool Section::clearCache() const {
+bool Section::clearCache() {
+  if (file) {
+    file.close();
+  }
+  pageLut.clear();
+  pageCache.clear();
+
   if (!SdMan.exists(filePath.c_str())) {
     Serial.printf("[%lu] [SCT] Cache does not exist, no action needed\n", millis());
     return true;
@@ -282,78 +323,104 @@ bool Section::clearCache() const {
   return true;
 }
 
+bool Section::tokenizeChapter(const uint16_t viewportWidth, const uint16_t viewportHeight,
+                              const std::function<bool()>& continueFn) {
+  const auto localPath = epub->getSpineItem(spineIndex).href;
+
+  FsFile tokenFile;
+  if (!SdMan.openFileForWrite("SCT", tokenPath, tokenFile)) {
+    return false;
+  }
+  ChapterTokens::Writer tokens(tokenFile);
+
+  // Chapter bytes go straight from the inflater into expat, nothing is staged on the SD card
+  ChapterHtmlSlimParser visitor(
+      [this, &localPath, &continueFn](Print& out) {
+        if (!continueFn) {
+          return epub->readItemContentsToStream(localPath, out, 1024);
+        }
+        InterruptiblePrint interruptible(out, continueFn);
+        return epub->readItemContentsToStream(localPath, interruptible, 1024);
+      },
+      tokens,
+      [this, localPath, viewportWidth, viewportHeight](const std::string& src, std::string& outBmpPath, uint16_t& outW,
+                                                       uint16_t& outH) {
+        return resolveEpubImageToBmp(epub, localPath, src, viewportWidth, viewportHeight, outBmpPath, outW, outH);
+      });
+  const bool success = visitor.parseAndTokenize() && tokens.finish();
+  tokenFile.close();
+
+  if (!success) {
+    Serial.printf("[%lu] [SCT] Failed to tokenize chapter\n", millis());
+    SdMan.remove(tokenPath.c_str());
+    return false;
+  }
+  return true;
+}
+
 bool Section::createSectionFile(const int fontId, const float lineCompression, const bool extraParagraphSpacing,
                                 const uint8_t paragraphAlignment, const uint16_t viewportWidth,
                                 const uint16_t viewportHeight, const bool hyphenationEnabled,
-                                const std::function<void()>& popupFn) {
-  const auto localPath = epub->getSpineItem(spineIndex).href;
-  const auto tmpHtmlPath = epub->getCachePath() + "/.tmp_" + std::to_string(spineIndex) + ".html";
-
+                                const std::function<void()>& popupFn, const std::function<bool()>& continueFn) {
+  TRACE_SCOPE("epub", "section_build");
   // Create cache directory if it doesn't exist
   {
     const auto sectionsDir = epub->getCachePath() + "/sections";
     SdMan.mkdir(sectionsDir.c_str());
   }
 
-  // Retry logic for SD card timing issues
-  bool success = false;
-  uint32_t fileSize = 0;
-  for (int attempt = 0; attempt < 3 && !success; attempt++) {
-    if (attempt > 0) {
-      Serial.printf("[%lu] [SCT] Retrying stream (attempt %d)...\n", millis(), attempt + 1);
-      delay(50);  // Brief delay before retry
-    }
+  // Inflated size is already known from the spine, no need to walk the central directory again
+  const size_t chapterSize = epub->getCumulativeSpineItemSize(spineIndex) -
+                             (spineIndex > 0 ? epub->getCumulativeSpineItemSize(spineIndex - 1) : 0);
+  if (popupFn && chapterSize >= MIN_SIZE_FOR_POPUP) {
+    popupFn();
+  }
 
-    // Remove any incomplete file from previous attempt before retrying
-    if (SdMan.exists(tmpHtmlPath.c_str())) {
-      SdMan.remove(tmpHtmlPath.c_str());
+  // Only the first layout of a chapter inflates and parses it, later ones replay the cached tokens
+  FsFile tokenFile;
+  ChapterTokens::Reader tokens(tokenFile, continueFn);
+  if (SdMan.openFileForRead("SCT", tokenPath, tokenFile) && tokens.begin()) {
+    Serial.printf("[%lu] [SCT] Reusing tokenized chapter\n", millis());
+  } else {
+    if (tokenFile) {
+      tokenFile.close();
     }
-
-    FsFile tmpHtml;
-    if (!SdMan.openFileForWrite("SCT", tmpHtmlPath, tmpHtml)) {
-      continue;
+    if (!tokenizeChapter(viewportWidth, viewportHeight, continueFn)) {
+      return false;
     }
-    success = epub->readItemContentsToStream(localPath, tmpHtml, 1024);
-    fileSize = tmpHtml.size();
-    tmpHtml.close();
-
-    // If streaming failed, remove the incomplete file immediately
-    if (!success && SdMan.exists(tmpHtmlPath.c_str())) {
-      SdMan.remove(tmpHtmlPath.c_str());
-      Serial.printf("[%lu] [SCT] Removed incomplete temp file after failed attempt\n", millis());
+    if (!SdMan.openFileForRead("SCT", tokenPath, tokenFile)) {
+      return false;
+    }
+    if (!tokens.begin()) {
+      tokenFile.close();
+      return false;
     }
   }
 
-  if (!success) {
-    Serial.printf("[%lu] [SCT] Failed to stream item contents to temp file after retries\n", millis());
-    return false;
-  }
-
-  Serial.printf("[%lu] [SCT] Streamed temp HTML to %s (%d bytes)\n", millis(), tmpHtmlPath.c_str(), fileSize);
-
   if (!SdMan.openFileForWrite("SCT", filePath, file)) {
+    tokenFile.close();
     return false;
   }
   writeSectionFileHeader(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
                          viewportHeight, hyphenationEnabled);
   std::vector<uint32_t> lut = {};
 
-  ChapterHtmlSlimParser visitor(
-      tmpHtmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
-      viewportHeight, hyphenationEnabled,
-      [this, &lut](std::unique_ptr<Page> page) { lut.emplace_back(this->onPageComplete(std::move(page))); }, popupFn,
-      [this, localPath, viewportWidth, viewportHeight](const std::string& src, std::string& outBmpPath, uint16_t& outW,
-                                                       uint16_t& outH) {
-        return resolveEpubImageToBmp(epub, localPath, src, viewportWidth, viewportHeight, outBmpPath, outW, outH);
-      });
+  ChapterPageBuilder builder(
+      renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth, viewportHeight,
+      hyphenationEnabled,
+      [this, &lut](std::unique_ptr<Page> page) { lut.emplace_back(this->onPageComplete(std::move(page))); });
   Hyphenator::setPreferredLanguage(epub->getLanguage());
-  success = visitor.parseAndBuildPages();
+  const bool success = builder.buildPages(tokens);
+  tokenFile.close();
 
-  SdMan.remove(tmpHtmlPath.c_str());
   if (!success) {
-    Serial.printf("[%lu] [SCT] Failed to parse XML and build pages\n", millis());
+    Serial.printf("[%lu] [SCT] Failed to build pages\n", millis());
     file.close();
     SdMan.remove(filePath.c_str());
+    if (!tokens.wasStopped()) {
+      // Unreadable tokens, tokenize again next time
+      SdMan.remove(tokenPath.c_str());
+    }
     return false;
   }
 
@@ -380,23 +447,77 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
   serialization::writePod(file, pageCount);
   serialization::writePod(file, lutOffset);
   file.close();
-  return true;
+
+  pageLut = std::move(lut);
+  pageLut.push_back(lutOffset);
+  pageCache.clear();
+  return SdMan.openFileForRead("SCT", filePath, file);
 }
 
-std::unique_ptr<Page> Section::loadPageFromSectionFile() {
-  if (!SdMan.openFileForRead("SCT", filePath, file)) {
+Section::~Section() {
+  if (file) {
+    file.close();
+  }
+}
+
+std::unique_ptr<Page> Section::readPage(const int index) {
+  if (index < 0 || index + 1 >= static_cast<int>(pageLut.size())) {
+    return nullptr;
+  }
+  if (!file && !SdMan.openFileForRead("SCT", filePath, file)) {
     return nullptr;
   }
 
-  file.seek(HEADER_SIZE - sizeof(uint32_t));
-  uint32_t lutOffset;
-  serialization::readPod(file, lutOffset);
-  file.seek(lutOffset + sizeof(uint32_t) * currentPage);
-  uint32_t pagePos;
-  serialization::readPod(file, pagePos);
-  file.seek(pagePos);
+  if (!file.seek(pageLut[index])) {
+    Serial.printf("[%lu] [SCT] Failed to seek to page %d\n", millis(), index);
+    return nullptr;
+  }
+  return Page::deserialize(file, pageLut[index + 1] - pageLut[index]);
+}
 
-  auto page = Page::deserialize(file);
-  file.close();
+const Page* Section::findCachedPage(const int index) {
+  for (auto it = pageCache.begin(); it != pageCache.end(); ++it) {
+    if (it->index == index) {
+      // Move to the most recently used end
+      std::rotate(it, it + 1, pageCache.end());
+      return pageCache.back().page.get();
+    }
+  }
+  return nullptr;
+}
+
+void Section::cachePage(const int index, std::unique_ptr<Page> page) {
+  if (pageCache.size() >= PAGE_CACHE_SIZE) {
+    pageCache.erase(pageCache.begin());
+  }
+  pageCache.push_back({index, std::move(page)});
+}
+
+std::unique_ptr<Page> Section::loadPageFromSectionFile() {
+  TRACE_SCOPE("epub", "page_load");
+  // Pages only hold shared elements, so handing out a copy of a cached page is cheap
+  if (const Page* cached = findCachedPage(currentPage)) {
+    return std::unique_ptr<Page>(new Page(*cached));
+  }
+
+  auto page = readPage(currentPage);
+  if (!page) {
+    return nullptr;
+  }
+  cachePage(currentPage, std::unique_ptr<Page>(new Page(*page)));
   return page;
 }
+
+void Section::prefetchNeighbourPages() {
+  // Forward first, that is the likely next turn
+  for (const int index : {currentPage + 1, currentPage - 1}) {
+    if (index < 0 || index >= pageCount || findCachedPage(index)) {
+      continue;
+    }
+    auto page = readPage(index);
+    if (!page) {
+      return;
+    }
+    cachePage(index, std::move(page));
+  }
+}
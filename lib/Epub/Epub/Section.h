@@ -1,6 +1,7 @@
 #pragma once
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "Epub.h"
 
@@ -12,11 +13,28 @@ class Section {
   const int spineIndex;
   GfxRenderer& renderer;
   std::string filePath;
+  // Layout-independent tokens of the chapter, survive layout changes that invalidate filePath
+  std::string tokenPath;
+  // Stays open for reading for the life of the section once loaded or built
   FsFile file;
+  // Offset of every page plus the LUT offset, which is where the last page ends
+  std::vector<uint32_t> pageLut;
+
+  // Decoded pages for the current page and its neighbours, least recently used first
+  static constexpr size_t PAGE_CACHE_SIZE = 3;
+  struct CachedPage {
+    int index;
+    std::unique_ptr<Page> page;
+  };
+  std::vector<CachedPage> pageCache;
 
   void writeSectionFileHeader(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                               uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled);
   uint32_t onPageComplete(std::unique_ptr<Page> page);
+  bool tokenizeChapter(uint16_t viewportWidth, uint16_t viewportHeight, const std::function<bool()>& continueFn);
+  std::unique_ptr<Page> readPage(int index);
+  const Page* findCachedPage(int index);
+  void cachePage(int index, std::unique_ptr<Page> page);
 
  public:
   uint16_t pageCount = 0;
@@ -26,13 +44,19 @@ class Section {
       : epub(epub),
         spineIndex(spineIndex),
         renderer(renderer),
-        filePath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".bin") {}
-  ~Section() = default;
+        filePath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".bin"),
+        tokenPath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".tok") {}
+  ~Section();
   bool loadSectionFile(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                        uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled);
-  bool clearCache() const;
+  bool clearCache();
+  // Lays the chapter out from its cached tokens, inflating and tokenizing it first if there are none yet.
+  // continueFn runs between inflated or token chunks (e.g. to yield a shared mutex); returning false aborts the build
   bool createSectionFile(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                          uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled,
-                         const std::function<void()>& popupFn = nullptr);
+                         const std::function<void()>& popupFn = nullptr,
+                         const std::function<bool()>& continueFn = nullptr);
   std::unique_ptr<Page> loadPageFromSectionFile();
+  // Decodes the pages either side of currentPage ahead of time, call after a page has been displayed
+  void prefetchNeighbourPages();
 };
@@ -3,72 +3,157 @@
 #include <GfxRenderer.h>
 #include <Serialization.h>
 
-void TextBlock::render(const GfxRenderer& renderer, const int fontId, const int x, const int y) const {
-  // Validate iterator bounds before rendering
-  if (words.size() != wordXpos.size() || words.size() != wordStyles.size()) {
-    Serial.printf("[%lu] [TXB] Render skipped: size mismatch (words=%u, xpos=%u, styles=%u)\n", millis(),
-                  (uint32_t)words.size(), (uint32_t)wordXpos.size(), (uint32_t)wordStyles.size());
-    return;
-  }
+#include <algorithm>
+#include <cstring>
 
-  auto wordIt = words.begin();
-  auto wordStylesIt = wordStyles.begin();
-  auto wordXposIt = wordXpos.begin();
+namespace {
+// Sanity check: prevent unreasonably large lines (max 10000 words per block)
+constexpr uint32_t MAX_WORDS_PER_BLOCK = 10000;
 
-  for (size_t i = 0; i < words.size(); i++) {
-    renderer.drawText(fontId, *wordXposIt + x, y, wordIt->c_str(), true, *wordStylesIt);
+// x positions are stored as deltas, zigzag keeps a (rare) step back to the left down to a single varint byte too
+uint32_t zigzagEncode(const int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ (value >> 31); }
+int32_t zigzagDecode(const uint32_t value) {
+  return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+}  // namespace
 
-    std::advance(wordIt, 1);
-    std::advance(wordStylesIt, 1);
-    std::advance(wordXposIt, 1);
+TextBlock::TextBlock(const std::string& words, const std::vector<uint16_t>& wordXpos,
+                     const std::vector<EpdFontFamily::Style>& wordStyles, const Style style)
+    : style(style) {
+  const size_t wc = wordXpos.size();
+  if (wc != wordStyles.size() || static_cast<size_t>(std::count(words.begin(), words.end(), '\0')) != wc ||
+      (wc > 0 && words.back() != '\0')) {
+    Serial.printf("[%lu] [TXB] Dropping line: size mismatch (words=%u, xpos=%u, styles=%u)\n", millis(),
+                  (uint32_t)std::count(words.begin(), words.end(), '\0'), (uint32_t)wc, (uint32_t)wordStyles.size());
+    return;
+  }
+
+  std::vector<uint8_t> out;
+  out.reserve(8 + words.size() + wc * 2 + (wc + 3) / 4);
+  serialization::appendVarint(out, wc);
+  serialization::appendPod(out, style);
+  serialization::appendVarint(out, words.size());
+  out.insert(out.end(), words.begin(), words.end());
+  int32_t previousX = 0;
+  for (const uint16_t x : wordXpos) {
+    serialization::appendVarint(out, zigzagEncode(static_cast<int32_t>(x) - previousX));
+    previousX = x;
+  }
+  uint8_t packed = 0;
+  for (size_t i = 0; i < wc; i++) {
+    packed |= (static_cast<uint8_t>(wordStyles[i]) & 0x3) << ((i & 3) * 2);
+    if ((i & 3) == 3) {
+      out.push_back(packed);
+      packed = 0;
+    }
+  }
+  if (wc & 3) {
+    out.push_back(packed);
   }
+
+  // Re-parse our own record so built and loaded lines share one code path
+  const auto buffer = std::shared_ptr<const uint8_t>(new uint8_t[out.size()], std::default_delete<uint8_t[]>());
+  memcpy(const_cast<uint8_t*>(buffer.get()), out.data(), out.size());
+  const uint8_t* cursor = buffer.get();
+  parse(buffer, cursor, buffer.get() + out.size());
 }
 
-bool TextBlock::serialize(FsFile& file) const {
-  if (words.size() != wordXpos.size() || words.size() != wordStyles.size()) {
-    Serial.printf("[%lu] [TXB] Serialization failed: size mismatch (words=%u, xpos=%u, styles=%u)\n", millis(),
-                  words.size(), wordXpos.size(), wordStyles.size());
-    return false;
+void TextBlock::render(const GfxRenderer& renderer, const int fontId, const int x, const int y) const {
+  if (wordCount == 0) {
+    return;
   }
 
-  // Word data
-  serialization::writePod(file, static_cast<uint16_t>(words.size()));
-  for (const auto& w : words) serialization::writeString(file, w);
-  for (auto x : wordXpos) serialization::writePod(file, x);
-  for (auto s : wordStyles) serialization::writePod(file, s);
+  const char* word = reinterpret_cast<const char*>(record + textOffset);
+  const uint8_t* xposCursor = record + xposOffset;
+  const uint8_t* styles = record + stylesOffset;
+  const uint8_t* end = record + recordSize;
+  int32_t wordX = 0;
 
-  // Block style
-  serialization::writePod(file, style);
+  // Bounds were validated when the record was loaded
+  for (uint16_t i = 0; i < wordCount; i++) {
+    uint32_t delta;
+    serialization::readVarint(xposCursor, end, delta);
+    wordX += zigzagDecode(delta);
+    const auto wordStyle = static_cast<EpdFontFamily::Style>((styles[i >> 2] >> ((i & 3) * 2)) & 0x3);
+    renderer.drawText(fontId, wordX + x, y, word, true, wordStyle);
+    word += strlen(word) + 1;
+  }
+}
 
-  return true;
+void TextBlock::serialize(std::vector<uint8_t>& out) const {
+  if (!record) {
+    // Empty line that never got a record, keep the file parseable
+    serialization::appendVarint(out, 0);
+    serialization::appendPod(out, style);
+    serialization::appendVarint(out, 0);
+    return;
+  }
+  out.insert(out.end(), record, record + recordSize);
 }
 
-std::unique_ptr<TextBlock> TextBlock::deserialize(FsFile& file) {
-  uint16_t wc;
-  std::list<std::string> words;
-  std::list<uint16_t> wordXpos;
-  std::list<EpdFontFamily::Style> wordStyles;
-  Style style;
+std::unique_ptr<TextBlock> TextBlock::deserialize(const std::shared_ptr<const uint8_t>& storage,
+                                                  const uint8_t*& cursor, const uint8_t* end) {
+  auto block = std::unique_ptr<TextBlock>(new TextBlock());
+  if (!block->parse(storage, cursor, end)) {
+    return nullptr;
+  }
+  return block;
+}
 
-  // Word count
-  serialization::readPod(file, wc);
+bool TextBlock::parse(const std::shared_ptr<const uint8_t>& storage, const uint8_t*& cursor, const uint8_t* end) {
+  const uint8_t* start = cursor;
+  uint32_t wc;
+  uint8_t blockStyle;
+  uint32_t textSize;
+  if (!serialization::readVarint(cursor, end, wc) || !serialization::readPod(cursor, end, blockStyle) ||
+      !serialization::readVarint(cursor, end, textSize)) {
+    Serial.printf("[%lu] [TXB] Deserialization failed: truncated header\n", millis());
+    return false;
+  }
 
-  // Sanity check: prevent allocation of unreasonably large lists (max 10000 words per block)
-  if (wc > 10000) {
+  if (wc > MAX_WORDS_PER_BLOCK) {
     Serial.printf("[%lu] [TXB] Deserialization failed: word count %u exceeds maximum\n", millis(), wc);
-    return nullptr;
+    return false;
   }
 
-  // Word data
-  words.resize(wc);
-  wordXpos.resize(wc);
-  wordStyles.resize(wc);
-  for (auto& w : words) serialization::readString(file, w);
-  for (auto& x : wordXpos) serialization::readPod(file, x);
-  for (auto& s : wordStyles) serialization::readPod(file, s);
+  // Text must hold exactly one NUL-terminated string per word
+  if (static_cast<uint32_t>(end - cursor) < textSize || (wc > 0 && (textSize == 0 || cursor[textSize - 1] != '\0')) ||
+      static_cast<uint32_t>(std::count(cursor, cursor + textSize, '\0')) != wc) {
+    Serial.printf("[%lu] [TXB] Deserialization failed: malformed text\n", millis());
+    return false;
+  }
+  const uint8_t* text = cursor;
+  cursor += textSize;
 
-  // Block style
-  serialization::readPod(file, style);
+  const uint8_t* xpos = cursor;
+  for (uint32_t i = 0; i < wc; i++) {
+    uint32_t delta;
+    if (!serialization::readVarint(cursor, end, delta)) {
+      Serial.printf("[%lu] [TXB] Deserialization failed: truncated x positions\n", millis());
+      return false;
+    }
+  }
+
+  const uint8_t* styles = cursor;
+  const uint32_t stylesSize = (wc + 3) / 4;
+  if (static_cast<uint32_t>(end - cursor) < stylesSize) {
+    Serial.printf("[%lu] [TXB] Deserialization failed: truncated styles\n", millis());
+    return false;
+  }
+  cursor += stylesSize;
 
-  return std::unique_ptr<TextBlock>(new TextBlock(std::move(words), std::move(wordXpos), std::move(wordStyles), style));
+  if (cursor - start > UINT16_MAX) {
+    Serial.printf("[%lu] [TXB] Deserialization failed: line record too large\n", millis());
+    return false;
+  }
+
+  this->storage = storage;
+  record = start;
+  recordSize = static_cast<uint16_t>(cursor - start);
+  wordCount = static_cast<uint16_t>(wc);
+  textOffset = static_cast<uint16_t>(text - start);
+  xposOffset = static_cast<uint16_t>(xpos - start);
+  stylesOffset = static_cast<uint16_t>(styles - start);
+  style = static_cast<Style>(blockStyle);
+  return true;
 }
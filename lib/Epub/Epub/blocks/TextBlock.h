@@ -1,14 +1,18 @@
 #pragma once
 #include <EpdFontFamily.h>
-#include <SdFat.h>
 
-#include <list>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Block.h"
 
-// Represents a line of text on a page
+// Represents a line of text on a page.
+// The line lives in its serialized form, a flat record that goes to the section file as is:
+//   varint word count, uint8 block style, varint text size, the words as NUL-terminated UTF-8 back to back,
+//   one zigzag varint x delta per word, then the word styles packed 2 bits each (first word in the low bits).
+// Lines loaded from disk point straight into the page buffer, so rendering them copies nothing.
 class TextBlock final : public Block {
  public:
   enum Style : uint8_t {
@@ -19,23 +23,32 @@ class TextBlock final : public Block {
   };
 
  private:
-  std::list<std::string> words;
-  std::list<uint16_t> wordXpos;
-  std::list<EpdFontFamily::Style> wordStyles;
-  Style style;
+  // Keeps the bytes behind record alive, either this line's own copy or the whole page buffer
+  std::shared_ptr<const uint8_t> storage;
+  const uint8_t* record = nullptr;
+  uint16_t recordSize = 0;
+  uint16_t wordCount = 0;
+  uint16_t textOffset = 0;
+  uint16_t xposOffset = 0;
+  uint16_t stylesOffset = 0;
+  Style style = JUSTIFIED;
+
+  TextBlock() = default;
+  bool parse(const std::shared_ptr<const uint8_t>& storage, const uint8_t*& cursor, const uint8_t* end);
 
  public:
-  explicit TextBlock(std::list<std::string> words, std::list<uint16_t> word_xpos,
-                     std::list<EpdFontFamily::Style> word_styles, const Style style)
-      : words(std::move(words)), wordXpos(std::move(word_xpos)), wordStyles(std::move(word_styles)), style(style) {}
+  // words holds one NUL-terminated string per entry of wordXpos/wordStyles, back to back
+  explicit TextBlock(const std::string& words, const std::vector<uint16_t>& wordXpos,
+                     const std::vector<EpdFontFamily::Style>& wordStyles, Style style);
   ~TextBlock() override = default;
-  void setStyle(const Style style) { this->style = style; }
   Style getStyle() const { return style; }
-  bool isEmpty() override { return words.empty(); }
+  bool isEmpty() override { return wordCount == 0; }
   void layout(GfxRenderer& renderer) override {};
   // given a renderer works out where to break the words into lines
   void render(const GfxRenderer& renderer, int fontId, int x, int y) const;
   BlockType getType() override { return TEXT_BLOCK; }
-  bool serialize(FsFile& file) const;
-  static std::unique_ptr<TextBlock> deserialize(FsFile& file);
+  void serialize(std::vector<uint8_t>& out) const;
+  // Validates the record at cursor and returns a view of it inside storage; cursor ends up just past the record
+  static std::unique_ptr<TextBlock> deserialize(const std::shared_ptr<const uint8_t>& storage, const uint8_t*& cursor,
+                                                const uint8_t* end);
 };
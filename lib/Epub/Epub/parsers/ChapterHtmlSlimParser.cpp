@@ -1,20 +1,24 @@
 #include "ChapterHtmlSlimParser.h"
 
-#include <GfxRenderer.h>
 #include <HardwareSerial.h>
-#include <SDCardManager.h>
+#include <MemTrack.h>
 #include <expat.h>
 
 #include <algorithm>
 
-#include "../Page.h"
+namespace {
+// Everything expat allocates while a chapter is parsed counts towards the section build
+void* parserMalloc(const size_t size) { return memtrack::allocate(memtrack::Tag::SectionBuild, size); }
+void* parserRealloc(void* ptr, const size_t size) {
+  return memtrack::reallocate(memtrack::Tag::SectionBuild, ptr, size);
+}
+void parserFree(void* ptr) { memtrack::release(ptr); }
+const XML_Memory_Handling_Suite PARSER_MEMORY = {parserMalloc, parserRealloc, parserFree};
+}  // namespace
 
 const char* HEADER_TAGS[] = {"h1", "h2", "h3", "h4", "h5", "h6"};
 constexpr int NUM_HEADER_TAGS = sizeof(HEADER_TAGS) / sizeof(HEADER_TAGS[0]);
 
-// Minimum file size (in bytes) to show indexing popup - smaller chapters don't benefit from it
-constexpr size_t MIN_SIZE_FOR_POPUP = 50 * 1024;  // 50KB
-
 const char* BLOCK_TAGS[] = {"p", "li", "div", "br", "blockquote"};
 constexpr int NUM_BLOCK_TAGS = sizeof(BLOCK_TAGS) / sizeof(BLOCK_TAGS[0]);
 
@@ -42,7 +46,7 @@ bool matches(const char* tag_name, const char* possible_tags[], const int possib
   return false;
 }
 
-// flush the contents of partWordBuffer to currentTextBlock
+// flush the contents of partWordBuffer to the token stream
 void ChapterHtmlSlimParser::flushPartWordBuffer() {
   // determine font style
   EpdFontFamily::Style fontStyle = EpdFontFamily::REGULAR;
@@ -55,22 +59,14 @@ void ChapterHtmlSlimParser::flushPartWordBuffer() {
   }
   // flush the buffer
   partWordBuffer[partWordBufferIndex] = '\0';
-  currentTextBlock->addWord(partWordBuffer, fontStyle);
+  tokens.word(partWordBuffer, partWordBufferIndex, fontStyle);
   partWordBufferIndex = 0;
 }
 
-// start a new text block if needed
-void ChapterHtmlSlimParser::startNewTextBlock(const TextBlock::Style style) {
-  if (currentTextBlock) {
-    // already have a text block running and it is empty - just reuse it
-    if (currentTextBlock->isEmpty()) {
-      currentTextBlock->setStyle(style);
-      return;
-    }
-
-    makePages();
-  }
-  currentTextBlock.reset(new ParsedText(style, extraParagraphSpacing, hyphenationEnabled));
+// start a new text block, the layout stage merges it into the running one while that is still empty
+void ChapterHtmlSlimParser::startNewTextBlock(const uint8_t style) {
+  currentBlockStyle = style;
+  tokens.block(style);
 }
 
 void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
@@ -123,10 +119,7 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
         if (self->partWordBufferIndex > 0) {
           self->flushPartWordBuffer();
         }
-        if (self->currentTextBlock && !self->currentTextBlock->isEmpty()) {
-          self->makePages();
-        }
-        self->addImageToPage(bmpPath, imageWidth, imageHeight);
+        self->tokens.image(bmpPath, imageWidth, imageHeight);
       }
     }
 
@@ -177,17 +170,17 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
   if (matches(name, BLOCK_TAGS, NUM_BLOCK_TAGS)) {
     if (strcmp(name, "br") == 0) {
       if (self->partWordBufferIndex > 0) {
-        // flush word preceding <br/> to currentTextBlock before calling startNewTextBlock
+        // flush word preceding <br/> before calling startNewTextBlock
         self->flushPartWordBuffer();
       }
-      self->startNewTextBlock(self->currentTextBlock->getStyle());
+      self->startNewTextBlock(self->currentBlockStyle);
       self->depth += 1;
       return;
     }
 
-    self->startNewTextBlock(static_cast<TextBlock::Style>(self->paragraphAlignment));
+    self->startNewTextBlock(ChapterTokens::PARAGRAPH_STYLE);
     if (strcmp(name, "li") == 0) {
-      self->currentTextBlock->addWord("\xe2\x80\xa2", EpdFontFamily::REGULAR);
+      self->tokens.word("\xe2\x80\xa2", 3, EpdFontFamily::REGULAR);
     }
 
     self->depth += 1;
@@ -249,17 +242,6 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
 
     self->partWordBuffer[self->partWordBufferIndex++] = s[i];
   }
-
-  // If we have > 750 words buffered up, perform the layout and consume out all but the last line
-  // There should be enough here to build out 1-2 full pages and doing this will free up a lot of
-  // memory.
-  // Spotted when reading Intermezzo, there are some really long text blocks in there.
-  if (self->currentTextBlock->size() > 750) {
-    Serial.printf("[%lu] [EHP] Text block too long, splitting into multiple pages\n", millis());
-    self->currentTextBlock->layoutAndExtractLines(
-        self->renderer, self->fontId, self->viewportWidth,
-        [self](const std::shared_ptr<TextBlock>& textBlock) { self->addLineToPage(textBlock); }, false);
-  }
 }
 
 void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* name) {
@@ -298,155 +280,88 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
   }
 }
 
-bool ChapterHtmlSlimParser::parseAndBuildPages() {
-  startNewTextBlock((TextBlock::Style)this->paragraphAlignment);
-
-  const XML_Parser parser = XML_ParserCreate(nullptr);
-  int done;
-
-  if (!parser) {
-    Serial.printf("[%lu] [EHP] Couldn't allocate memory for parser\n", millis());
-    return false;
-  }
-
-  FsFile file;
-  if (!SdMan.openFileForRead("EHP", filepath, file)) {
+ChapterHtmlSlimParser::~ChapterHtmlSlimParser() {
+  if (parser) {
+    XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
+    XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
+    XML_SetCharacterDataHandler(parser, nullptr);
     XML_ParserFree(parser);
-    return false;
+    parser = nullptr;
   }
+}
 
-  // Get file size to decide whether to show indexing popup.
-  if (popupFn && file.size() >= MIN_SIZE_FOR_POPUP) {
-    popupFn();
-  }
+size_t ChapterHtmlSlimParser::write(const uint8_t data) { return write(&data, 1); }
 
-  XML_SetUserData(parser, this);
-  XML_SetElementHandler(parser, startElement, endElement);
-  XML_SetCharacterDataHandler(parser, characterData);
+size_t ChapterHtmlSlimParser::write(const uint8_t* buffer, const size_t size) {
+  if (!parser) return 0;
+
+  const uint8_t* currentBufferPos = buffer;
+  auto remainingInBuffer = size;
 
-  do {
+  while (remainingInBuffer > 0) {
     void* const buf = XML_GetBuffer(parser, 1024);
+
     if (!buf) {
       Serial.printf("[%lu] [EHP] Couldn't allocate memory for buffer\n", millis());
       XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
       XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
       XML_SetCharacterDataHandler(parser, nullptr);
       XML_ParserFree(parser);
-      file.close();
-      return false;
-    }
-
-    const size_t len = file.read(buf, 1024);
-
-    if (len == 0 && file.available() > 0) {
-      Serial.printf("[%lu] [EHP] File read error\n", millis());
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
-      file.close();
-      return false;
+      parser = nullptr;
+      return 0;
     }
 
-    done = file.available() == 0;
+    const auto toRead = remainingInBuffer < 1024 ? remainingInBuffer : 1024;
+    memcpy(buf, currentBufferPos, toRead);
 
-    if (XML_ParseBuffer(parser, static_cast<int>(len), done) == XML_STATUS_ERROR) {
+    // The end of the document is signalled separately once the inflater has drained
+    if (XML_ParseBuffer(parser, static_cast<int>(toRead), XML_FALSE) == XML_STATUS_ERROR) {
       Serial.printf("[%lu] [EHP] Parse error at line %lu:\n%s\n", millis(), XML_GetCurrentLineNumber(parser),
                     XML_ErrorString(XML_GetErrorCode(parser)));
       XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
       XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
       XML_SetCharacterDataHandler(parser, nullptr);
       XML_ParserFree(parser);
-      file.close();
-      return false;
+      parser = nullptr;
+      return 0;
     }
-  } while (!done);
-
-  XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-  XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-  XML_SetCharacterDataHandler(parser, nullptr);
-  XML_ParserFree(parser);
-  file.close();
-
-  // Process last page if there is still text
-  if (currentTextBlock) {
-    makePages();
-    completePageFn(std::move(currentPage));
-    currentPage.reset();
-    currentTextBlock.reset();
-  }
 
-  return true;
-}
-
-void ChapterHtmlSlimParser::addLineToPage(std::shared_ptr<TextBlock> line) {
-  const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
-
-  if (currentPageNextY + lineHeight > viewportHeight) {
-    completePageFn(std::move(currentPage));
-    currentPage.reset(new Page());
-    currentPageNextY = 0;
+    currentBufferPos += toRead;
+    remainingInBuffer -= toRead;
   }
 
-  currentPage->elements.push_back(std::make_shared<PageLine>(line, 0, currentPageNextY));
-  currentPageNextY += lineHeight;
+  return size;
 }
 
-void ChapterHtmlSlimParser::addImageToPage(const std::string& bmpPath, uint16_t imageWidth, uint16_t imageHeight) {
-  if (bmpPath.empty() || imageWidth == 0 || imageHeight == 0) {
-    return;
-  }
-
-  if (!currentPage) {
-    currentPage.reset(new Page());
-    currentPageNextY = 0;
-  }
-
-  int drawWidth = imageWidth;
-  int drawHeight = imageHeight;
-
-  if (drawWidth > viewportWidth) {
-    drawHeight = static_cast<int>((static_cast<uint32_t>(drawHeight) * viewportWidth) / std::max(1, drawWidth));
-    drawWidth = viewportWidth;
-  }
-
-  constexpr int kVerticalPadding = 8;
-  const int maxImageHeight = std::max(40, static_cast<int>(viewportHeight) - 40);
-  if (drawHeight > maxImageHeight) {
-    drawWidth = static_cast<int>((static_cast<uint32_t>(drawWidth) * maxImageHeight) / std::max(1, drawHeight));
-    drawHeight = maxImageHeight;
-  }
+bool ChapterHtmlSlimParser::parseAndTokenize() {
+  startNewTextBlock(ChapterTokens::PARAGRAPH_STYLE);
 
-  if (currentPageNextY + drawHeight > viewportHeight) {
-    completePageFn(std::move(currentPage));
-    currentPage.reset(new Page());
-    currentPageNextY = 0;
+  parser = XML_ParserCreate_MM(nullptr, &PARSER_MEMORY, nullptr);
+  if (!parser) {
+    Serial.printf("[%lu] [EHP] Couldn't allocate memory for parser\n", millis());
+    return false;
   }
 
-  const int x = std::max(0, (static_cast<int>(viewportWidth) - drawWidth) / 2);
-  currentPage->elements.push_back(
-      std::make_shared<PageImage>(bmpPath, static_cast<int16_t>(x), static_cast<int16_t>(currentPageNextY),
-                                  static_cast<uint16_t>(drawWidth), static_cast<uint16_t>(drawHeight)));
-  currentPageNextY += drawHeight + kVerticalPadding;
-}
+  XML_SetUserData(parser, this);
+  XML_SetElementHandler(parser, startElement, endElement);
+  XML_SetCharacterDataHandler(parser, characterData);
 
-void ChapterHtmlSlimParser::makePages() {
-  if (!currentTextBlock) {
-    Serial.printf("[%lu] [EHP] !! No text block to make pages for !!\n", millis());
-    return;
+  // write() tears the parser down on any error, which makes the stream report a short write
+  if (!contentStreamFn || !contentStreamFn(*this) || !parser) {
+    Serial.printf("[%lu] [EHP] Failed to stream chapter content\n", millis());
+    return false;
   }
 
-  if (!currentPage) {
-    currentPage.reset(new Page());
-    currentPageNextY = 0;
+  if (XML_ParseBuffer(parser, 0, XML_TRUE) == XML_STATUS_ERROR) {
+    Serial.printf("[%lu] [EHP] Parse error at line %lu:\n%s\n", millis(), XML_GetCurrentLineNumber(parser),
+                  XML_ErrorString(XML_GetErrorCode(parser)));
+    return false;
   }
 
-  const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
-  currentTextBlock->layoutAndExtractLines(
-      renderer, fontId, viewportWidth,
-      [this](const std::shared_ptr<TextBlock>& textBlock) { addLineToPage(textBlock); });
-  // Extra paragraph spacing if enabled
-  if (extraParagraphSpacing) {
-    currentPageNextY += lineHeight / 2;
-  }
+  XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
+  XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
+  XML_SetCharacterDataHandler(parser, nullptr);
+  XML_ParserFree(parser);
+  parser = nullptr;
+  return true;
 }
@@ -1,29 +1,30 @@
 #pragma once
 
+#include <Print.h>
 #include <expat.h>
 
 #include <climits>
 #include <functional>
-#include <memory>
+#include <string>
 #include <utility>
 
-#include "../ParsedText.h"
+#include "../ChapterTokens.h"
 #include "../blocks/TextBlock.h"
 
-class Page;
-class GfxRenderer;
-
 #define MAX_WORD_SIZE 200
 
-class ChapterHtmlSlimParser {
+// Receives the chapter XHTML through Print::write, so inflated bytes can be fed straight from the zip into expat.
+// Emits the layout-independent token stream (see ChapterTokens.h); ChapterPageBuilder turns that into pages.
+class ChapterHtmlSlimParser final : public Print {
  public:
   using ImageResolverFn = std::function<bool(const std::string&, std::string&, uint16_t&, uint16_t&)>;
+  // Streams the whole chapter into the given sink, returns false if the source could not be read
+  using ContentStreamFn = std::function<bool(Print&)>;
 
  private:
-  const std::string& filepath;
-  GfxRenderer& renderer;
-  std::function<void(std::unique_ptr<Page>)> completePageFn;
-  std::function<void()> popupFn;  // Popup callback
+  ContentStreamFn contentStreamFn;
+  XML_Parser parser = nullptr;
+  ChapterTokens::Writer& tokens;
   ImageResolverFn imageResolverFn;
   int depth = 0;
   int skipUntilDepth = INT_MAX;
@@ -33,47 +34,22 @@ class ChapterHtmlSlimParser {
   // leave one char at end for null pointer
   char partWordBuffer[MAX_WORD_SIZE + 1] = {};
   int partWordBufferIndex = 0;
-  std::unique_ptr<ParsedText> currentTextBlock = nullptr;
-  std::unique_ptr<Page> currentPage = nullptr;
-  int16_t currentPageNextY = 0;
-  int fontId;
-  float lineCompression;
-  bool extraParagraphSpacing;
-  uint8_t paragraphAlignment;
-  uint16_t viewportWidth;
-  uint16_t viewportHeight;
-  bool hyphenationEnabled;
+  // Style of the running block, a TextBlock::Style or ChapterTokens::PARAGRAPH_STYLE
+  uint8_t currentBlockStyle = ChapterTokens::PARAGRAPH_STYLE;
 
-  void startNewTextBlock(TextBlock::Style style);
+  void startNewTextBlock(uint8_t style);
   void flushPartWordBuffer();
-  void makePages();
   // XML callbacks
   static void XMLCALL startElement(void* userData, const XML_Char* name, const XML_Char** atts);
   static void XMLCALL characterData(void* userData, const XML_Char* s, int len);
   static void XMLCALL endElement(void* userData, const XML_Char* name);
-  void addImageToPage(const std::string& bmpPath, uint16_t imageWidth, uint16_t imageHeight);
 
  public:
-  explicit ChapterHtmlSlimParser(const std::string& filepath, GfxRenderer& renderer, const int fontId,
-                                 const float lineCompression, const bool extraParagraphSpacing,
-                                 const uint8_t paragraphAlignment, const uint16_t viewportWidth,
-                                 const uint16_t viewportHeight, const bool hyphenationEnabled,
-                                 const std::function<void(std::unique_ptr<Page>)>& completePageFn,
-                                 const std::function<void()>& popupFn = nullptr,
+  explicit ChapterHtmlSlimParser(ContentStreamFn contentStreamFn, ChapterTokens::Writer& tokens,
                                  ImageResolverFn imageResolverFn = nullptr)
-      : filepath(filepath),
-        renderer(renderer),
-        fontId(fontId),
-        lineCompression(lineCompression),
-        extraParagraphSpacing(extraParagraphSpacing),
-        paragraphAlignment(paragraphAlignment),
-        viewportWidth(viewportWidth),
-        viewportHeight(viewportHeight),
-        hyphenationEnabled(hyphenationEnabled),
-        completePageFn(completePageFn),
-        popupFn(popupFn),
-        imageResolverFn(std::move(imageResolverFn)) {}
-  ~ChapterHtmlSlimParser() = default;
-  bool parseAndBuildPages();
-  void addLineToPage(std::shared_ptr<TextBlock> line);
+      : contentStreamFn(std::move(contentStreamFn)), tokens(tokens), imageResolverFn(std::move(imageResolverFn)) {}
+  ~ChapterHtmlSlimParser() override;
+  bool parseAndTokenize();
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
 };
@@ -1,7 +1,11 @@
 #include "GfxRenderer.h"
 
+#include <MemTrack.h>
+#include <Trace.h>
 #include <Utf8.h>
 
+#include <cstdint>
+
 #include "../../src/fontIds.h"
 
 void GfxRenderer::insertFont(const int fontId, EpdFontFamily font) { fontMap.insert({fontId, font}); }
@@ -38,6 +42,13 @@ void GfxRenderer::rotateCoordinates(const int x, const int y, int* rotatedX, int
 }
 
 void GfxRenderer::drawPixel(const int x, const int y, const bool state) const {
+#if defined(PLATFORM_M5PAPER)
+  if (renderMode == GRAYSCALE_4BPP) {
+    drawPixelGray(x, y, state ? 0x0 : 0xF);
+    return;
+  }
+#endif
+
   uint8_t* frameBuffer = display.getFrameBuffer();
 
   // Early return if no framebuffer is set
@@ -67,6 +78,31 @@ void GfxRenderer::drawPixel(const int x, const int y, const bool state) const {
   }
 }
 
+#if defined(PLATFORM_M5PAPER)
+void GfxRenderer::drawPixelGray(const int x, const int y, const uint8_t level) const {
+  uint8_t* grayBuffer = display.getGrayFrameBuffer();
+  if (!grayBuffer) {
+    Serial.printf("[%lu] [GFX] !! No gray framebuffer\n", millis());
+    return;
+  }
+
+  int rotatedX = 0;
+  int rotatedY = 0;
+  rotateCoordinates(x, y, &rotatedX, &rotatedY);
+  if (rotatedX < 0 || rotatedX >= HalDisplay::DISPLAY_WIDTH || rotatedY < 0 || rotatedY >= HalDisplay::DISPLAY_HEIGHT) {
+    return;
+  }
+
+  // Two pixels per byte, first pixel in the high nibble
+  uint8_t& byte = grayBuffer[(rotatedY * HalDisplay::DISPLAY_WIDTH + rotatedX) / 2];
+  if (rotatedX & 1) {
+    byte = (byte & 0xF0) | (level & 0x0F);
+  } else {
+    byte = (byte & 0x0F) | static_cast<uint8_t>(level << 4);
+  }
+}
+#endif
+
 int GfxRenderer::getTextWidth(const int fontId, const char* text, const EpdFontFamily::Style style) const {
   if (fontMap.count(fontId) == 0) {
     Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
@@ -112,6 +148,7 @@ void GfxRenderer::drawText(const int fontId, const int x, const int y, const cha
 }
 
 void GfxRenderer::drawLine(int x1, int y1, int x2, int y2, const bool state) const {
+  markRegionDirty(std::min(x1, x2), std::min(y1, y2), std::abs(x2 - x1) + 1, std::abs(y2 - y1) + 1);
   if (x1 == x2) {
     if (y2 < y1) {
       std::swap(y1, y2);
@@ -162,8 +199,11 @@ void GfxRenderer::drawRect(const int x, const int y, const int width, const int
 }
 
 void GfxRenderer::fillRect(const int x, const int y, const int width, const int height, const bool state) const {
+  markRegionDirty(x, y, width, height);
   for (int fillY = y; fillY < y + height; fillY++) {
-    drawLine(x, fillY, x + width - 1, fillY, state);
+    for (int fillX = x; fillX < x + width; fillX++) {
+      drawPixel(fillX, fillY, state);
+    }
   }
 }
 
@@ -188,6 +228,181 @@ void GfxRenderer::drawImage(const uint8_t bitmap[], const int x, const int y, co
   }
   // TODO: Rotate bits
   display.drawImage(bitmap, rotatedX, rotatedY, width, height);
+  markDirty(rotatedX, rotatedY, width, height);
+}
+
+namespace {
+// Transposes an 8x8 bit matrix held as 8 bytes, MSB first: bit 7-j of out[i] is bit 7-i of in[j]
+void transpose8(const uint8_t in[8], uint8_t out[8]) {
+  uint32_t hi = static_cast<uint32_t>(in[0]) << 24 | in[1] << 16 | in[2] << 8 | in[3];
+  uint32_t lo = static_cast<uint32_t>(in[4]) << 24 | in[5] << 16 | in[6] << 8 | in[7];
+  uint32_t t = (hi ^ (hi >> 7)) & 0x00AA00AA;
+  hi ^= t ^ (t << 7);
+  t = (lo ^ (lo >> 7)) & 0x00AA00AA;
+  lo ^= t ^ (t << 7);
+  t = (hi ^ (hi >> 14)) & 0x0000CCCC;
+  hi ^= t ^ (t << 14);
+  t = (lo ^ (lo >> 14)) & 0x0000CCCC;
+  lo ^= t ^ (t << 14);
+  t = (hi & 0xF0F0F0F0) | ((lo >> 4) & 0x0F0F0F0F);
+  lo = ((hi << 4) & 0xF0F0F0F0) | (lo & 0x0F0F0F0F);
+  hi = t;
+  for (int i = 0; i < 4; i++) {
+    out[i] = hi >> (24 - i * 8);
+    out[i + 4] = lo >> (24 - i * 8);
+  }
+}
+
+uint8_t reverse8(uint8_t bits) {
+  bits = (bits & 0xF0) >> 4 | (bits & 0x0F) << 4;
+  bits = (bits & 0xCC) >> 2 | (bits & 0x33) << 2;
+  return (bits & 0xAA) >> 1 | (bits & 0x55) << 1;
+}
+
+// The first count bits, MSB first
+uint8_t leadingBits(const int count) { return count >= 8 ? 0xFF : static_cast<uint8_t>(0xFF00 >> count); }
+}  // namespace
+
+/**
+ * Shared driver of the packed blits. The logical (width x height) box at (originX, originY) is walked in 8x8 tiles,
+ * and fetchTile(x, y, asColumns, tile) fills the draw mask of the tile at (x, y) within the box: as 8 rows when
+ * asColumns is false, as 8 columns otherwise, MSB first either way. The tile comes in whichever form lies along panel
+ * rows in the current orientation, so each of its bytes is 8 neighbouring framebuffer pixels (reversed when the
+ * orientation mirrors it), written to one byte when they are aligned and to two otherwise.
+ */
+template <typename FetchTile>
+void GfxRenderer::blitMaskTiles(const int originX, const int originY, const int width, const int height,
+                                const bool state, FetchTile fetchTile) const {
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  markRegionDirty(originX, originY, width, height);
+
+  const bool asColumns = orientation == Portrait || orientation == PortraitInverted;
+  // Portrait and LandscapeClockwise run logical lines towards lower panel x
+  const bool mirrored = orientation == PortraitInverted || orientation == LandscapeClockwise;
+  const int lineLimit = asColumns ? width : height;
+  const int alongLimit = asColumns ? height : width;
+
+#if defined(PLATFORM_M5PAPER)
+  if (renderMode == GRAYSCALE_4BPP) {
+    for (int y = 0; y < height; y += 8) {
+      for (int x = 0; x < width; x += 8) {
+        uint8_t tile[8];
+        fetchTile(x, y, asColumns, tile);
+        for (int i = 0; i < 8; i++) {
+          for (int j = 0; j < 8; j++) {
+            const int line = (asColumns ? x : y) + i;
+            const int along = (asColumns ? y : x) + j;
+            if (line < lineLimit && along < alongLimit && (tile[i] & (0x80 >> j))) {
+              drawPixelGray(originX + (asColumns ? line : along), originY + (asColumns ? along : line),
+                            state ? 0x0 : 0xF);
+            }
+          }
+        }
+      }
+    }
+    return;
+  }
+#endif
+
+  uint8_t* frameBuffer = display.getFrameBuffer();
+  if (!frameBuffer) {
+    Serial.printf("[%lu] [GFX] !! No framebuffer\n", millis());
+    return;
+  }
+
+  for (int y = 0; y < height; y += 8) {
+    for (int x = 0; x < width; x += 8) {
+      uint8_t tile[8];
+      fetchTile(x, y, asColumns, tile);
+      const int along = asColumns ? y : x;
+      const uint8_t edgeMask = leadingBits(alongLimit - along);
+
+      for (int i = 0; i < 8; i++) {
+        const int line = (asColumns ? x : y) + i;
+        if (line >= lineLimit) {
+          break;
+        }
+        uint8_t bits = tile[i] & edgeMask;
+        if (!bits) {
+          continue;
+        }
+        int panelX = 0;
+        int panelY = 0;
+        rotateCoordinates(originX + (asColumns ? line : along), originY + (asColumns ? along : line), &panelX,
+                          &panelY);
+        if (mirrored) {
+          bits = reverse8(bits);
+          panelX -= 7;
+        }
+        if (panelX <= -8 || panelX >= HalDisplay::DISPLAY_WIDTH || panelY < 0 || panelY >= HalDisplay::DISPLAY_HEIGHT) {
+          continue;
+        }
+        // Floor division, so a run starting just left of the panel still lands its right part in byte 0
+        const int shift = panelX & 7;
+        const int byteX = (panelX - shift) / 8;
+        uint8_t* row = frameBuffer + panelY * HalDisplay::DISPLAY_WIDTH_BYTES;
+        if (byteX >= 0) {
+          const uint8_t mask = bits >> shift;
+          row[byteX] = state ? row[byteX] & ~mask : row[byteX] | mask;
+        }
+        if (shift && byteX + 1 < HalDisplay::DISPLAY_WIDTH_BYTES) {
+          const uint8_t mask = bits << (8 - shift);
+          row[byteX + 1] = state ? row[byteX + 1] & ~mask : row[byteX + 1] | mask;
+        }
+      }
+    }
+  }
+}
+
+void GfxRenderer::drawPackedRows(const uint8_t* rows, const int x, const int y, const int width, const int height,
+                                 const bool invert, const bool state) const {
+  const int rowBytes = (width + 7) / 8;
+  const uint8_t flip = invert ? 0xFF : 0x00;
+  const auto fetchTile = [&](const int tileX, const int tileY, const bool asColumns, uint8_t tile[8]) {
+    uint8_t tileRows[8];
+    for (int i = 0; i < 8; i++) {
+      tileRows[i] = tileY + i < height ? rows[(tileY + i) * rowBytes + tileX / 8] ^ flip : 0;
+    }
+    if (asColumns) {
+      transpose8(tileRows, tile);
+    } else {
+      std::copy(tileRows, tileRows + 8, tile);
+    }
+  };
+  blitMaskTiles(x, y, width, height, state, fetchTile);
+}
+
+void GfxRenderer::drawPackedColumnPlanes(const uint8_t* plane1, const uint8_t* plane2, const int x, const int y,
+                                         const int width, const int height, const uint8_t selectedValues,
+                                         const bool state) const {
+  const int columnBytes = (height + 7) / 8;
+  const auto fetchTile = [&](const int tileX, const int tileY, const bool asColumns, uint8_t tile[8]) {
+    uint8_t tileColumns[8];
+    for (int i = 0; i < 8; i++) {
+      if (tileX + i >= width) {
+        tileColumns[i] = 0;
+        continue;
+      }
+      // Columns are stored right to left
+      const size_t offset = static_cast<size_t>(width - 1 - tileX - i) * columnBytes + tileY / 8;
+      const uint8_t bit1 = plane1[offset];
+      const uint8_t bit2 = plane2[offset];
+      uint8_t mask = 0;
+      if (selectedValues & 0b0001) mask |= ~bit1 & ~bit2;
+      if (selectedValues & 0b0010) mask |= ~bit1 & bit2;
+      if (selectedValues & 0b0100) mask |= bit1 & ~bit2;
+      if (selectedValues & 0b1000) mask |= bit1 & bit2;
+      tileColumns[i] = mask;
+    }
+    if (asColumns) {
+      std::copy(tileColumns, tileColumns + 8, tile);
+    } else {
+      transpose8(tileColumns, tile);
+    }
+  };
+  blitMaskTiles(x, y, width, height, state, fetchTile);
 }
 
 void GfxRenderer::drawBitmap(const Bitmap& bitmap, const int x, const int y, const int maxWidth, const int maxHeight,
@@ -227,6 +442,8 @@ void GfxRenderer::drawBitmap(const Bitmap& bitmap, const int x, const int y, con
     free(rowBytes);
     return;
   }
+  markRegionDirty(x, y, static_cast<int>(std::ceil((bitmap.getWidth() - 2 * cropPixX) * scale)),
+                  static_cast<int>(std::ceil((bitmap.getHeight() - 2 * cropPixY) * scale)));
 
   for (int bmpY = 0; bmpY < (bitmap.getHeight() - cropPixY); bmpY++) {
     // The BMP's (0, 0) is the bottom-left corner (if the height is positive, top-left if negative).
@@ -271,6 +488,16 @@ void GfxRenderer::drawBitmap(const Bitmap& bitmap, const int x, const int y, con
 
       const uint8_t val = outputRow[bmpX / 4] >> (6 - ((bmpX * 2) % 8)) & 0x3;
 
+#if defined(PLATFORM_M5PAPER)
+      if (renderMode == GRAYSCALE_4BPP) {
+        // 0 -> black .. 3 -> white, spread across the 16 panel levels
+        if (val < 3) {
+          drawPixelGray(screenX, screenY, val * 5);
+        }
+        continue;
+      }
+#endif
+
       if (renderMode == BW && val < 3) {
         drawPixel(screenX, screenY);
       } else if (renderMode == GRAYSCALE_MSB && (val == 1 || val == 2)) {
@@ -309,6 +536,8 @@ void GfxRenderer::drawBitmap1Bit(const Bitmap& bitmap, const int x, const int y,
     free(rowBytes);
     return;
   }
+  markRegionDirty(x, y, static_cast<int>(std::ceil(bitmap.getWidth() * scale)),
+                  static_cast<int>(std::ceil(bitmap.getHeight() * scale)));
 
   for (int bmpY = 0; bmpY < bitmap.getHeight(); bmpY++) {
     // Read rows sequentially using readNextRow
@@ -358,11 +587,15 @@ void GfxRenderer::fillPolygon(const int* xPoints, const int* yPoints, int numPoi
   if (numPoints < 3) return;
 
   // Find bounding box
+  int minX = xPoints[0], maxX = xPoints[0];
   int minY = yPoints[0], maxY = yPoints[0];
   for (int i = 1; i < numPoints; i++) {
+    if (xPoints[i] < minX) minX = xPoints[i];
+    if (xPoints[i] > maxX) maxX = xPoints[i];
     if (yPoints[i] < minY) minY = yPoints[i];
     if (yPoints[i] > maxY) maxY = yPoints[i];
   }
+  markRegionDirty(minX, minY, maxX - minX + 1, maxY - minY + 1);
 
   // Clip to screen
   if (minY < 0) minY = 0;
@@ -422,9 +655,31 @@ void GfxRenderer::fillPolygon(const int* xPoints, const int* yPoints, int numPoi
   free(nodeX);
 }
 
-void GfxRenderer::clearScreen(const uint8_t color) const { display.clearScreen(color); }
+void GfxRenderer::clearScreen(const uint8_t color) const {
+#if defined(PLATFORM_M5PAPER)
+  if (renderMode == GRAYSCALE_4BPP) {
+    display.clearGrayFrameBuffer(color);
+    markAllDirty();
+    return;
+  }
+#endif
+  display.clearScreen(color);
+  markAllDirty();
+}
 
 void GfxRenderer::invertScreen() const {
+#if defined(PLATFORM_M5PAPER)
+  if (renderMode == GRAYSCALE_4BPP) {
+    uint8_t* grayBuffer = display.getGrayFrameBuffer();
+    if (grayBuffer) {
+      for (uint32_t i = 0; i < HalDisplay::GRAY_BUFFER_SIZE; i++) {
+        grayBuffer[i] = ~grayBuffer[i];
+      }
+    }
+    markAllDirty();
+    return;
+  }
+#endif
   uint8_t* buffer = display.getFrameBuffer();
   if (!buffer) {
     Serial.printf("[%lu] [GFX] !! No framebuffer in invertScreen\n", millis());
@@ -433,9 +688,151 @@ void GfxRenderer::invertScreen() const {
   for (int i = 0; i < HalDisplay::BUFFER_SIZE; i++) {
     buffer[i] = ~buffer[i];
   }
+  markAllDirty();
 }
 
-void GfxRenderer::displayBuffer(const HalDisplay::RefreshMode refreshMode) const { display.displayBuffer(refreshMode); }
+void GfxRenderer::displayBuffer(const HalDisplay::RefreshMode refreshMode) const {
+  TRACE_SCOPE("display", "refresh");
+#if defined(PLATFORM_M5PAPER)
+  if (renderMode == GRAYSCALE_4BPP) {
+    display.displayGrayFrameBuffer(refreshMode);
+    clearDirty();
+    return;
+  }
+#endif
+
+  bool allDirty = false;
+  for (int i = 0; i < dirtyRectCount; i++) {
+    const DirtyRect& rect = dirtyRects[i];
+    allDirty |= rect.minX == 0 && rect.minY == 0 && rect.maxX == HalDisplay::DISPLAY_WIDTH &&
+                rect.maxY == HalDisplay::DISPLAY_HEIGHT;
+  }
+  if (refreshMode != HalDisplay::FAST_REFRESH || allDirty) {
+    display.displayBuffer(refreshMode);
+  } else {
+    for (int i = 0; i < dirtyRectCount; i++) {
+      const DirtyRect& rect = dirtyRects[i];
+      display.displayWindow(rect.minX, rect.minY, rect.maxX - rect.minX, rect.maxY - rect.minY);
+    }
+  }
+  clearDirty();
+}
+
+void GfxRenderer::displayWindow(const int x, const int y, const int width, const int height) const {
+  TRACE_SCOPE("display", "refresh_window");
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  // Map two opposite corners to the panel and rebuild the rectangle from them
+  int x1 = 0;
+  int y1 = 0;
+  int x2 = 0;
+  int y2 = 0;
+  rotateCoordinates(x, y, &x1, &y1);
+  rotateCoordinates(x + width - 1, y + height - 1, &x2, &y2);
+  const int minX = std::max(0, std::min(x1, x2));
+  const int minY = std::max(0, std::min(y1, y2));
+  const int maxX = std::min<int>(HalDisplay::DISPLAY_WIDTH, std::max(x1, x2) + 1);
+  const int maxY = std::min<int>(HalDisplay::DISPLAY_HEIGHT, std::max(y1, y2) + 1);
+  if (minX >= maxX || minY >= maxY) {
+    return;
+  }
+
+  display.displayWindow(minX, minY, maxX - minX, maxY - minY);
+}
+
+void GfxRenderer::markDirty(const int panelX, const int panelY, const int width, const int height) const {
+  const DirtyRect mark = {std::max(0, panelX), std::max(0, panelY),
+                          std::min<int>(HalDisplay::DISPLAY_WIDTH, panelX + width),
+                          std::min<int>(HalDisplay::DISPLAY_HEIGHT, panelY + height)};
+  if (mark.minX >= mark.maxX || mark.minY >= mark.maxY) {
+    return;
+  }
+
+  // Mostly this grows a rect the mark is in or next to
+  int target = -1;
+  for (int i = 0; i < dirtyRectCount; i++) {
+    const DirtyRect& rect = dirtyRects[i];
+    if (mark.minX <= rect.maxX + DIRTY_MERGE_GAP && mark.maxX + DIRTY_MERGE_GAP >= rect.minX &&
+        mark.minY <= rect.maxY + DIRTY_MERGE_GAP && mark.maxY + DIRTY_MERGE_GAP >= rect.minY) {
+      target = i;
+      break;
+    }
+  }
+  if (target < 0 && dirtyRectCount < MAX_DIRTY_RECTS) {
+    dirtyRects[dirtyRectCount++] = mark;
+    return;
+  }
+  if (target < 0) {
+    // Out of rects, the mark goes into the one it grows least
+    int64_t bestGrowth = INT64_MAX;
+    for (int i = 0; i < dirtyRectCount; i++) {
+      const DirtyRect& rect = dirtyRects[i];
+      const int64_t grown = static_cast<int64_t>(std::max(rect.maxX, mark.maxX) - std::min(rect.minX, mark.minX)) *
+                            (std::max(rect.maxY, mark.maxY) - std::min(rect.minY, mark.minY));
+      const int64_t growth = grown - static_cast<int64_t>(rect.maxX - rect.minX) * (rect.maxY - rect.minY);
+      if (growth < bestGrowth) {
+        bestGrowth = growth;
+        target = i;
+      }
+    }
+  }
+
+  DirtyRect& rect = dirtyRects[target];
+  if (mark.minX >= rect.minX && mark.minY >= rect.minY && mark.maxX <= rect.maxX && mark.maxY <= rect.maxY) {
+    return;
+  }
+  rect.minX = std::min(rect.minX, mark.minX);
+  rect.minY = std::min(rect.minY, mark.minY);
+  rect.maxX = std::max(rect.maxX, mark.maxX);
+  rect.maxY = std::max(rect.maxY, mark.maxY);
+  mergeDirtyRect(target);
+}
+
+// Folds every other rect that the grown one now reaches into it
+void GfxRenderer::mergeDirtyRect(int index) const {
+  for (int i = 0; i < dirtyRectCount;) {
+    DirtyRect& rect = dirtyRects[index];
+    const DirtyRect& other = dirtyRects[i];
+    if (i == index || other.minX > rect.maxX + DIRTY_MERGE_GAP || other.maxX + DIRTY_MERGE_GAP < rect.minX ||
+        other.minY > rect.maxY + DIRTY_MERGE_GAP || other.maxY + DIRTY_MERGE_GAP < rect.minY) {
+      i++;
+      continue;
+    }
+    rect.minX = std::min(rect.minX, other.minX);
+    rect.minY = std::min(rect.minY, other.minY);
+    rect.maxX = std::max(rect.maxX, other.maxX);
+    rect.maxY = std::max(rect.maxY, other.maxY);
+    // Last rect moves into the freed slot, and then again into index if that was the last one
+    dirtyRectCount--;
+    if (index == dirtyRectCount) {
+      index = i;
+    }
+    dirtyRects[i] = dirtyRects[dirtyRectCount];
+    i = 0;
+  }
+}
+
+void GfxRenderer::markRegionDirty(const int x, const int y, const int width, const int height) const {
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  int x1 = 0;
+  int y1 = 0;
+  int x2 = 0;
+  int y2 = 0;
+  rotateCoordinates(x, y, &x1, &y1);
+  rotateCoordinates(x + width - 1, y + height - 1, &x2, &y2);
+  markDirty(std::min(x1, x2), std::min(y1, y2), std::abs(x2 - x1) + 1, std::abs(y2 - y1) + 1);
+}
+
+void GfxRenderer::markAllDirty() const {
+  dirtyRects[0] = {0, 0, HalDisplay::DISPLAY_WIDTH, HalDisplay::DISPLAY_HEIGHT};
+  dirtyRectCount = 1;
+}
+
+void GfxRenderer::clearDirty() const { dirtyRectCount = 0; }
 
 std::string GfxRenderer::truncatedText(const int fontId, const char* text, const int maxWidth,
                                        const EpdFontFamily::Style style) const {
@@ -494,6 +891,15 @@ int GfxRenderer::getSpaceWidth(const int fontId) const {
   return fontMap.at(fontId).getGlyph(' ', EpdFontFamily::REGULAR)->advanceX;
 }
 
+const EpdFontFamily* GfxRenderer::getFontFamily(const int fontId) const {
+  const auto it = fontMap.find(fontId);
+  if (it == fontMap.end()) {
+    Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
+    return nullptr;
+  }
+  return &it->second;
+}
+
 int GfxRenderer::getFontAscenderSize(const int fontId) const {
   if (fontMap.count(fontId) == 0) {
     Serial.printf("[%lu] [GFX] Font %d not found\n", millis(), fontId);
@@ -712,56 +1118,22 @@ void GfxRenderer::drawTextRotated90CW(const int fontId, const int x, const int y
       continue;
     }
 
-    const int is2Bit = font.getData(style)->is2Bit;
-    const uint32_t offset = glyph->dataOffset;
-    const uint8_t width = glyph->width;
-    const uint8_t height = glyph->height;
-    const int left = glyph->left;
-    const int top = glyph->top;
-
-    const uint8_t* bitmap = &font.getData(style)->bitmap[offset];
-
-    if (bitmap != nullptr) {
-      for (int glyphY = 0; glyphY < height; glyphY++) {
-        for (int glyphX = 0; glyphX < width; glyphX++) {
-          const int pixelPosition = glyphY * width + glyphX;
-
-          // 90° clockwise rotation transformation:
-          // screenX = x + (ascender - top + glyphY)
-          // screenY = yPos - (left + glyphX)
-          const int screenX = x + (font.getData(style)->ascender - top + glyphY);
-          const int screenY = yPos - left - glyphX;
-
-          if (is2Bit) {
-            const uint8_t byte = bitmap[pixelPosition / 4];
-            const uint8_t bit_index = (3 - pixelPosition % 4) * 2;
-            const uint8_t bmpVal = 3 - (byte >> bit_index) & 0x3;
-
-            if (renderMode == BW && bmpVal < 3) {
-              drawPixel(screenX, screenY, black);
-            } else if (renderMode == GRAYSCALE_MSB && (bmpVal == 1 || bmpVal == 2)) {
-              drawPixel(screenX, screenY, false);
-            } else if (renderMode == GRAYSCALE_LSB && bmpVal == 1) {
-              drawPixel(screenX, screenY, false);
-            }
-          } else {
-            const uint8_t byte = bitmap[pixelPosition / 8];
-            const uint8_t bit_index = 7 - (pixelPosition % 8);
-
-            if ((byte >> bit_index) & 1) {
-              drawPixel(screenX, screenY, black);
-            }
-          }
-        }
-      }
-    }
+    // 90° clockwise rotation transformation:
+    // screenX = x + (ascender - top + glyphY)
+    // screenY = yPos - (left + glyphX)
+    const EpdFontData& fontData = *font.getData(style);
+    blitGlyph(fontData, *glyph, x + fontData.ascender - glyph->top, yPos - glyph->left, 0, -1, 1, 0, black);
 
     // Move to next character position (going up, so decrease Y)
     yPos -= glyph->advanceX;
   }
 }
 
-uint8_t* GfxRenderer::getFrameBuffer() const { return display.getFrameBuffer(); }
+uint8_t* GfxRenderer::getFrameBuffer() const {
+  // Callers may write anywhere in the raw buffer
+  markAllDirty();
+  return display.getFrameBuffer();
+}
 
 size_t GfxRenderer::getBufferSize() { return HalDisplay::BUFFER_SIZE; }
 
@@ -772,12 +1144,15 @@ void GfxRenderer::copyGrayscaleLsbBuffers() const { display.copyGrayscaleLsbBuff
 
 void GfxRenderer::copyGrayscaleMsbBuffers() const { display.copyGrayscaleMsbBuffers(display.getFrameBuffer()); }
 
-void GfxRenderer::displayGrayBuffer() const { display.displayGrayBuffer(); }
+void GfxRenderer::displayGrayBuffer() const {
+  TRACE_SCOPE("display", "refresh_gray");
+  display.displayGrayBuffer();
+}
 
 void GfxRenderer::freeBwBufferChunks() {
   for (auto& bwBufferChunk : bwBufferChunks) {
     if (bwBufferChunk) {
-      free(bwBufferChunk);
+      memtrack::release(bwBufferChunk);
       bwBufferChunk = nullptr;
     }
   }
@@ -802,12 +1177,13 @@ bool GfxRenderer::storeBwBuffer() {
     if (bwBufferChunks[i]) {
       Serial.printf("[%lu] [GFX] !! BW buffer chunk %zu already stored - this is likely a bug, freeing chunk\n",
                     millis(), i);
-      free(bwBufferChunks[i]);
+      memtrack::release(bwBufferChunks[i]);
       bwBufferChunks[i] = nullptr;
     }
 
     const size_t offset = i * BW_BUFFER_CHUNK_SIZE;
-    bwBufferChunks[i] = static_cast<uint8_t*>(malloc(BW_BUFFER_CHUNK_SIZE));
+    bwBufferChunks[i] =
+        static_cast<uint8_t*>(memtrack::allocate(memtrack::Tag::RendererChunks, BW_BUFFER_CHUNK_SIZE));
 
     if (!bwBufferChunks[i]) {
       Serial.printf("[%lu] [GFX] !! Failed to allocate BW buffer chunk %zu (%zu bytes)\n", millis(), i,
@@ -863,6 +1239,7 @@ void GfxRenderer::restoreBwBuffer() {
     const size_t offset = i * BW_BUFFER_CHUNK_SIZE;
     memcpy(frameBuffer + offset, bwBufferChunks[i], BW_BUFFER_CHUNK_SIZE);
   }
+  markAllDirty();
 
   display.cleanupGrayscaleBuffers(frameBuffer);
 
@@ -894,54 +1271,167 @@ void GfxRenderer::renderChar(const EpdFontFamily& fontFamily, const uint32_t cp,
     return;
   }
 
-  const int is2Bit = fontFamily.getData(style)->is2Bit;
-  const uint32_t offset = glyph->dataOffset;
-  const uint8_t width = glyph->width;
-  const uint8_t height = glyph->height;
-  const int left = glyph->left;
+  // Glyph columns advance along logical +x and glyph rows along logical +y
+  blitGlyph(*fontFamily.getData(style), *glyph, *x + glyph->left, *y - glyph->top, 1, 0, 0, 1, pixelState);
 
-  const uint8_t* bitmap = nullptr;
-  bitmap = &fontFamily.getData(style)->bitmap[offset];
+  *x += glyph->advanceX;
+}
 
-  if (bitmap != nullptr) {
-    for (int glyphY = 0; glyphY < height; glyphY++) {
-      const int screenY = *y - glyph->top + glyphY;
-      for (int glyphX = 0; glyphX < width; glyphX++) {
-        const int pixelPosition = glyphY * width + glyphX;
-        const int screenX = *x + left + glyphX;
+/**
+ * Writes a glyph bitmap straight into the framebuffer.
+ * (originX, originY) is the logical position of glyph pixel (0, 0), and the two steps are the logical offsets of one
+ * glyph column and one glyph row. Both steps are mapped to the panel once, the glyph box is clipped once, and the
+ * loops always walk along a panel row so the selected pixels are gathered into a mask and written once per byte.
+ */
+void GfxRenderer::blitGlyph(const EpdFontData& fontData, const EpdGlyph& glyph, const int originX, const int originY,
+                            const int colStepX, const int colStepY, const int rowStepX, const int rowStepY,
+                            const bool pixelState) const {
+  const int width = glyph.width;
+  const int height = glyph.height;
+  if (width == 0 || height == 0) {
+    return;
+  }
 
+  uint8_t* frameBuffer = display.getFrameBuffer();
+  if (!frameBuffer) {
+    Serial.printf("[%lu] [GFX] !! No framebuffer\n", millis());
+    return;
+  }
+
+  // Map the glyph origin and both glyph axes to panel space
+  int panelX = 0;
+  int panelY = 0;
+  int colPanelX = 0;
+  int colPanelY = 0;
+  int rowPanelX = 0;
+  int rowPanelY = 0;
+  rotateCoordinates(originX, originY, &panelX, &panelY);
+  rotateCoordinates(originX + colStepX, originY + colStepY, &colPanelX, &colPanelY);
+  rotateCoordinates(originX + rowStepX, originY + rowStepY, &rowPanelX, &rowPanelY);
+
+  // The inner loop runs along whichever glyph axis lands on a panel row, the outer loop across panel rows
+  const bool innerIsColumn = colPanelX != panelX;
+  const int innerStep = innerIsColumn ? colPanelX - panelX : rowPanelX - panelX;
+  const int outerStep = innerIsColumn ? rowPanelY - panelY : colPanelY - panelY;
+  const int innerLen = innerIsColumn ? width : height;
+  const int outerLen = innerIsColumn ? height : width;
+  const int innerPosStep = innerIsColumn ? 1 : width;
+  const int outerPosStep = innerIsColumn ? width : 1;
+
+  // Clip the glyph box against the panel once
+  const auto clipAxis = [](const int start, const int step, const int len, const int limit, int* begin, int* end) {
+    if (step > 0) {
+      *begin = std::max(0, -start);
+      *end = std::min(len, limit - start);
+    } else {
+      *begin = std::max(0, start - limit + 1);
+      *end = std::min(len, start + 1);
+    }
+  };
+  int innerBegin = 0;
+  int innerEnd = 0;
+  int outerBegin = 0;
+  int outerEnd = 0;
+  clipAxis(panelX, innerStep, innerLen, HalDisplay::DISPLAY_WIDTH, &innerBegin, &innerEnd);
+  clipAxis(panelY, outerStep, outerLen, HalDisplay::DISPLAY_HEIGHT, &outerBegin, &outerEnd);
+  if (innerBegin >= innerEnd || outerBegin >= outerEnd) {
+    return;
+  }
+
+  const int innerFirstX = panelX + innerBegin * innerStep;
+  const int innerLastX = panelX + (innerEnd - 1) * innerStep;
+  const int outerFirstY = panelY + outerBegin * outerStep;
+  const int outerLastY = panelY + (outerEnd - 1) * outerStep;
+  markDirty(std::min(innerFirstX, innerLastX), std::min(outerFirstY, outerLastY),
+            std::abs(innerLastX - innerFirstX) + 1, std::abs(outerLastY - outerFirstY) + 1);
+
+  // 2-bit font values are 0 -> white, 1 -> light gray, 2 -> dark gray, 3 -> black. Each render mode selects a subset
+  // of them: BW paints everything that is not white, MSB flags both grays and LSB flags dark gray only. Gray passes
+  // always write "false" since the gray buffers flag pixels in reverse (0 leave alone, 1 update).
+  const bool is2Bit = fontData.is2Bit;
+  uint8_t selectedValues = 0b1110;
+  bool state = pixelState;
+  if (is2Bit && renderMode == GRAYSCALE_MSB) {
+    selectedValues = 0b0110;
+    state = false;
+  } else if (is2Bit && renderMode == GRAYSCALE_LSB) {
+    selectedValues = 0b0100;
+    state = false;
+  }
+
+  const uint8_t* bitmap = &fontData.bitmap[glyph.dataOffset];
+
+#if defined(PLATFORM_M5PAPER)
+  if (renderMode == GRAYSCALE_4BPP) {
+    uint8_t* grayBuffer = display.getGrayFrameBuffer();
+    if (!grayBuffer) {
+      return;
+    }
+    for (int outer = outerBegin; outer < outerEnd; outer++) {
+      uint8_t* row = grayBuffer + (panelY + outer * outerStep) * (HalDisplay::DISPLAY_WIDTH / 2);
+      int px = panelX + innerBegin * innerStep;
+      int pos = innerBegin * innerPosStep + outer * outerPosStep;
+
+      for (int inner = innerBegin; inner < innerEnd; inner++, px += innerStep, pos += innerPosStep) {
+        uint8_t level;
         if (is2Bit) {
-          const uint8_t byte = bitmap[pixelPosition / 4];
-          const uint8_t bit_index = (3 - pixelPosition % 4) * 2;
-          // the direct bit from the font is 0 -> white, 1 -> light gray, 2 -> dark gray, 3 -> black
-          // we swap this to better match the way images and screen think about colors:
-          // 0 -> black, 1 -> dark grey, 2 -> light grey, 3 -> white
-          const uint8_t bmpVal = 3 - (byte >> bit_index) & 0x3;
-
-          if (renderMode == BW && bmpVal < 3) {
-            // Black (also paints over the grays in BW mode)
-            drawPixel(screenX, screenY, pixelState);
-          } else if (renderMode == GRAYSCALE_MSB && (bmpVal == 1 || bmpVal == 2)) {
-            // Light gray (also mark the MSB if it's going to be a dark gray too)
-            // We have to flag pixels in reverse for the gray buffers, as 0 leave alone, 1 update
-            drawPixel(screenX, screenY, false);
-          } else if (renderMode == GRAYSCALE_LSB && bmpVal == 1) {
-            // Dark gray
-            drawPixel(screenX, screenY, false);
+          const uint8_t value = (bitmap[pos >> 2] >> ((3 - (pos & 3)) * 2)) & 0x3;
+          if (value == 0) {
+            continue;
           }
+          level = pixelState ? 15 - value * 5 : 15;
         } else {
-          const uint8_t byte = bitmap[pixelPosition / 8];
-          const uint8_t bit_index = 7 - (pixelPosition % 8);
-
-          if ((byte >> bit_index) & 1) {
-            drawPixel(screenX, screenY, pixelState);
+          if (!((bitmap[pos >> 3] >> (7 - (pos & 7))) & 1)) {
+            continue;
           }
+          level = pixelState ? 0 : 15;
         }
+
+        uint8_t& byte = row[px >> 1];
+        const int shift = (px & 1) ? 0 : 4;
+        // Overlapping anti-aliased edges keep the darker coverage when drawing black text
+        if (pixelState && ((byte >> shift) & 0x0F) <= level) {
+          continue;
+        }
+        byte = (byte & ~(0x0F << shift)) | (level << shift);
       }
     }
+    return;
   }
+#endif
 
-  *x += glyph->advanceX;
+  for (int outer = outerBegin; outer < outerEnd; outer++) {
+    uint8_t* row = frameBuffer + (panelY + outer * outerStep) * HalDisplay::DISPLAY_WIDTH_BYTES;
+    int px = panelX + innerBegin * innerStep;
+    int pos = innerBegin * innerPosStep + outer * outerPosStep;
+    int byteX = px >> 3;
+    uint8_t mask = 0;
+
+    for (int inner = innerBegin; inner < innerEnd; inner++, px += innerStep, pos += innerPosStep) {
+      if ((px >> 3) != byteX) {
+        if (mask) {
+          row[byteX] = state ? row[byteX] & ~mask : row[byteX] | mask;
+        }
+        mask = 0;
+        byteX = px >> 3;
+      }
+
+      bool selected;
+      if (is2Bit) {
+        const uint8_t value = (bitmap[pos >> 2] >> ((3 - (pos & 3)) * 2)) & 0x3;
+        selected = (selectedValues >> value) & 1;
+      } else {
+        selected = (bitmap[pos >> 3] >> (7 - (pos & 7))) & 1;
+      }
+      if (selected) {
+        mask |= 0x80 >> (px & 7);  // MSB first
+      }
+    }
+
+    if (mask) {
+      row[byteX] = state ? row[byteX] & ~mask : row[byteX] | mask;
+    }
+  }
 }
 
 void GfxRenderer::getOrientedViewableTRBL(int* outTop, int* outRight, int* outBottom, int* outLeft) const {
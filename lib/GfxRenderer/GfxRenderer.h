@@ -9,7 +9,8 @@
 
 class GfxRenderer {
  public:
-  enum RenderMode { BW, GRAYSCALE_LSB, GRAYSCALE_MSB };
+  // GRAYSCALE_4BPP draws 16-level gray straight into the panel's native 4bpp buffer (PLATFORM_M5PAPER only)
+  enum RenderMode { BW, GRAYSCALE_LSB, GRAYSCALE_MSB, GRAYSCALE_4BPP };
 
   // Logical screen orientation from the perspective of callers
   enum Orientation {
@@ -34,9 +35,33 @@ class GfxRenderer {
   Orientation orientation;
   uint8_t* bwBufferChunks[BW_BUFFER_NUM_CHUNKS] = {nullptr};
   std::map<int, EpdFontFamily> fontMap;
+  // Panel-space regions drawn since the last push (max is exclusive). They are kept apart rather than unioned, so a
+  // fast refresh only rewrites what was drawn; on M5Paper the gray pixels of a 4bpp page in between stay as they are.
+  struct DirtyRect {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+  };
+  static constexpr int MAX_DIRTY_RECTS = 4;
+  // Marks closer than this join one rect
+  static constexpr int DIRTY_MERGE_GAP = 16;
+  mutable DirtyRect dirtyRects[MAX_DIRTY_RECTS] = {{0, 0, HalDisplay::DISPLAY_WIDTH, HalDisplay::DISPLAY_HEIGHT}};
+  mutable int dirtyRectCount = 1;
   void renderChar(const EpdFontFamily& fontFamily, uint32_t cp, int* x, const int* y, bool pixelState,
                   EpdFontFamily::Style style) const;
+  void blitGlyph(const EpdFontData& fontData, const EpdGlyph& glyph, int originX, int originY, int colStepX,
+                 int colStepY, int rowStepX, int rowStepY, bool pixelState) const;
+  template <typename FetchTile>
+  void blitMaskTiles(int originX, int originY, int width, int height, bool state, FetchTile fetchTile) const;
   void freeBwBufferChunks();
+  void markDirty(int panelX, int panelY, int width, int height) const;
+  void mergeDirtyRect(int index) const;
+  void markAllDirty() const;
+  void clearDirty() const;
+#if defined(PLATFORM_M5PAPER)
+  void drawPixelGray(int x, int y, uint8_t level) const;
+#endif
   void rotateCoordinates(int x, int y, int* rotatedX, int* rotatedY) const;
 
  public:
@@ -58,18 +83,28 @@ class GfxRenderer {
   // Screen ops
   int getScreenWidth() const;
   int getScreenHeight() const;
+  // Fast refreshes only push the dirty region; HALF/FULL refreshes always push the whole frame
   void displayBuffer(HalDisplay::RefreshMode refreshMode = HalDisplay::FAST_REFRESH) const;
-  // EXPERIMENTAL: Windowed update - display only a rectangular region
-  // void displayWindow(int x, int y, int width, int height) const;
+  // Windowed update - fast refresh of a logical rectangular region
+  void displayWindow(int x, int y, int width, int height) const;
   void invertScreen() const;
   void clearScreen(uint8_t color = 0xFF) const;
 
   // Drawing
+  // No dirty tracking per pixel: callers plotting shapes with drawPixel mark the box they drew in once
   void drawPixel(int x, int y, bool state = true) const;
+  void markRegionDirty(int x, int y, int width, int height) const;
   void drawLine(int x1, int y1, int x2, int y2, bool state = true) const;
   void drawRect(int x, int y, int width, int height, bool state = true) const;
   void fillRect(int x, int y, int width, int height, bool state = true) const;
   void drawImage(const uint8_t bitmap[], int x, int y, int width, int height) const;
+  // Packed bitmap blits with the top left corner at (x, y), rotated like drawPixel but 8x8 pixels at a time.
+  // Rows: row-major, MSB first, (width + 7) / 8 bytes per row; draws the set bits, or the clear ones with invert.
+  void drawPackedRows(const uint8_t* rows, int x, int y, int width, int height, bool invert, bool state = true) const;
+  // Two bit planes, column-major with columns right to left and (height + 7) / 8 bytes per column, MSB on top. A
+  // pixel's value is (plane1 bit << 1) | plane2 bit; pixels whose value has its bit set in selectedValues are drawn.
+  void drawPackedColumnPlanes(const uint8_t* plane1, const uint8_t* plane2, int x, int y, int width, int height,
+                              uint8_t selectedValues, bool state = true) const;
   void drawBitmap(const Bitmap& bitmap, int x, int y, int maxWidth, int maxHeight, float cropX = 0,
                   float cropY = 0) const;
   void drawBitmap1Bit(const Bitmap& bitmap, int x, int y, int maxWidth, int maxHeight) const;
@@ -82,6 +117,8 @@ class GfxRenderer {
   void drawText(int fontId, int x, int y, const char* text, bool black = true,
                 EpdFontFamily::Style style = EpdFontFamily::REGULAR) const;
   int getSpaceWidth(int fontId) const;
+  // For measuring glyph by glyph, nullptr if fontId isn't loaded
+  const EpdFontFamily* getFontFamily(int fontId) const;
   int getFontAscenderSize(int fontId) const;
   int getLineHeight(int fontId) const;
   std::string truncatedText(int fontId, const char* text, int maxWidth,
@@ -1,6 +1,7 @@
 #include "JpegToBmpConverter.h"
 
 #include <HardwareSerial.h>
+#include <MemTrack.h>
 #include <SdFat.h>
 #include <picojpeg.h>
 
@@ -280,7 +281,7 @@ bool JpegToBmpConverter::jpegFileToBmpStreamInternal(FsFile& jpegFile, Print& bm
   }
 
   // Allocate row buffer
-  auto* rowBuffer = static_cast<uint8_t*>(malloc(bytesPerRow));
+  auto* rowBuffer = static_cast<uint8_t*>(memtrack::allocate(memtrack::Tag::Jpeg, bytesPerRow));
   if (!rowBuffer) {
     Serial.printf("[%lu] [JPG] Failed to allocate row buffer\n", millis());
     return false;
@@ -295,14 +296,14 @@ bool JpegToBmpConverter::jpegFileToBmpStreamInternal(FsFile& jpegFile, Print& bm
   if (mcuRowPixels > MAX_MCU_ROW_BYTES) {
     Serial.printf("[%lu] [JPG] MCU row buffer too large (%d bytes), max: %d\n", millis(), mcuRowPixels,
                   MAX_MCU_ROW_BYTES);
-    free(rowBuffer);
+    memtrack::release(rowBuffer);
     return false;
   }
 
-  auto* mcuRowBuffer = static_cast<uint8_t*>(malloc(mcuRowPixels));
+  auto* mcuRowBuffer = static_cast<uint8_t*>(memtrack::allocate(memtrack::Tag::Jpeg, mcuRowPixels));
   if (!mcuRowBuffer) {
     Serial.printf("[%lu] [JPG] Failed to allocate MCU row buffer (%d bytes)\n", millis(), mcuRowPixels);
-    free(rowBuffer);
+    memtrack::release(rowBuffer);
     return false;
   }
 
@@ -330,10 +331,12 @@ bool JpegToBmpConverter::jpegFileToBmpStreamInternal(FsFile& jpegFile, Print& bm
   uint16_t* rowCount = nullptr;    // Count of source pixels accumulated per output X
   int currentOutY = 0;             // Current output row being accumulated
   uint32_t nextOutY_srcStart = 0;  // Source Y where next output row starts (16.16 fixed point)
+  memtrack::Charge scalingCharge(memtrack::Tag::Jpeg);
 
   if (needsScaling) {
     rowAccum = new uint32_t[outWidth]();
     rowCount = new uint16_t[outWidth]();
+    scalingCharge.set(outWidth * (sizeof(uint32_t) + sizeof(uint16_t)));
     nextOutY_srcStart = scaleY_fp;  // First boundary is at scaleY_fp (source Y for outY=1)
   }
 
@@ -354,8 +357,8 @@ bool JpegToBmpConverter::jpegFileToBmpStreamInternal(FsFile& jpegFile, Print& bm
           Serial.printf("[%lu] [JPG] JPEG decode MCU failed at (%d, %d) with error code: %d\n", millis(), mcuX, mcuY,
                         mcuStatus);
         }
-        free(mcuRowBuffer);
-        free(rowBuffer);
+        memtrack::release(mcuRowBuffer);
+        memtrack::release(rowBuffer);
         return false;
       }
 
@@ -546,8 +549,8 @@ bool JpegToBmpConverter::jpegFileToBmpStreamInternal(FsFile& jpegFile, Print& bm
   if (atkinson1BitDitherer) {
     delete atkinson1BitDitherer;
   }
-  free(mcuRowBuffer);
-  free(rowBuffer);
+  memtrack::release(mcuRowBuffer);
+  memtrack::release(rowBuffer);
 
   Serial.printf("[%lu] [JPG] Successfully converted JPEG to BMP\n", millis());
   return true;
@@ -0,0 +1,136 @@
+#include "MemTrack.h"
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+namespace memtrack {
+namespace {
+struct Counters {
+  std::atomic<size_t> current{0};
+  std::atomic<size_t> peak{0};
+  std::atomic<size_t> psram{0};
+  std::atomic<uint32_t> failures{0};
+  std::atomic<size_t> largestFailure{0};
+};
+
+Counters counters[TAG_COUNT];
+
+const char* const TAG_NAMES[TAG_COUNT] = {"fonts",          "gfx_bw_chunks", "zip_inflate", "section_build",
+                                          "metadata_cache", "jpeg",          "web_upload",  "xtc_pages"};
+
+// Sits in front of every block from allocate(), keeping the block's payload aligned like malloc's
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+  size_t size;
+  Tag tag;
+  bool psram;
+};
+
+Counters& countersFor(const Tag tag) { return counters[static_cast<size_t>(tag)]; }
+
+void raiseTo(std::atomic<size_t>& value, const size_t candidate) {
+  size_t seen = value.load(std::memory_order_relaxed);
+  while (candidate > seen && !value.compare_exchange_weak(seen, candidate, std::memory_order_relaxed)) {
+  }
+}
+
+void* payloadOf(BlockHeader* header) { return header + 1; }
+BlockHeader* headerOf(void* ptr) { return static_cast<BlockHeader*>(ptr) - 1; }
+}  // namespace
+
+const char* getTagName(const Tag tag) { return tag < Tag::Count ? TAG_NAMES[static_cast<size_t>(tag)] : "unknown"; }
+
+TagStats getStats(const Tag tag) {
+  const Counters& c = countersFor(tag);
+  TagStats stats;
+  stats.current = c.current.load(std::memory_order_relaxed);
+  stats.peak = c.peak.load(std::memory_order_relaxed);
+  stats.psram = c.psram.load(std::memory_order_relaxed);
+  stats.failures = c.failures.load(std::memory_order_relaxed);
+  stats.largestFailure = c.largestFailure.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void resetPeaks() {
+  for (auto& c : counters) {
+    c.peak.store(c.current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+}
+
+void charge(const Tag tag, const size_t size, const bool psram) {
+  Counters& c = countersFor(tag);
+  const size_t current = c.current.fetch_add(size, std::memory_order_relaxed) + size;
+  raiseTo(c.peak, current);
+  if (psram) {
+    c.psram.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+void discharge(const Tag tag, const size_t size, const bool psram) {
+  Counters& c = countersFor(tag);
+  c.current.fetch_sub(size, std::memory_order_relaxed);
+  if (psram) {
+    c.psram.fetch_sub(size, std::memory_order_relaxed);
+  }
+}
+
+void noteFailure(const Tag tag, const size_t size) {
+  Counters& c = countersFor(tag);
+  c.failures.fetch_add(1, std::memory_order_relaxed);
+  raiseTo(c.largestFailure, size);
+  Serial.printf("[%lu] [MEM] %s: failed to allocate %u bytes\n", millis(), getTagName(tag),
+                static_cast<unsigned>(size));
+}
+
+void* allocate(const Tag tag, const size_t size, const bool preferPsram) {
+  const size_t total = sizeof(BlockHeader) + size;
+  bool psram = false;
+  void* block = nullptr;
+  if (preferPsram) {
+    block = ps_malloc(total);
+    psram = block != nullptr;
+  }
+  if (!block) {
+    block = malloc(total);
+  }
+  if (!block) {
+    noteFailure(tag, size);
+    return nullptr;
+  }
+  auto* header = static_cast<BlockHeader*>(block);
+  header->size = size;
+  header->tag = tag;
+  header->psram = psram;
+  charge(tag, size, psram);
+  return payloadOf(header);
+}
+
+void* reallocate(const Tag tag, void* ptr, const size_t size) {
+  if (!ptr) {
+    return allocate(tag, size);
+  }
+  BlockHeader* header = headerOf(ptr);
+  const BlockHeader old = *header;
+  // Blocks that get reallocated (expat's) never ask for PSRAM, so old.psram stays right for the moved block
+  auto* moved = static_cast<BlockHeader*>(realloc(header, sizeof(BlockHeader) + size));
+  if (!moved) {
+    noteFailure(old.tag, size);
+    return nullptr;
+  }
+  discharge(old.tag, old.size, old.psram);
+  moved->size = size;
+  charge(old.tag, size, old.psram);
+  return payloadOf(moved);
+}
+
+void release(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  BlockHeader* header = headerOf(ptr);
+  discharge(header->tag, header->size, header->psram);
+  free(header);
+}
+}  // namespace memtrack
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Tagged accounting of the big heap and PSRAM consumers, so an OOM on a large book can be pinned on a stage rather
+// than on "free heap dropped". Each tag keeps its current and peak bytes, how much of that sits in PSRAM, and how many
+// allocations failed along with the largest failed request. All counters are atomic; allocating and releasing is safe
+// from any task.
+//
+// There are three ways to put memory on a tag:
+//  - allocate()/reallocate()/release() replace malloc/realloc/free and remember the tag and size in a small header
+//  - Allocator<T, tag> is a std::allocator stand-in for containers
+//  - charge()/discharge() (or a Charge) account for memory someone else owns, like a library's receive buffer
+namespace memtrack {
+enum class Tag : uint8_t {
+  Fonts,           // SD font glyph data and bitmaps
+  RendererChunks,  // GfxRenderer BW buffer backup chunks
+  ZipInflate,      // ZipSession inflate state (decompressor, window, input buffer)
+  SectionBuild,    // XML parser and page LUT while a section is laid out
+  MetadataCache,   // BookMetadataCache spine/TOC indexes
+  Jpeg,            // JpegToBmpConverter row buffers
+  WebUpload,       // WebSocket upload frames
+  XtcPages,        // XTC reader page prefetch ring
+  Count
+};
+constexpr size_t TAG_COUNT = static_cast<size_t>(Tag::Count);
+
+struct TagStats {
+  size_t current;
+  size_t peak;
+  size_t psram;  // Part of current that is in PSRAM
+  uint32_t failures;
+  size_t largestFailure;  // Size of the biggest request that failed
+};
+
+const char* getTagName(Tag tag);
+TagStats getStats(Tag tag);
+// Lowers every peak to the current value
+void resetPeaks();
+
+// malloc/realloc/free on a tag. With preferPsram the block comes from PSRAM when there is any, else internal heap.
+// A block keeps the tag it was allocated with, reallocate() only uses tag when ptr is nullptr.
+void* allocate(Tag tag, size_t size, bool preferPsram = false);
+void* reallocate(Tag tag, void* ptr, size_t size);
+void release(void* ptr);
+
+void charge(Tag tag, size_t size, bool psram = false);
+void discharge(Tag tag, size_t size, bool psram = false);
+void noteFailure(Tag tag, size_t size);
+
+// Keeps size bytes charged to a tag for its lifetime, set() moves the charge to a new size
+class Charge {
+  Tag tag;
+  size_t size = 0;
+
+ public:
+  explicit Charge(const Tag tag, const size_t size = 0) : tag(tag) { set(size); }
+  ~Charge() { set(0); }
+  Charge(const Charge&) = delete;
+  Charge& operator=(const Charge&) = delete;
+
+  void set(const size_t newSize) {
+    if (newSize > size) {
+      charge(tag, newSize - size);
+    } else if (newSize < size) {
+      discharge(tag, size - newSize);
+    }
+    size = newSize;
+  }
+};
+
+// Container allocator charging its storage to a tag. Fails like std::allocator once the failure is counted.
+template <typename T, Tag tag>
+struct Allocator {
+  using value_type = T;
+  template <typename U>
+  struct rebind {
+    using other = Allocator<U, tag>;
+  };
+
+  Allocator() = default;
+  template <typename U>
+  Allocator(const Allocator<U, tag>&) {}
+
+  T* allocate(const size_t count) {
+    const size_t size = count * sizeof(T);
+    void* ptr = ::operator new(size, std::nothrow);
+    if (!ptr) {
+      noteFailure(tag, size);
+      ptr = ::operator new(size);
+    }
+    charge(tag, size);
+    return static_cast<T*>(ptr);
+  }
+  void deallocate(T* ptr, const size_t count) {
+    discharge(tag, count * sizeof(T));
+    ::operator delete(ptr);
+  }
+
+  template <typename U>
+  bool operator==(const Allocator<U, tag>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const Allocator<U, tag>&) const {
+    return false;
+  }
+};
+}  // namespace memtrack
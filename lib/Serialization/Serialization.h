@@ -1,7 +1,9 @@
 #pragma once
 #include <SdFat.h>
 
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace serialization {
 template <typename T>
@@ -49,4 +51,44 @@ static void readString(FsFile& file, std::string& s) {
   s.resize(len);
   file.read(&s[0], len);
 }
+
+// In-memory records, for formats that are written and read back in one go. Readers bounds-check against end and
+// leave the cursor just past the value.
+template <typename T>
+static void appendPod(std::vector<uint8_t>& out, const T& value) {
+  const size_t offset = out.size();
+  out.resize(offset + sizeof(T));
+  memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+static bool readPod(const uint8_t*& cursor, const uint8_t* end, T& value) {
+  if (end - cursor < static_cast<ptrdiff_t>(sizeof(T))) {
+    return false;
+  }
+  memcpy(&value, cursor, sizeof(T));
+  cursor += sizeof(T);
+  return true;
+}
+
+// LEB128: 7 bits per byte, high bit set on every byte but the last
+static void appendVarint(std::vector<uint8_t>& out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool readVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 35 && cursor < end; shift += 7) {
+    const uint8_t byte = *cursor++;
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
 }  // namespace serialization
@@ -0,0 +1,123 @@
+#include "Trace.h"
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <cstdio>
+#include <new>
+
+namespace trace {
+namespace {
+// sequence is the event's index + 1 once the event is complete, 0 while a writer is filling it in. A reader that
+// sees the same expected sequence before and after copying the event got a consistent copy.
+struct Slot {
+  std::atomic<uint32_t> sequence{0};
+  Event event{};
+};
+
+Slot* slots = nullptr;
+uint32_t capacityMask = 0;
+std::atomic<uint32_t> nextIndex{0};
+std::atomic<bool> enabled{false};
+
+bool readSlot(const uint32_t index, Event* event) {
+  const Slot& slot = slots[index & capacityMask];
+  const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+  if (before != index + 1) {
+    return false;
+  }
+  *event = slot.event;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+}  // namespace
+
+bool begin(const size_t capacity) {
+  if (slots) {
+    return true;
+  }
+  uint32_t count = 1;
+  while (count * 2 <= capacity) {
+    count *= 2;
+  }
+  void* memory = ps_malloc(sizeof(Slot) * count);
+  if (!memory) {
+    Serial.printf("[%lu] [TRC] No PSRAM for %u trace events, tracing off\n", millis(), count);
+    return false;
+  }
+  slots = static_cast<Slot*>(memory);
+  for (uint32_t i = 0; i < count; i++) {
+    new (&slots[i]) Slot();
+  }
+  capacityMask = count - 1;
+  enabled.store(true, std::memory_order_release);
+  Serial.printf("[%lu] [TRC] Tracing %u events (%u bytes)\n", millis(), count,
+                static_cast<unsigned>(sizeof(Slot) * count));
+  return true;
+}
+
+bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+void record(const char* category, const char* name, const Phase phase) {
+  if (!enabled.load(std::memory_order_acquire)) {
+    return;
+  }
+  const uint32_t timestampUs = micros();
+  const uint32_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots[index & capacityMask];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event.timestampUs = timestampUs;
+  slot.event.taskId = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle()));
+  slot.event.category = category;
+  slot.event.name = name;
+  slot.event.core = static_cast<uint8_t>(xPortGetCoreID());
+  slot.event.phase = phase;
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void clear() {
+  if (!slots) {
+    return;
+  }
+  // Stale slots no longer match the sequence a reader expects once the index moves past them
+  nextIndex.fetch_add(capacityMask + 1, std::memory_order_relaxed);
+}
+
+size_t writeChromeJson(Print& out) {
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  size_t written = 0;
+  if (slots) {
+    const uint32_t end = nextIndex.load(std::memory_order_acquire);
+    const uint32_t capacity = capacityMask + 1;
+    uint32_t start = end > capacity ? end - capacity : 0;
+    bool haveBase = false;
+    uint32_t baseUs = 0;
+    Event event;
+    for (uint32_t index = start; index != end; index++) {
+      if (!readSlot(index, &event)) {
+        continue;
+      }
+      if (!haveBase) {
+        baseUs = event.timestampUs;
+        haveBase = true;
+      }
+      char line[192];
+      const int length = snprintf(line, sizeof(line),
+                                  "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%lu,%s"
+                                  "\"args\":{\"core\":%u}}",
+                                  written ? ",\n" : "\n", event.name, event.category, static_cast<char>(event.phase),
+                                  static_cast<unsigned long>(event.timestampUs - baseUs),
+                                  static_cast<unsigned long>(event.taskId),
+                                  event.phase == Phase::Instant ? "\"s\":\"t\"," : "", event.core);
+      if (length <= 0 || static_cast<size_t>(length) >= sizeof(line)) {
+        continue;
+      }
+      out.write(reinterpret_cast<const uint8_t*>(line), length);
+      written++;
+    }
+  }
+  out.print("\n]}\n");
+  return written;
+}
+}  // namespace trace
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Print;
+
+// Hot-path tracing into a fixed-size ring buffer in PSRAM. Recording is lock-free and safe from any task on either
+// core; once the ring is full the oldest events are overwritten. Nothing is recorded until begin() succeeds, so the
+// cost of an unused TRACE_SCOPE is one atomic load.
+//
+//   void Section::createSectionFile(...) {
+//     TRACE_SCOPE("layout", "section_build");
+//     ...
+//   }
+//
+// Category and name must be string literals (or otherwise outlive the ring): only the pointers are stored, and they
+// are written to the JSON export unescaped.
+namespace trace {
+constexpr size_t DEFAULT_CAPACITY = 4096;  // ~96 KB of PSRAM on the ESP32
+
+enum class Phase : char { Begin = 'B', End = 'E', Instant = 'i' };
+
+struct Event {
+  uint32_t timestampUs;  // micros(), wraps every ~71 minutes
+  uint32_t taskId;       // FreeRTOS task handle of the recording task
+  const char* category;
+  const char* name;
+  uint8_t core;
+  Phase phase;
+};
+
+// Allocates a ring of capacity events (rounded down to a power of two) and starts recording. Fails, leaving tracing
+// off, when PSRAM can't hold the ring. Call once at startup before other tasks trace.
+bool begin(size_t capacity = DEFAULT_CAPACITY);
+bool isEnabled();
+void record(const char* category, const char* name, Phase phase);
+// Drops every recorded event
+void clear();
+
+// Writes the recorded events, oldest first, as a Chrome trace-event JSON object (chrome://tracing, Perfetto).
+// Timestamps are relative to the oldest event. Events being written while exporting are skipped, recording carries on.
+// Returns the number of events written.
+size_t writeChromeJson(Print& out);
+
+// Records a begin event now and the matching end event when it goes out of scope
+class Scope {
+  const char* category;
+  const char* name;
+
+ public:
+  Scope(const char* category, const char* name) : category(category), name(name) {
+    record(category, name, Phase::Begin);
+  }
+  ~Scope() { record(category, name, Phase::End); }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+}  // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) const trace::Scope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define TRACE_INSTANT(category, name) trace::record(category, name, trace::Phase::Instant)
@@ -0,0 +1,244 @@
+#include "TxtLayout.h"
+
+#include <GfxRenderer.h>
+#include <Utf8.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Txt.h"
+
+namespace {
+// Where to end the first wrapped line of text[0, length) so it is at most maxWidth wide, found in a single pass over
+// the glyphs. Widths match getTextWidth(): a prefix is as wide as the span of its glyph boxes, which never shrinks as
+// glyphs are added, so the pass stops at the first glyph that overflows. Prefers the last space that fits (the caller
+// skips the space), then the last character that fits, then one character so every line makes progress. Returns
+// length when the whole text fits.
+size_t findLineBreak(const EpdFontFamily& font, const uint8_t* text, const size_t length, const int maxWidth) {
+  int cursorX = 0;
+  int minX = 0;
+  int maxX = 0;
+  size_t lastFitSpace = 0;  // A space at 0 is never a break
+  size_t lastFitChar = 0;
+  size_t firstCharEnd = length;
+  size_t pos = 0;
+
+  while (pos < length) {
+    // text[0, pos) fits
+    if (text[pos] == ' ' && pos > 0) {
+      lastFitSpace = pos;
+    }
+    lastFitChar = pos;
+
+    const uint8_t* next = text + pos;
+    const uint32_t cp = utf8NextCodepoint(&next);
+    const size_t charEnd = cp == 0 ? pos + 1 : std::min(static_cast<size_t>(next - text), length);
+    if (pos == 0) {
+      firstCharEnd = charEnd;
+    }
+
+    const EpdGlyph* glyph = cp == 0 ? nullptr : font.getGlyph(cp);
+    if (cp != 0 && !glyph) {
+      glyph = font.getGlyph(REPLACEMENT_GLYPH);
+    }
+    if (glyph) {
+      minX = std::min(minX, cursorX + glyph->left);
+      maxX = std::max(maxX, cursorX + glyph->left + glyph->width);
+      cursorX += glyph->advanceX;
+      if (maxX - minX > maxWidth) {
+        break;
+      }
+    }
+    pos = charEnd;
+  }
+
+  if (pos >= length) {
+    return length;
+  }
+  if (lastFitSpace > 0) {
+    return lastFitSpace;
+  }
+  return lastFitChar > 0 ? lastFitChar : firstCharEnd;
+}
+}  // namespace
+
+TxtLayout::~TxtLayout() { free(chunkBuffer); }
+
+bool TxtLayout::ensureChunkBuffer() const {
+  if (!chunkBuffer) {
+    chunkBuffer = static_cast<uint8_t*>(malloc(CHUNK_SIZE + CHUNK_PADDING));
+    if (!chunkBuffer) {
+      Serial.printf("[%lu] [TXT] Failed to allocate %zu bytes\n", millis(), CHUNK_SIZE + CHUNK_PADDING);
+      return false;
+    }
+  }
+  return true;
+}
+
+TxtLayout::PageStep TxtLayout::nextPageStart(const size_t offset, size_t& nextOffset) const {
+  const PageStep step = layoutLines(offset, scratchLines, nullptr, nextOffset);
+  if (step != PageStep::Next) {
+    return step;
+  }
+  // No progress made means no next page either, avoid an infinite loop
+  return nextOffset > offset && nextOffset < txt.getFileSize() ? PageStep::Next : PageStep::End;
+}
+
+bool TxtLayout::findParagraphStart(const size_t offset, size_t& start) const {
+  if (!ensureChunkBuffer()) {
+    return false;
+  }
+  // The byte before offset may be the paragraph's own newline, the newline before that ends the previous paragraph
+  size_t end = offset - 1;
+  while (end > 0) {
+    const size_t chunkStart = end > CHUNK_SIZE ? end - CHUNK_SIZE : 0;
+    if (!txt.readContent(chunkBuffer, chunkStart, end - chunkStart)) {
+      return false;
+    }
+    for (size_t i = end - chunkStart; i-- > 0;) {
+      if (chunkBuffer[i] == '\n') {
+        start = chunkStart + i + 1;
+        return true;
+      }
+    }
+    end = chunkStart;
+  }
+  start = 0;
+  return true;
+}
+
+bool TxtLayout::previousPageStart(const size_t offset, size_t& previousOffset) const {
+  if (offset == 0 || offset > txt.getFileSize()) {
+    return false;
+  }
+
+  const auto pageLines = static_cast<size_t>(linesPerPage);
+  std::vector<size_t> lineStarts;  // Of every line from the paragraph start reached so far up to offset
+  std::vector<size_t> paragraphLines;
+  size_t end = offset;
+  while (end > 0 && lineStarts.size() < pageLines) {
+    size_t start;
+    if (!findParagraphStart(end, start)) {
+      return false;
+    }
+    paragraphLines.clear();
+    size_t position = start;
+    while (position < end) {
+      size_t next;
+      const PageStep step = layoutLines(position, scratchLines, &paragraphLines, next);
+      if (step == PageStep::Failed) {
+        return false;
+      }
+      if (step == PageStep::End || next <= position) {
+        break;
+      }
+      position = next;
+    }
+    // The last page may run on past end, and a blank paragraph only has lines after it
+    while (!paragraphLines.empty() && paragraphLines.back() >= end) {
+      paragraphLines.pop_back();
+    }
+    lineStarts.insert(lineStarts.begin(), paragraphLines.begin(), paragraphLines.end());
+    end = start;
+  }
+
+  previousOffset = lineStarts.size() >= pageLines ? lineStarts[lineStarts.size() - pageLines] : 0;
+  return true;
+}
+
+bool TxtLayout::layoutPage(const size_t offset, std::vector<std::string>& outLines, size_t& nextOffset) const {
+  return layoutLines(offset, outLines, nullptr, nextOffset) == PageStep::Next;
+}
+
+TxtLayout::PageStep TxtLayout::layoutLines(const size_t offset, std::vector<std::string>& outLines,
+                                           std::vector<size_t>* lineStarts, size_t& nextOffset) const {
+  outLines.clear();
+  const size_t fileSize = txt.getFileSize();
+
+  if (offset >= fileSize) {
+    return PageStep::End;
+  }
+
+  const EpdFontFamily* font = renderer.getFontFamily(fontId);
+  if (!font || !ensureChunkBuffer()) {
+    return PageStep::Failed;
+  }
+
+  // Read a chunk from file
+  const size_t chunkSize = std::min(CHUNK_SIZE, fileSize - offset);
+  uint8_t* buffer = chunkBuffer;
+  if (!txt.readContent(buffer, offset, chunkSize)) {
+    return PageStep::Failed;
+  }
+  memset(buffer + chunkSize, 0, CHUNK_PADDING);
+
+  // Parse lines from buffer
+  size_t pos = 0;
+
+  while (pos < chunkSize && static_cast<int>(outLines.size()) < linesPerPage) {
+    // Find end of line
+    const auto* newline = static_cast<const uint8_t*>(memchr(buffer + pos, '\n', chunkSize - pos));
+    const size_t lineEnd = newline ? newline - buffer : chunkSize;
+
+    // Check if we have a complete line
+    bool lineComplete = (lineEnd < chunkSize) || (offset + lineEnd >= fileSize);
+
+    if (!lineComplete && static_cast<int>(outLines.size()) > 0) {
+      // Incomplete line and we already have some lines, stop here
+      break;
+    }
+
+    // Calculate the actual length of line content in the buffer (excluding newline)
+    size_t lineContentLen = lineEnd - pos;
+
+    // Check for carriage return
+    bool hasCR = (lineContentLen > 0 && buffer[pos + lineContentLen - 1] == '\r');
+    size_t displayLen = hasCR ? lineContentLen - 1 : lineContentLen;
+
+    // Bytes of this source line (from pos) already placed on the page
+    size_t lineBytePos = 0;
+
+    // Word wrap if needed
+    while (lineBytePos < displayLen && static_cast<int>(outLines.size()) < linesPerPage) {
+      const uint8_t* rest = buffer + pos + lineBytePos;
+      const size_t restLen = displayLen - lineBytePos;
+      const size_t breakPos = findLineBreak(*font, rest, restLen, viewportWidth);
+      if (lineStarts) {
+        lineStarts->push_back(offset + pos + lineBytePos);
+      }
+      outLines.emplace_back(reinterpret_cast<const char*>(rest), breakPos);
+      lineBytePos += breakPos;
+
+      // Skip space at break point
+      if (breakPos < restLen && rest[breakPos] == ' ') {
+        lineBytePos++;
+      }
+    }
+
+    // Determine how much of the source buffer we consumed
+    if (lineBytePos >= displayLen) {
+      // Fully consumed this source line, move past the newline
+      pos = lineEnd + 1;
+    } else {
+      // Partially consumed - page is full mid-line
+      // Move pos to where we stopped in the line (NOT past the line)
+      pos = pos + lineBytePos;
+      break;
+    }
+  }
+
+  // Ensure we make progress even if calculations go wrong
+  if (pos == 0 && !outLines.empty()) {
+    // Fallback: at minimum, consume something to avoid infinite loop
+    pos = 1;
+  }
+
+  nextOffset = offset + pos;
+
+  // Make sure we don't go past the file
+  if (nextOffset > fileSize) {
+    nextOffset = fileSize;
+  }
+
+  return outLines.empty() ? PageStep::End : PageStep::Next;
+}
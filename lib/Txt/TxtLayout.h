@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GfxRenderer;
+class Txt;
+
+// Wraps the text of a Txt into pages of up to linesPerPage lines, each at most viewportWidth pixels wide in fontId.
+// Pages are addressed by the byte offset they start at. Every page is read into the same chunk buffer, so one
+// TxtLayout must not be used from two tasks at once.
+class TxtLayout {
+  const Txt& txt;
+  const GfxRenderer& renderer;
+  int fontId;
+  int viewportWidth;
+  int linesPerPage;
+  mutable uint8_t* chunkBuffer = nullptr;  // CHUNK_SIZE + CHUNK_PADDING bytes, allocated on first use
+  mutable std::vector<std::string> scratchLines;  // Lines of pages only laid out to find where the next one starts
+
+ public:
+  enum class PageStep { Next, End, Failed };
+
+ private:
+  bool ensureChunkBuffer() const;
+  // layoutPage() that tells the end of the text (End) from a read or allocation failure (Failed), and appends where
+  // each line starts to lineStarts when it isn't null
+  PageStep layoutLines(size_t offset, std::vector<std::string>& outLines, std::vector<size_t>* lineStarts,
+                       size_t& nextOffset) const;
+  // Start of the paragraph the byte before offset belongs to
+  bool findParagraphStart(size_t offset, size_t& start) const;
+
+ public:
+  static constexpr size_t CHUNK_SIZE = 8 * 1024;  // Most of the file read to lay out one page
+  // Zeros after the chunk, so decoding a UTF-8 sequence cut off at the end of the chunk stays in the buffer
+  static constexpr size_t CHUNK_PADDING = 4;
+
+  TxtLayout(const Txt& txt, const GfxRenderer& renderer, const int fontId, const int viewportWidth,
+            const int linesPerPage)
+      : txt(txt), renderer(renderer), fontId(fontId), viewportWidth(viewportWidth), linesPerPage(linesPerPage) {}
+  ~TxtLayout();
+  TxtLayout(const TxtLayout&) = delete;
+  TxtLayout& operator=(const TxtLayout&) = delete;
+
+  // Lays out the page starting at offset, nextOffset receives where the following page starts
+  bool layoutPage(size_t offset, std::vector<std::string>& outLines, size_t& nextOffset) const;
+  // Where the page after the one at offset starts: Next with nextOffset set, End when the page at offset is the last
+  // one, Failed when the text can't be read
+  PageStep nextPageStart(size_t offset, size_t& nextOffset) const;
+  // Start of the page of linesPerPage lines that ends where offset starts, for paging back where no index reaches yet.
+  // Lines wrap the same from the start of their paragraph wherever the pages fall, so this wraps the paragraphs before
+  // offset and counts lines back. False at the start of the text or when it can't be read.
+  bool previousPageStart(size_t offset, size_t& previousOffset) const;
+};
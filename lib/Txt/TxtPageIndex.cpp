@@ -0,0 +1,166 @@
+#include "TxtPageIndex.h"
+
+#include <Serialization.h>
+#include <Trace.h>
+
+#include <algorithm>
+
+#include "TxtLayout.h"
+
+TxtPageIndex::TxtPageIndex(const size_t maxCheckpoints) : maxCheckpoints(std::max<size_t>(maxCheckpoints, 2)) {
+  reset();
+}
+
+void TxtPageIndex::reset() {
+  stride = 1;
+  checkpoints.assign(1, 0);
+  pageCount = 1;
+  lastPageOffset = 0;
+  complete = false;
+  failed = false;
+  window.clear();
+}
+
+void TxtPageIndex::addPage(const uint32_t offset) {
+  const size_t page = pageCount++;
+  lastPageOffset = offset;
+  if (page % stride != 0) {
+    return;
+  }
+
+  checkpoints.push_back(offset);
+  if (checkpoints.size() > maxCheckpoints) {
+    // Every other checkpoint is every checkpoint of twice the stride
+    for (size_t i = 1; i * 2 < checkpoints.size(); i++) {
+      checkpoints[i] = checkpoints[i * 2];
+    }
+    checkpoints.resize((checkpoints.size() + 1) / 2);
+    stride *= 2;
+    window.clear();
+  }
+}
+
+bool TxtPageIndex::extend(const TxtLayout& layout, const int maxPages) {
+  TRACE_SCOPE("txt", "index_extend");
+  failed = false;
+  for (int i = 0; i < maxPages && !complete; i++) {
+    size_t nextOffset;
+    const TxtLayout::PageStep step = layout.nextPageStart(lastPageOffset, nextOffset);
+    if (step == TxtLayout::PageStep::Failed) {
+      failed = true;
+      break;
+    }
+    if (step == TxtLayout::PageStep::End) {
+      complete = true;
+      break;
+    }
+    addPage(nextOffset);
+  }
+  return complete;
+}
+
+bool TxtPageIndex::loadWindow(const TxtLayout& layout, const size_t block) {
+  if (window.empty() || windowBlock != block) {
+    window.assign(1, checkpoints[block]);
+    windowBlock = block;
+  }
+
+  // The block may have grown since it was laid out when it is the last one
+  const size_t blockPages = std::min<size_t>(stride, pageCount - block * stride);
+  while (window.size() < blockPages) {
+    size_t nextOffset;
+    if (layout.nextPageStart(window.back(), nextOffset) != TxtLayout::PageStep::Next) {
+      window.clear();
+      return false;
+    }
+    window.push_back(nextOffset);
+  }
+  return true;
+}
+
+bool TxtPageIndex::getPageOffset(const TxtLayout& layout, const size_t page, size_t& offset) {
+  if (page >= pageCount) {
+    return false;
+  }
+  if (page == pageCount - 1) {
+    offset = lastPageOffset;
+    return true;
+  }
+
+  const size_t block = page / stride;
+  if (page % stride == 0) {
+    offset = checkpoints[block];
+    return true;
+  }
+  if (!loadWindow(layout, block)) {
+    return false;
+  }
+  offset = window[page - block * stride];
+  return true;
+}
+
+bool TxtPageIndex::findPage(const TxtLayout& layout, const size_t offset, size_t& page, size_t& pageOffset) {
+  if (offset >= lastPageOffset) {
+    page = pageCount - 1;
+    pageOffset = lastPageOffset;
+    return true;
+  }
+
+  // checkpoints[0] is 0, so there always is a checkpoint at or before offset
+  const auto checkpoint = std::upper_bound(checkpoints.begin(), checkpoints.end(), offset);
+  const size_t block = checkpoint - checkpoints.begin() - 1;
+  if (!loadWindow(layout, block)) {
+    return false;
+  }
+
+  const auto start = std::upper_bound(window.begin(), window.end(), offset);
+  const size_t indexInBlock = start - window.begin() - 1;
+  page = block * stride + indexInBlock;
+  pageOffset = window[indexInBlock];
+  return true;
+}
+
+void TxtPageIndex::serialize(FsFile& file) const {
+  serialization::writePod(file, static_cast<uint8_t>(complete ? 1 : 0));
+  serialization::writePod(file, static_cast<uint32_t>(pageCount));
+  serialization::writePod(file, stride);
+  serialization::writePod(file, lastPageOffset);
+  serialization::writePod(file, static_cast<uint32_t>(checkpoints.size()));
+  file.write(reinterpret_cast<const uint8_t*>(checkpoints.data()), checkpoints.size() * sizeof(uint32_t));
+}
+
+bool TxtPageIndex::deserialize(FsFile& file) {
+  reset();
+
+  uint8_t storedComplete;
+  uint32_t storedPageCount;
+  uint32_t storedStride;
+  uint32_t storedLastPageOffset;
+  uint32_t count;
+  serialization::readPod(file, storedComplete);
+  serialization::readPod(file, storedPageCount);
+  serialization::readPod(file, storedStride);
+  serialization::readPod(file, storedLastPageOffset);
+  serialization::readPod(file, count);
+
+  // One checkpoint per started block of stride pages, and all of them still in the file
+  if (storedPageCount == 0 || storedStride == 0 || count == 0 || count > maxCheckpoints ||
+      count != (storedPageCount + storedStride - 1) / storedStride ||
+      file.size() - file.position() < count * sizeof(uint32_t)) {
+    return false;
+  }
+
+  checkpoints.resize(count);
+  if (file.read(reinterpret_cast<uint8_t*>(checkpoints.data()), count * sizeof(uint32_t)) !=
+          static_cast<int>(count * sizeof(uint32_t)) ||
+      checkpoints[0] != 0 || !std::is_sorted(checkpoints.begin(), checkpoints.end())) {
+    reset();
+    return false;
+  }
+
+  complete = storedComplete != 0;
+  pageCount = storedPageCount;
+  stride = storedStride;
+  lastPageOffset = storedLastPageOffset;
+  return true;
+}
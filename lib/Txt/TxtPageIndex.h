@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FsFile;
+class TxtLayout;
+
+// Where the pages of a TXT book start, kept sparse so memory stays bounded however long the file is. Only every
+// stride-th page start is stored (a checkpoint); any other page is found by laying out forward from the checkpoint
+// before it. The page starts of the last block laid out that way are kept, so paging back through a block lays it
+// out once.
+//
+// The stride starts at 1 and doubles, dropping every other checkpoint, whenever there would be more than
+// maxCheckpoints of them. A book of any length costs at most maxCheckpoints offsets plus one block of stride offsets.
+class TxtPageIndex {
+  size_t maxCheckpoints;
+  uint32_t stride = 1;
+  std::vector<uint32_t> checkpoints;  // checkpoints[i] is where page i * stride starts
+  size_t pageCount = 1;               // Pages indexed so far, the first page starts at 0 in every file
+  uint32_t lastPageOffset = 0;        // Start of the last indexed page, where indexing carries on
+  bool complete = false;
+  bool failed = false;
+  size_t windowBlock = 0;
+  std::vector<uint32_t> window;  // Page starts of block windowBlock (pages windowBlock * stride onwards)
+
+  void addPage(uint32_t offset);
+  bool loadWindow(const TxtLayout& layout, size_t block);
+
+ public:
+  static constexpr size_t DEFAULT_MAX_CHECKPOINTS = 4096;  // 16 KB of offsets
+
+  explicit TxtPageIndex(size_t maxCheckpoints = DEFAULT_MAX_CHECKPOINTS);
+
+  // Back to an index of just the first page
+  void reset();
+  // Indexes up to maxPages more pages. Returns true once the last page is indexed.
+  bool extend(const TxtLayout& layout, int maxPages);
+
+  bool isComplete() const { return complete; }
+  // The last extend() stopped at a page that couldn't be laid out (the file couldn't be read), not at the end of the
+  // text. The pages indexed so far stay valid and the next extend() tries again.
+  bool hasFailed() const { return failed; }
+  size_t getPageCount() const { return pageCount; }
+  size_t getLastPageOffset() const { return lastPageOffset; }
+  uint32_t getStride() const { return stride; }
+  size_t getCheckpointCount() const { return checkpoints.size(); }
+
+  // Where page starts, false when the page isn't indexed yet or the file can't be read. layout must be the one the
+  // index was built with.
+  bool getPageOffset(const TxtLayout& layout, size_t page, size_t& offset);
+  // The last indexed page starting at or before offset
+  bool findPage(const TxtLayout& layout, size_t offset, size_t& page, size_t& pageOffset);
+
+  void serialize(FsFile& file) const;
+  // False, leaving the index reset, when the data is truncated or inconsistent
+  bool deserialize(FsFile& file);
+};
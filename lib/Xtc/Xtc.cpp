@@ -9,6 +9,7 @@
 
 #include <HardwareSerial.h>
 #include <SDCardManager.h>
+#include <Trace.h>
 
 bool Xtc::load() {
   Serial.printf("[%lu] [XTC] Loading XTC: %s\n", millis(), filepath.c_str());
@@ -591,12 +592,21 @@ uint8_t Xtc::getBitDepth() const {
 }
 
 size_t Xtc::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize) const {
+  TRACE_SCOPE("xtc", "page_load");
   if (!loaded || !parser) {
     return 0;
   }
   return const_cast<xtc::XtcParser*>(parser.get())->loadPage(pageIndex, buffer, bufferSize);
 }
 
+size_t Xtc::loadPagePayload(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize, uint8_t& compression) const {
+  TRACE_SCOPE("xtc", "page_load");
+  if (!loaded || !parser) {
+    return 0;
+  }
+  return const_cast<xtc::XtcParser*>(parser.get())->loadPagePayload(pageIndex, buffer, bufferSize, compression);
+}
+
 xtc::XtcError Xtc::loadPageStreaming(uint32_t pageIndex,
                                      std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
                                      size_t chunkSize) const {
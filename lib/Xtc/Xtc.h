@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 
+#include "Xtc/XtcPageBands.h"
 #include "Xtc/XtcParser.h"
 #include "Xtc/XtcTypes.h"
 
@@ -82,6 +83,16 @@ class Xtc {
    */
   size_t loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize) const;
 
+  /**
+   * Load page bitmap as stored, without decompressing it (see xtc::PageBands)
+   * @param pageIndex Page index (0-based)
+   * @param buffer Output buffer
+   * @param bufferSize Buffer size
+   * @param compression Set to the page's compression
+   * @return Number of bytes read
+   */
+  size_t loadPagePayload(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize, uint8_t& compression) const;
+
   /**
    * Load page with streaming callback
    * @param pageIndex Page index
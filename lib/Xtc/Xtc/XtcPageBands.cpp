@@ -0,0 +1,196 @@
+/**
+ * XtcPageBands.cpp
+ *
+ * Streaming access to XTC/XTCH page bitmaps, compressed or not
+ * XTC ebook support for CrossPoint Reader
+ */
+
+#include "XtcPageBands.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "XtcTypes.h"
+
+namespace xtc {
+
+void PackBitsDecoder::decode(const uint8_t*& in, const uint8_t* inEnd, uint8_t*& out, uint8_t* outEnd) {
+  while (out < outEnd) {
+    if (m_remaining == 0) {
+      if (in == inEnd) {
+        return;
+      }
+      const int header = static_cast<int8_t>(*in++);
+      if (header >= 0) {
+        m_remaining = header + 1;
+        m_repeating = false;
+      } else if (header != -128) {
+        m_remaining = 1 - header;
+        m_repeating = true;
+        m_needValue = true;
+      }
+      continue;
+    }
+
+    if (m_repeating) {
+      if (m_needValue) {
+        if (in == inEnd) {
+          return;
+        }
+        m_value = *in++;
+        m_needValue = false;
+      }
+      const size_t count = std::min<size_t>(m_remaining, outEnd - out);
+      memset(out, m_value, count);
+      out += count;
+      m_remaining -= count;
+    } else {
+      const size_t count = std::min<size_t>({m_remaining, static_cast<size_t>(outEnd - out),
+                                             static_cast<size_t>(inEnd - in)});
+      if (count == 0) {
+        return;
+      }
+      memcpy(out, in, count);
+      in += count;
+      out += count;
+      m_remaining -= count;
+    }
+  }
+}
+
+size_t PackBitsDecoder::skip(const uint8_t*& in, const uint8_t* inEnd, const size_t count) {
+  uint8_t scratch[256];
+  size_t skipped = 0;
+  while (skipped < count) {
+    uint8_t* out = scratch;
+    decode(in, inEnd, out, scratch + std::min(sizeof(scratch), count - skipped));
+    if (out == scratch) {
+      break;
+    }
+    skipped += out - scratch;
+  }
+  return skipped;
+}
+
+void packBitsEncode(const uint8_t* data, const size_t size, std::vector<uint8_t>& out) {
+  size_t i = 0;
+  while (i < size) {
+    // A run of 3 or more is worth a repeat, shorter ones go into the literal
+    size_t run = 1;
+    while (i + run < size && run < 128 && data[i + run] == data[i]) {
+      run++;
+    }
+    if (run >= 3) {
+      out.push_back(static_cast<uint8_t>(1 - static_cast<int>(run)));
+      out.push_back(data[i]);
+      i += run;
+      continue;
+    }
+
+    size_t literal = 0;
+    while (i + literal < size && literal < 128) {
+      if (i + literal + 2 < size && data[i + literal] == data[i + literal + 1] &&
+          data[i + literal] == data[i + literal + 2]) {
+        break;
+      }
+      literal++;
+    }
+    out.push_back(static_cast<uint8_t>(literal - 1));
+    out.insert(out.end(), data + i, data + i + literal);
+    i += literal;
+  }
+}
+
+size_t PageBands::getBitmapSize(const uint16_t width, const uint16_t height, const uint8_t bitDepth) {
+  if (bitDepth == 2) {
+    return ((static_cast<size_t>(width) * height + 7) / 8) * 2;
+  }
+  return ((width + 7) / 8) * static_cast<size_t>(height);
+}
+
+PageBands::PageBands(const uint8_t* payload, const size_t payloadSize, const uint8_t compression,
+                     const uint16_t width, const uint16_t height, const uint8_t bitDepth)
+    : m_payload(payload),
+      m_payloadEnd(payload + payloadSize),
+      m_compression(compression),
+      m_width(width),
+      m_height(height),
+      m_bitDepth(bitDepth),
+      m_bitmapSize(getBitmapSize(width, height, bitDepth)) {
+  if (compression == COMPRESSION_NONE) {
+    m_failed = payloadSize < m_bitmapSize;
+  } else if (compression == COMPRESSION_PACKBITS) {
+    m_in1 = payload;
+    m_in2 = payload;
+    if (bitDepth == 2) {
+      m_band.resize(2 * 8 * static_cast<size_t>((height + 7) / 8));
+      // Plane 2 starts where plane 1 ends in the decompressed bitmap
+      m_decoded2 = m_decoder2.skip(m_in2, m_payloadEnd, m_bitmapSize / 2);
+      m_failed = m_decoded2 != m_bitmapSize / 2;
+    } else {
+      m_band.resize(8 * static_cast<size_t>((width + 7) / 8));
+    }
+  } else {
+    m_failed = true;
+  }
+}
+
+// Zero-fills what the stream can't provide, which is only an error when it falls inside the bitmap. XTH columns of a
+// page whose height isn't a multiple of 8 reach past it, like they do in an uncompressed payload.
+bool PageBands::read(PackBitsDecoder& decoder, const uint8_t*& in, size_t& decoded, uint8_t* out,
+                     const size_t count) {
+  uint8_t* cursor = out;
+  decoder.decode(in, m_payloadEnd, cursor, out + count);
+  const size_t produced = cursor - out;
+  memset(cursor, 0, count - produced);
+  decoded += count;
+  return produced == count || decoded - count + produced >= m_bitmapSize;
+}
+
+bool PageBands::next(PageBand& band) {
+  if (m_failed) {
+    return false;
+  }
+
+  if (m_compression == COMPRESSION_NONE) {
+    if (m_position > 0) {
+      return false;
+    }
+    m_position = 1;
+    band = {0, 0, m_width, m_height, m_payload, m_bitDepth == 2 ? m_payload + m_bitmapSize / 2 : nullptr};
+    return true;
+  }
+
+  if (m_bitDepth == 2) {
+    if (m_position >= m_width) {
+      return false;
+    }
+    // Stored columns run right to left, so the band's first column is its rightmost
+    const uint16_t columns = std::min<uint16_t>(8, m_width - m_position);
+    const size_t columnBytes = (m_height + 7) / 8;
+    const size_t size = columns * columnBytes;
+    uint8_t* plane1 = m_band.data();
+    uint8_t* plane2 = m_band.data() + 8 * columnBytes;
+    if (!read(m_decoder1, m_in1, m_decoded1, plane1, size) || !read(m_decoder2, m_in2, m_decoded2, plane2, size)) {
+      m_failed = true;
+      return false;
+    }
+    band = {static_cast<uint16_t>(m_width - m_position - columns), 0, columns, m_height, plane1, plane2};
+    m_position += columns;
+    return true;
+  }
+
+  if (m_position >= m_height) {
+    return false;
+  }
+  const uint16_t rows = std::min<uint16_t>(8, m_height - m_position);
+  if (!read(m_decoder1, m_in1, m_decoded1, m_band.data(), rows * static_cast<size_t>((m_width + 7) / 8))) {
+    m_failed = true;
+    return false;
+  }
+  band = {0, m_position, m_width, rows, m_band.data(), nullptr};
+  m_position += rows;
+  return true;
+}
+
+}  // namespace xtc
@@ -0,0 +1,90 @@
+/**
+ * XtcPageBands.h
+ *
+ * Streaming access to XTC/XTCH page bitmaps, compressed or not
+ * XTC ebook support for CrossPoint Reader
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace xtc {
+
+/**
+ * Incremental PackBits decoder
+ *
+ * Input and output may come in pieces of any size; a run cut off by the end of either carries on with the next call.
+ * Header n in 0..127 copies n + 1 literal bytes, -127..-1 repeats the next byte 1 - n times and -128 is skipped.
+ */
+class PackBitsDecoder {
+ public:
+  // Decodes from [in, inEnd) into [out, outEnd), advancing both, until either runs out
+  void decode(const uint8_t*& in, const uint8_t* inEnd, uint8_t*& out, uint8_t* outEnd);
+  // Decodes and drops up to count bytes, returns how many there were
+  size_t skip(const uint8_t*& in, const uint8_t* inEnd, size_t count);
+
+ private:
+  size_t m_remaining = 0;  // Bytes left in the current run
+  bool m_repeating = false;
+  bool m_needValue = false;  // A repeat header was read but not the byte it repeats
+  uint8_t m_value = 0;
+};
+
+// Appends the PackBits encoding of data to out
+void packBitsEncode(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+// One band of a page bitmap, in the layout of the whole page but only as big as the band
+struct PageBand {
+  uint16_t x;  // Logical box of the band within the page
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+  const uint8_t* data;    // XTG rows, or XTH plane 1 columns (right to left)
+  const uint8_t* plane2;  // XTH plane 2 columns, nullptr for XTG
+};
+
+/**
+ * Walks a page bitmap as XtcParser::loadPagePayload() returns it. A compressed page is decoded a band at a time (8
+ * rows of an XTG page, 8 columns of both XTH planes), so drawing it never needs the decompressed page. An
+ * uncompressed page is a single band pointing straight into the payload.
+ */
+class PageBands {
+ public:
+  PageBands(const uint8_t* payload, size_t payloadSize, uint8_t compression, uint16_t width, uint16_t height,
+            uint8_t bitDepth);
+
+  // The next band, false once the page is done or the payload turned out to be broken
+  bool next(PageBand& band);
+  // Whether the payload was short or used an unknown compression
+  bool failed() const { return m_failed; }
+
+  // Bytes of the bitmap once decompressed
+  static size_t getBitmapSize(uint16_t width, uint16_t height, uint8_t bitDepth);
+
+ private:
+  const uint8_t* m_payload;
+  const uint8_t* m_payloadEnd;
+  uint8_t m_compression;
+  uint16_t m_width;
+  uint16_t m_height;
+  uint8_t m_bitDepth;
+  size_t m_bitmapSize;
+  uint16_t m_position = 0;  // Rows (XTG) or stored columns (XTH) handed out so far
+  bool m_failed = false;
+
+  // Compressed pages only. XTH plane 2 is read by its own decoder, which starts by skipping plane 1.
+  std::vector<uint8_t> m_band;
+  PackBitsDecoder m_decoder1;
+  PackBitsDecoder m_decoder2;
+  const uint8_t* m_in1 = nullptr;
+  const uint8_t* m_in2 = nullptr;
+  size_t m_decoded1 = 0;  // Bytes each decoder has produced, from the start of the bitmap
+  size_t m_decoded2 = 0;
+
+  bool read(PackBitsDecoder& decoder, const uint8_t*& in, size_t& decoded, uint8_t* out, size_t count);
+};
+
+}  // namespace xtc
@@ -11,8 +11,11 @@
 #include <HardwareSerial.h>
 #include <SDCardManager.h>
 
+#include <algorithm>
 #include <cstring>
 
+#include "XtcPageBands.h"
+
 namespace xtc {
 
 XtcParser::XtcParser()
@@ -90,7 +93,7 @@ void XtcParser::close() {
     m_file.close();
     m_isOpen = false;
   }
-  m_pageTable.clear();
+  clearPageTableCache();
   m_chapters.clear();
   m_title.clear();
   m_hasChapters = false;
@@ -165,44 +168,86 @@ XtcError XtcParser::readAuthor() {
   return XtcError::OK;
 }
 
+// Checks that the whole page table is in the file and takes the default page size from the first entry. The
+// entries themselves are read when a page is first asked for.
 XtcError XtcParser::readPageTable() {
   if (m_header.pageTableOffset == 0) {
     Serial.printf("[%lu] [XTC] Page table offset is 0, cannot read\n", millis());
     return XtcError::CORRUPTED_HEADER;
   }
 
-  // Seek to page table
-  if (!m_file.seek(m_header.pageTableOffset)) {
-    Serial.printf("[%lu] [XTC] Failed to seek to page table at %llu\n", millis(), m_header.pageTableOffset);
-    return XtcError::READ_ERROR;
+  const uint64_t tableEnd = m_header.pageTableOffset + sizeof(PageTableEntry) * m_header.pageCount;
+  if (tableEnd > m_file.size()) {
+    Serial.printf("[%lu] [XTC] Page table at %llu runs past the end of the file\n", millis(), m_header.pageTableOffset);
+    return XtcError::CORRUPTED_HEADER;
   }
 
-  m_pageTable.resize(m_header.pageCount);
+  clearPageTableCache();
+  const PageInfo* first = findPageInfo(0);
+  if (!first) {
+    return XtcError::READ_ERROR;
+  }
+  m_defaultWidth = first->width;
+  m_defaultHeight = first->height;
 
-  // Read page table entries
-  for (uint16_t i = 0; i < m_header.pageCount; i++) {
-    PageTableEntry entry;
-    size_t bytesRead = m_file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(PageTableEntry));
-    if (bytesRead != sizeof(PageTableEntry)) {
-      Serial.printf("[%lu] [XTC] Failed to read page table entry %u\n", millis(), i);
-      return XtcError::READ_ERROR;
-    }
+  Serial.printf("[%lu] [XTC] Page table: %u entries at %llu\n", millis(), m_header.pageCount,
+                m_header.pageTableOffset);
+  return XtcError::OK;
+}
 
-    m_pageTable[i].offset = static_cast<uint32_t>(entry.dataOffset);
-    m_pageTable[i].size = entry.dataSize;
-    m_pageTable[i].width = entry.width;
-    m_pageTable[i].height = entry.height;
-    m_pageTable[i].bitDepth = m_bitDepth;
+const PageInfo* XtcParser::findPageInfo(const uint32_t pageIndex) {
+  if (pageIndex >= m_header.pageCount) {
+    return nullptr;
+  }
 
-    // Update default dimensions from first page
-    if (i == 0) {
-      m_defaultWidth = entry.width;
-      m_defaultHeight = entry.height;
+  const uint32_t blockIndex = pageIndex / PAGE_TABLE_BLOCK_ENTRIES;
+  const uint32_t entryIndex = pageIndex % PAGE_TABLE_BLOCK_ENTRIES;
+  PageTableBlock* block = nullptr;
+  for (auto& candidate : m_pageTableCache) {
+    if (candidate.index == blockIndex) {
+      candidate.lastUse = ++m_pageTableUses;
+      return &candidate.entries[entryIndex];
+    }
+    // Empty blocks have lastUse 0, so they are taken before any block in use
+    if (!block || candidate.lastUse < block->lastUse) {
+      block = &candidate;
     }
   }
 
-  Serial.printf("[%lu] [XTC] Read %u page table entries\n", millis(), m_header.pageCount);
-  return XtcError::OK;
+  // The raw entries are read in place, PageInfo has the same size, and converted front to back
+  static_assert(sizeof(PageInfo) == sizeof(PageTableEntry), "Page table entries are converted in place");
+  const uint32_t firstPage = blockIndex * PAGE_TABLE_BLOCK_ENTRIES;
+  const uint32_t count = std::min<uint32_t>(PAGE_TABLE_BLOCK_ENTRIES, m_header.pageCount - firstPage);
+  const size_t size = sizeof(PageTableEntry) * count;
+  block->index = UINT32_MAX;
+  if (!m_file.seek(m_header.pageTableOffset + sizeof(PageTableEntry) * firstPage) ||
+      m_file.read(reinterpret_cast<uint8_t*>(block->entries), size) != size) {
+    Serial.printf("[%lu] [XTC] Failed to read page table entries %u-%u\n", millis(), firstPage,
+                  firstPage + count - 1);
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    PageTableEntry entry;
+    memcpy(&entry, &block->entries[i], sizeof(entry));
+    PageInfo& info = block->entries[i];
+    info.offset = static_cast<uint32_t>(entry.dataOffset);
+    info.size = entry.dataSize;
+    info.width = entry.width;
+    info.height = entry.height;
+    info.bitDepth = m_bitDepth;
+    info.padding = 0;
+  }
+  block->index = blockIndex;
+  block->lastUse = ++m_pageTableUses;
+  return &block->entries[entryIndex];
+}
+
+void XtcParser::clearPageTableCache() {
+  for (auto& block : m_pageTableCache) {
+    block.index = UINT32_MAX;
+    block.lastUse = 0;
+  }
+  m_pageTableUses = 0;
 }
 
 XtcError XtcParser::readChapters() {
@@ -311,41 +356,46 @@ XtcError XtcParser::readChapters() {
   return XtcError::OK;
 }
 
-bool XtcParser::getPageInfo(uint32_t pageIndex, PageInfo& info) const {
-  if (pageIndex >= m_pageTable.size()) {
+bool XtcParser::getPageInfo(uint32_t pageIndex, PageInfo& info) {
+  const PageInfo* page = findPageInfo(pageIndex);
+  if (!page) {
     return false;
   }
-  info = m_pageTable[pageIndex];
+  info = *page;
   return true;
 }
 
-size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize) {
+// Seeks to a page and reads and checks its header, leaving the file at the start of the stored bitmap
+bool XtcParser::readPageHeader(uint32_t pageIndex, XtgPageHeader& pageHeader) {
   if (!m_isOpen) {
     m_lastError = XtcError::FILE_NOT_FOUND;
-    return 0;
+    return false;
   }
 
   if (pageIndex >= m_header.pageCount) {
     m_lastError = XtcError::PAGE_OUT_OF_RANGE;
-    return 0;
+    return false;
   }
 
-  const PageInfo& page = m_pageTable[pageIndex];
+  const PageInfo* page = findPageInfo(pageIndex);
+  if (!page) {
+    m_lastError = XtcError::READ_ERROR;
+    return false;
+  }
 
   // Seek to page data
-  if (!m_file.seek(page.offset)) {
-    Serial.printf("[%lu] [XTC] Failed to seek to page %u at offset %lu\n", millis(), pageIndex, page.offset);
+  if (!m_file.seek(page->offset)) {
+    Serial.printf("[%lu] [XTC] Failed to seek to page %u at offset %lu\n", millis(), pageIndex, page->offset);
     m_lastError = XtcError::READ_ERROR;
-    return 0;
+    return false;
   }
 
   // Read page header (XTG for 1-bit, XTH for 2-bit - same structure)
-  XtgPageHeader pageHeader;
   size_t headerRead = m_file.read(reinterpret_cast<uint8_t*>(&pageHeader), sizeof(XtgPageHeader));
   if (headerRead != sizeof(XtgPageHeader)) {
     Serial.printf("[%lu] [XTC] Failed to read page header for page %u\n", millis(), pageIndex);
     m_lastError = XtcError::READ_ERROR;
-    return 0;
+    return false;
   }
 
   // Verify page magic (XTG for 1-bit, XTH for 2-bit)
@@ -354,19 +404,26 @@ size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSiz
     Serial.printf("[%lu] [XTC] Invalid page magic for page %u: 0x%08X (expected 0x%08X)\n", millis(), pageIndex,
                   pageHeader.magic, expectedMagic);
     m_lastError = XtcError::INVALID_MAGIC;
+    return false;
+  }
+
+  if (pageHeader.compression != COMPRESSION_NONE && pageHeader.compression != COMPRESSION_PACKBITS) {
+    Serial.printf("[%lu] [XTC] Unknown compression %u on page %u\n", millis(), pageHeader.compression, pageIndex);
+    m_lastError = XtcError::DECOMPRESSION_ERROR;
+    return false;
+  }
+  return true;
+}
+
+size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize) {
+  XtgPageHeader pageHeader;
+  if (!readPageHeader(pageIndex, pageHeader)) {
     return 0;
   }
 
-  // Calculate bitmap size based on bit depth
   // XTG (1-bit): Row-major, ((width+7)/8) * height bytes
   // XTH (2-bit): Two bit planes, column-major, ((width * height + 7) / 8) * 2 bytes
-  size_t bitmapSize;
-  if (m_bitDepth == 2) {
-    // XTH: two bit planes, each containing (width * height) bits rounded up to bytes
-    bitmapSize = ((static_cast<size_t>(pageHeader.width) * pageHeader.height + 7) / 8) * 2;
-  } else {
-    bitmapSize = ((pageHeader.width + 7) / 8) * pageHeader.height;
-  }
+  const size_t bitmapSize = PageBands::getBitmapSize(pageHeader.width, pageHeader.height, m_bitDepth);
 
   // Check buffer size
   if (bufferSize < bitmapSize) {
@@ -375,6 +432,31 @@ size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSiz
     return 0;
   }
 
+  if (pageHeader.compression == COMPRESSION_PACKBITS) {
+    // Decompress straight into the caller's buffer, a chunk of the stored page at a time
+    PackBitsDecoder decoder;
+    uint8_t chunk[512];
+    uint8_t* out = buffer;
+    size_t remaining = pageHeader.dataSize;
+    while (out < buffer + bitmapSize && remaining > 0) {
+      const int chunkRead = m_file.read(chunk, std::min(sizeof(chunk), remaining));
+      if (chunkRead <= 0) {
+        break;
+      }
+      remaining -= chunkRead;
+      const uint8_t* in = chunk;
+      decoder.decode(in, chunk + chunkRead, out, buffer + bitmapSize);
+    }
+    if (out != buffer + bitmapSize) {
+      Serial.printf("[%lu] [XTC] Page %u decompressed to %u of %u bytes\n", millis(), pageIndex,
+                    static_cast<unsigned>(out - buffer), bitmapSize);
+      m_lastError = XtcError::DECOMPRESSION_ERROR;
+      return 0;
+    }
+    m_lastError = XtcError::OK;
+    return bitmapSize;
+  }
+
   // Read bitmap data
   size_t bytesRead = m_file.read(buffer, bitmapSize);
   if (bytesRead != bitmapSize) {
@@ -387,52 +469,81 @@ size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSiz
   return bytesRead;
 }
 
-XtcError XtcParser::loadPageStreaming(uint32_t pageIndex,
-                                      std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
-                                      size_t chunkSize) {
-  if (!m_isOpen) {
-    return XtcError::FILE_NOT_FOUND;
+size_t XtcParser::loadPagePayload(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize, uint8_t& compression) {
+  XtgPageHeader pageHeader;
+  if (!readPageHeader(pageIndex, pageHeader)) {
+    return 0;
   }
 
-  if (pageIndex >= m_header.pageCount) {
-    return XtcError::PAGE_OUT_OF_RANGE;
+  const size_t payloadSize = pageHeader.compression == COMPRESSION_PACKBITS
+                                 ? pageHeader.dataSize
+                                 : PageBands::getBitmapSize(pageHeader.width, pageHeader.height, m_bitDepth);
+  if (bufferSize < payloadSize) {
+    Serial.printf("[%lu] [XTC] Buffer too small: need %u, have %u\n", millis(), payloadSize, bufferSize);
+    m_lastError = XtcError::MEMORY_ERROR;
+    return 0;
   }
 
-  const PageInfo& page = m_pageTable[pageIndex];
-
-  // Seek to page data
-  if (!m_file.seek(page.offset)) {
-    return XtcError::READ_ERROR;
+  size_t bytesRead = m_file.read(buffer, payloadSize);
+  if (bytesRead != payloadSize) {
+    Serial.printf("[%lu] [XTC] Page read error: expected %u, got %u\n", millis(), payloadSize, bytesRead);
+    m_lastError = XtcError::READ_ERROR;
+    return 0;
   }
 
-  // Read and skip page header (XTG for 1-bit, XTH for 2-bit)
+  compression = pageHeader.compression;
+  m_lastError = XtcError::OK;
+  return bytesRead;
+}
+
+XtcError XtcParser::loadPageStreaming(uint32_t pageIndex,
+                                      std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
+                                      size_t chunkSize) {
   XtgPageHeader pageHeader;
-  size_t headerRead = m_file.read(reinterpret_cast<uint8_t*>(&pageHeader), sizeof(XtgPageHeader));
-  const uint32_t expectedMagic = (m_bitDepth == 2) ? XTH_MAGIC : XTG_MAGIC;
-  if (headerRead != sizeof(XtgPageHeader) || pageHeader.magic != expectedMagic) {
-    return XtcError::READ_ERROR;
+  if (!readPageHeader(pageIndex, pageHeader)) {
+    return m_lastError;
   }
 
-  // Calculate bitmap size based on bit depth
   // XTG (1-bit): Row-major, ((width+7)/8) * height bytes
   // XTH (2-bit): Two bit planes, ((width * height + 7) / 8) * 2 bytes
-  size_t bitmapSize;
-  if (m_bitDepth == 2) {
-    bitmapSize = ((static_cast<size_t>(pageHeader.width) * pageHeader.height + 7) / 8) * 2;
-  } else {
-    bitmapSize = ((pageHeader.width + 7) / 8) * pageHeader.height;
-  }
+  const size_t bitmapSize = PageBands::getBitmapSize(pageHeader.width, pageHeader.height, m_bitDepth);
+  const bool compressed = pageHeader.compression == COMPRESSION_PACKBITS;
 
-  // Read in chunks
+  // Read in chunks, compressed pages are handed out decompressed
   std::vector<uint8_t> chunk(chunkSize);
+  std::vector<uint8_t> stored(compressed ? 512 : 0);
+  const uint8_t* in = stored.data();
+  const uint8_t* inEnd = stored.data();
+  PackBitsDecoder decoder;
+  size_t remaining = pageHeader.dataSize;
   size_t totalRead = 0;
 
   while (totalRead < bitmapSize) {
     size_t toRead = std::min(chunkSize, bitmapSize - totalRead);
-    size_t bytesRead = m_file.read(chunk.data(), toRead);
+    size_t bytesRead = 0;
+    if (compressed) {
+      // Stored data and runs the last chunk had no room for carry over into this one, so decode before reading more
+      uint8_t* out = chunk.data();
+      while (true) {
+        decoder.decode(in, inEnd, out, chunk.data() + toRead);
+        if (out == chunk.data() + toRead) {
+          break;
+        }
+        const int storedRead = remaining > 0 ? m_file.read(stored.data(), std::min(stored.size(), remaining)) : 0;
+        if (storedRead <= 0) {
+          break;
+        }
+        remaining -= storedRead;
+        in = stored.data();
+        inEnd = in + storedRead;
+      }
+      bytesRead = out - chunk.data();
+    } else {
+      bytesRead = m_file.read(chunk.data(), toRead);
+    }
 
     if (bytesRead == 0) {
-      return XtcError::READ_ERROR;
+      return compressed ? XtcError::DECOMPRESSION_ERROR : XtcError::READ_ERROR;
     }
 
     callback(chunk.data(), bytesRead, totalRead);
@@ -41,8 +41,8 @@ class XtcParser {
   uint16_t getHeight() const { return m_defaultHeight; }
   uint8_t getBitDepth() const { return m_bitDepth; }  // 1 = XTC/XTG, 2 = XTCH/XTH
 
-  // Page information
-  bool getPageInfo(uint32_t pageIndex, PageInfo& info) const;
+  // Page information, read from the page table on demand
+  bool getPageInfo(uint32_t pageIndex, PageInfo& info);
 
   /**
    * Load page bitmap (raw 1-bit data, skipping XTG header)
@@ -54,6 +54,17 @@ class XtcParser {
    */
   size_t loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize);
 
+  /**
+   * Load page bitmap as stored, still compressed when the page is; PageBands walks it either way
+   *
+   * @param pageIndex Page index (0-based)
+   * @param buffer Output buffer (caller allocated, a page's decompressed size always suffices)
+   * @param bufferSize Buffer size
+   * @param compression Set to the page's compression (COMPRESSION_NONE or COMPRESSION_PACKBITS)
+   * @return Number of bytes read on success, 0 on failure
+   */
+  size_t loadPagePayload(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize, uint8_t& compression);
+
   /**
    * Streaming page load
    * Memory-efficient method that reads page data in chunks.
@@ -84,7 +95,19 @@ class XtcParser {
   FsFile m_file;
   bool m_isOpen;
   XtcHeader m_header;
-  std::vector<PageInfo> m_pageTable;
+
+  // The page table stays on the SD card. Blocks of it are read on demand and the most recently used few are kept, so
+  // opening a book and its memory use don't grow with its page count.
+  static constexpr uint32_t PAGE_TABLE_BLOCK_ENTRIES = 64;  // 1 KB of table per read
+  static constexpr size_t PAGE_TABLE_CACHE_BLOCKS = 4;
+  struct PageTableBlock {
+    uint32_t index = UINT32_MAX;  // Block number, UINT32_MAX while empty
+    uint32_t lastUse = 0;
+    PageInfo entries[PAGE_TABLE_BLOCK_ENTRIES];
+  };
+  PageTableBlock m_pageTableCache[PAGE_TABLE_CACHE_BLOCKS];
+  uint32_t m_pageTableUses = 0;
+
   std::vector<ChapterInfo> m_chapters;
   std::string m_title;
   std::string m_author;
@@ -97,6 +120,9 @@ class XtcParser {
   // Internal helper functions
   XtcError readHeader();
   XtcError readPageTable();
+  bool readPageHeader(uint32_t pageIndex, XtgPageHeader& pageHeader);
+  const PageInfo* findPageInfo(uint32_t pageIndex);
+  void clearPageTableCache();
   XtcError readTitle();
   XtcError readAuthor();
   XtcError readChapters();
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 namespace xtc {
@@ -27,6 +28,12 @@ constexpr uint32_t XTG_MAGIC = 0x00475458;  // "XTG\0" for 1-bit page data
 // "XTH\0" = 0x58, 0x54, 0x48, 0x00
 constexpr uint32_t XTH_MAGIC = 0x00485458;  // "XTH\0" for 2-bit page data
 
+// XtgPageHeader::compression
+constexpr uint8_t COMPRESSION_NONE = 0;
+// PackBits over the bitmap exactly as it is laid out uncompressed, dataSize being the compressed size. Writers keep a
+// page uncompressed when PackBits doesn't make it smaller, so a payload never outgrows the raw bitmap.
+constexpr uint8_t COMPRESSION_PACKBITS = 1;
+
 // XTeink X4 display resolution
 constexpr uint16_t DISPLAY_WIDTH = 480;
 constexpr uint16_t DISPLAY_HEIGHT = 800;
@@ -70,8 +77,8 @@ struct XtgPageHeader {
   uint16_t width;       // 0x04: Image width (pixels)
   uint16_t height;      // 0x06: Image height (pixels)
   uint8_t colorMode;    // 0x08: Color mode (0=monochrome)
-  uint8_t compression;  // 0x09: Compression (0=uncompressed)
-  uint32_t dataSize;    // 0x0A: Image data size (bytes)
+  uint8_t compression;  // 0x09: Compression (COMPRESSION_NONE or COMPRESSION_PACKBITS)
+  uint32_t dataSize;    // 0x0A: Image data size (bytes, as stored)
   uint64_t md5;         // 0x0E: MD5 checksum (first 8 bytes, optional)
   // Followed by bitmap data at offset 0x16 (22)
   //
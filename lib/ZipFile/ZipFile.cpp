@@ -2,45 +2,63 @@
 
 #include <HardwareSerial.h>
 #include <SDCardManager.h>
-#if defined(PLATFORM_M5PAPER)
-#include <lgfx/utility/lgfx_miniz.h>
-using tinfl_decompressor = lgfx_tinfl_decompressor;
-using tinfl_status = lgfx_tinfl_status;
-#define tinfl_init lgfx_tinfl_init
-#define tinfl_decompress lgfx_tinfl_decompress
-#ifndef MZ_NO_COMPRESSION
-#define MZ_NO_COMPRESSION 0
-#endif
-#else
-#include <miniz.h>
-#endif
 
 #include <algorithm>
 
-bool inflateOneShot(const uint8_t* inputBuf, const size_t deflatedSize, uint8_t* outputBuf, const size_t inflatedSize) {
-  // Setup inflator
-  const auto inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
-  if (!inflator) {
-    Serial.printf("[%lu] [ZIP] Failed to allocate memory for inflator\n", millis());
-    return false;
-  }
-  memset(inflator, 0, sizeof(tinfl_decompressor));
-  tinfl_init(inflator);
-
-  size_t inBytes = deflatedSize;
-  size_t outBytes = inflatedSize;
-  const tinfl_status status = tinfl_decompress(inflator, inputBuf, &inBytes, nullptr, outputBuf, &outBytes,
-                                               TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
-  free(inflator);
+namespace {
+// zip.idx: uint8 version, the IndexKey of the zip it indexes (uint32 size, uint16 FAT modify date, uint16 FAT modify
+// time, uint32 central directory offset), uint32 entry count, then IndexEntry[count]
+constexpr uint8_t ZIP_INDEX_VERSION = 2;
+constexpr uint32_t INDEX_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t) + 2 * sizeof(uint16_t) + sizeof(uint32_t) +
+                                       sizeof(uint32_t);
+// Entries are sorted in runs of this many in RAM, then the runs are merged on the SD card
+constexpr size_t INDEX_RUN_SIZE = 1024;
+constexpr size_t INDEX_MERGE_BATCH = 16;
+static_assert(sizeof(ZipFile::IndexEntry) == 24, "Index entries are written to disk as is");
+
+template <typename T>
+bool readField(FsFile& file, T* value) {
+  return file.read(value, sizeof(T)) == static_cast<int>(sizeof(T));
+}
 
-  if (status != TINFL_STATUS_DONE) {
-    Serial.printf("[%lu] [ZIP] tinfl_decompress() failed with status %d\n", millis(), status);
-    return false;
-  }
+bool readIndexHeader(FsFile& indexFile, uint8_t* version, ZipFile::IndexKey* key, uint32_t* entryCount) {
+  return readField(indexFile, version) && readField(indexFile, &key->zipSize) &&
+         readField(indexFile, &key->modifyDate) && readField(indexFile, &key->modifyTime) &&
+         readField(indexFile, &key->centralDirOffset) && readField(indexFile, entryCount);
+}
 
-  return true;
+bool indexEntryLess(const ZipFile::IndexEntry& a, const ZipFile::IndexEntry& b) {
+  return a.hash < b.hash || (a.hash == b.hash && a.len < b.len);
 }
 
+// Buffered cursor over one sorted run of the temporary runs file
+struct IndexRun {
+  uint32_t next;
+  uint32_t end;
+  ZipFile::IndexEntry buffer[INDEX_MERGE_BATCH];
+  size_t bufferPos;
+  size_t bufferFilled;
+
+  const ZipFile::IndexEntry* peek(FsFile& runsFile) {
+    if (bufferPos == bufferFilled) {
+      if (next == end) {
+        return nullptr;
+      }
+      const size_t count = std::min<size_t>(INDEX_MERGE_BATCH, end - next);
+      const size_t bytes = count * sizeof(ZipFile::IndexEntry);
+      if (!runsFile.seek(INDEX_HEADER_SIZE + next * sizeof(ZipFile::IndexEntry)) ||
+          runsFile.read(buffer, bytes) != static_cast<int>(bytes)) {
+        return nullptr;
+      }
+      next += count;
+      bufferPos = 0;
+      bufferFilled = count;
+    }
+    return &buffer[bufferPos];
+  }
+};
+}  // namespace
+
 bool ZipFile::loadAllFileStatSlims() {
   const bool wasOpen = isOpen();
   if (!wasOpen && !open()) {
@@ -97,6 +115,246 @@ bool ZipFile::loadAllFileStatSlims() {
   return true;
 }
 
+bool ZipFile::getIndexKey(IndexKey* key) {
+  if (!loadZipDetails()) {
+    return false;
+  }
+  key->zipSize = static_cast<uint32_t>(file.size());
+  key->centralDirOffset = zipDetails.centralDirOffset;
+  // Not every card stamps files, zero times still leave the size and central directory offset to tell zips apart
+  if (!file.getModifyDateTime(&key->modifyDate, &key->modifyTime)) {
+    key->modifyDate = 0;
+    key->modifyTime = 0;
+  }
+  return true;
+}
+
+bool ZipFile::ensureIndex(const std::string& indexPath) {
+  const bool wasOpen = isOpen();
+  if (!wasOpen && !open()) {
+    return false;
+  }
+  IndexKey zipKey;
+  if (!getIndexKey(&zipKey)) {
+    if (!wasOpen) {
+      close();
+    }
+    return false;
+  }
+
+  FsFile existing;
+  if (SdMan.exists(indexPath.c_str()) && SdMan.openFileForRead("ZIP", indexPath, existing)) {
+    uint8_t version = 0;
+    IndexKey indexedKey = {};
+    uint32_t entryCount = 0;
+    const bool valid = readIndexHeader(existing, &version, &indexedKey, &entryCount) &&
+                       version == ZIP_INDEX_VERSION && indexedKey == zipKey &&
+                       existing.size() == INDEX_HEADER_SIZE + static_cast<uint64_t>(entryCount) * sizeof(IndexEntry);
+    existing.close();
+    if (valid) {
+      if (!wasOpen) {
+        close();
+      }
+      return true;
+    }
+  }
+
+  const uint32_t start = millis();
+  const bool built = buildIndex(indexPath, zipKey);
+  if (!wasOpen) {
+    close();
+  }
+  if (!built) {
+    SdMan.remove(indexPath.c_str());
+    return false;
+  }
+  Serial.printf("[%lu] [ZIP] Built central directory index in %lu ms\n", millis(), millis() - start);
+  return true;
+}
+
+// Sorts the central directory in runs of INDEX_RUN_SIZE entries written to a temporary file, then merges the runs into
+// the index, so RAM use stays bounded no matter how many entries the zip has.
+bool ZipFile::buildIndex(const std::string& indexPath, const IndexKey& key) {
+  const std::string runsPath = indexPath + ".tmp";
+  FsFile runsFile;
+  if (!SdMan.openFileForWrite("ZIP", runsPath, runsFile)) {
+    return false;
+  }
+  // Runs share the index layout so entry offsets line up in both files
+  uint8_t header[INDEX_HEADER_SIZE] = {};
+  runsFile.write(header, INDEX_HEADER_SIZE);
+
+  std::vector<IndexEntry> run;
+  run.reserve(std::min<size_t>(zipDetails.totalEntries, INDEX_RUN_SIZE));
+  std::vector<uint32_t> runStarts;
+  uint32_t entryCount = 0;
+  bool writeFailed = false;
+  const auto flushRun = [&]() {
+    if (run.empty()) {
+      return;
+    }
+    std::sort(run.begin(), run.end(), indexEntryLess);
+    const size_t bytes = run.size() * sizeof(IndexEntry);
+    writeFailed |= runsFile.write(reinterpret_cast<const uint8_t*>(run.data()), bytes) != bytes;
+    runStarts.push_back(entryCount);
+    entryCount += run.size();
+    run.clear();
+  };
+
+  file.seek(zipDetails.centralDirOffset);
+  uint32_t sig;
+  char itemName[256];
+  while (file.available()) {
+    file.read(&sig, 4);
+    if (sig != 0x02014b50) break;  // End of list
+
+    IndexEntry entry = {};
+    file.seekCur(6);
+    file.read(&entry.method, 2);
+    file.seekCur(8);
+    file.read(&entry.compressedSize, 4);
+    file.read(&entry.uncompressedSize, 4);
+    uint16_t nameLen, m, k;
+    file.read(&nameLen, 2);
+    file.read(&m, 2);
+    file.read(&k, 2);
+    file.seekCur(8);
+    file.read(&entry.localHeaderOffset, 4);
+
+    // Names that long can't be looked up anyway
+    if (nameLen < 256) {
+      file.read(itemName, nameLen);
+      entry.hash = fnvHash64(itemName, nameLen);
+      entry.len = nameLen;
+      run.push_back(entry);
+      if (run.size() == INDEX_RUN_SIZE) {
+        flushRun();
+      }
+    } else {
+      file.seekCur(nameLen);
+    }
+
+    file.seekCur(m + k);
+  }
+  flushRun();
+  run.shrink_to_fit();
+  runsFile.close();
+
+  FsFile output;
+  if (writeFailed || !SdMan.openFileForRead("ZIP", runsPath, runsFile)) {
+    SdMan.remove(runsPath.c_str());
+    return false;
+  }
+  if (!SdMan.openFileForWrite("ZIP", indexPath, output)) {
+    runsFile.close();
+    SdMan.remove(runsPath.c_str());
+    return false;
+  }
+  output.write(&ZIP_INDEX_VERSION, sizeof(ZIP_INDEX_VERSION));
+  output.write(&key.zipSize, sizeof(key.zipSize));
+  output.write(&key.modifyDate, sizeof(key.modifyDate));
+  output.write(&key.modifyTime, sizeof(key.modifyTime));
+  output.write(&key.centralDirOffset, sizeof(key.centralDirOffset));
+  output.write(&entryCount, sizeof(entryCount));
+
+  std::vector<IndexRun> runs(runStarts.size());
+  for (size_t i = 0; i < runs.size(); i++) {
+    runs[i].next = runStarts[i];
+    runs[i].end = i + 1 < runStarts.size() ? runStarts[i + 1] : entryCount;
+    runs[i].bufferPos = 0;
+    runs[i].bufferFilled = 0;
+  }
+
+  // Runs are few (one per INDEX_RUN_SIZE entries), a linear pick of the smallest head is plenty
+  uint32_t written = 0;
+  while (true) {
+    IndexRun* smallest = nullptr;
+    for (auto& candidate : runs) {
+      const IndexEntry* head = candidate.peek(runsFile);
+      if (head && (!smallest || indexEntryLess(*head, smallest->buffer[smallest->bufferPos]))) {
+        smallest = &candidate;
+      }
+    }
+    if (!smallest) {
+      break;
+    }
+    writeFailed |= output.write(reinterpret_cast<const uint8_t*>(&smallest->buffer[smallest->bufferPos]),
+                                sizeof(IndexEntry)) != sizeof(IndexEntry);
+    smallest->bufferPos++;
+    written++;
+  }
+
+  output.close();
+  runsFile.close();
+  SdMan.remove(runsPath.c_str());
+  return !writeFailed && written == entryCount;
+}
+
+bool ZipFile::openIndex() {
+  if (indexFile) {
+    return true;
+  }
+  if (indexUnavailable) {
+    return false;
+  }
+  uint8_t version = 0;
+  IndexKey indexedKey = {};
+  // ensureIndex() checked the key when the book was opened, only the format matters here
+  if (!SdMan.openFileForRead("ZIP", *indexPath, indexFile) ||
+      !readIndexHeader(indexFile, &version, &indexedKey, &indexEntryCount) || version != ZIP_INDEX_VERSION) {
+    indexFile.close();
+    indexUnavailable = true;
+    return false;
+  }
+  return true;
+}
+
+ZipFile::IndexLookup ZipFile::lookupIndex(const char* filename, FileStatSlim* fileStat) {
+  if (!openIndex()) {
+    return IndexLookup::Unavailable;
+  }
+
+  const size_t nameLen = strlen(filename);
+  IndexEntry key = {};
+  key.hash = fnvHash64(filename, nameLen);
+  key.len = static_cast<uint16_t>(nameLen);
+  const auto readEntry = [this](const uint32_t index, IndexEntry& entry) {
+    return indexFile.seek(INDEX_HEADER_SIZE + index * sizeof(IndexEntry)) &&
+           indexFile.read(&entry, sizeof(IndexEntry)) == static_cast<int>(sizeof(IndexEntry));
+  };
+
+  // Lower bound of (hash, len)
+  uint32_t low = 0;
+  uint32_t high = indexEntryCount;
+  IndexEntry entry;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    if (!readEntry(mid, entry)) {
+      return IndexLookup::Unavailable;
+    }
+    if (indexEntryLess(entry, key)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  if (low == indexEntryCount || !readEntry(low, entry) || entry.hash != key.hash || entry.len != key.len) {
+    return IndexLookup::NotFound;
+  }
+  IndexEntry following;
+  if (low + 1 < indexEntryCount && readEntry(low + 1, following) && following.hash == key.hash &&
+      following.len == key.len) {
+    // Two names share a hash, only the central directory scan can tell them apart
+    return IndexLookup::Unavailable;
+  }
+  fileStat->method = entry.method;
+  fileStat->compressedSize = entry.compressedSize;
+  fileStat->uncompressedSize = entry.uncompressedSize;
+  fileStat->localHeaderOffset = entry.localHeaderOffset;
+  return IndexLookup::Found;
+}
+
 bool ZipFile::loadFileStatSlim(const char* filename, FileStatSlim* fileStat) {
   if (!fileStatSlimCache.empty()) {
     const auto it = fileStatSlimCache.find(filename);
@@ -107,6 +365,13 @@ bool ZipFile::loadFileStatSlim(const char* filename, FileStatSlim* fileStat) {
     return false;
   }
 
+  if (indexPath) {
+    const IndexLookup lookup = lookupIndex(filename, fileStat);
+    if (lookup != IndexLookup::Unavailable) {
+      return lookup == IndexLookup::Found;
+    }
+  }
+
   const bool wasOpen = isOpen();
   if (!wasOpen && !open()) {
     return false;
@@ -300,6 +565,10 @@ bool ZipFile::close() {
   if (file) {
     file.close();
   }
+  if (indexFile) {
+    indexFile.close();
+  }
+  indexUnavailable = false;
   lastCentralDirPos = 0;
   lastCentralDirPosValid = false;
   return true;
@@ -388,286 +657,3 @@ int ZipFile::fillUncompressedSizes(std::vector<SizeTarget>& targets, std::vector
 
   return matched;
 }
-
-uint8_t* ZipFile::readFileToMemory(const char* filename, size_t* size, const bool trailingNullByte) {
-  const bool wasOpen = isOpen();
-  if (!wasOpen && !open()) {
-    return nullptr;
-  }
-
-  FileStatSlim fileStat = {};
-  if (!loadFileStatSlim(filename, &fileStat)) {
-    if (!wasOpen) {
-      close();
-    }
-    return nullptr;
-  }
-
-  const long fileOffset = getDataOffset(fileStat);
-  if (fileOffset < 0) {
-    if (!wasOpen) {
-      close();
-    }
-    return nullptr;
-  }
-
-  file.seek(fileOffset);
-
-  const auto deflatedDataSize = fileStat.compressedSize;
-  const auto inflatedDataSize = fileStat.uncompressedSize;
-  const auto dataSize = trailingNullByte ? inflatedDataSize + 1 : inflatedDataSize;
-  const auto data = static_cast<uint8_t*>(malloc(dataSize));
-  if (data == nullptr) {
-    Serial.printf("[%lu] [ZIP] Failed to allocate memory for output buffer (%zu bytes)\n", millis(), dataSize);
-    if (!wasOpen) {
-      close();
-    }
-    return nullptr;
-  }
-
-  if (fileStat.method == MZ_NO_COMPRESSION) {
-    // no deflation, just read content
-    const size_t dataRead = file.read(data, inflatedDataSize);
-    if (!wasOpen) {
-      close();
-    }
-
-    if (dataRead != inflatedDataSize) {
-      Serial.printf("[%lu] [ZIP] Failed to read data\n", millis());
-      free(data);
-      return nullptr;
-    }
-
-    // Continue out of block with data set
-  } else if (fileStat.method == MZ_DEFLATED) {
-    // Read out deflated content from file
-    const auto deflatedData = static_cast<uint8_t*>(malloc(deflatedDataSize));
-    if (deflatedData == nullptr) {
-      Serial.printf("[%lu] [ZIP] Failed to allocate memory for decompression buffer\n", millis());
-      if (!wasOpen) {
-        close();
-      }
-      return nullptr;
-    }
-
-    const size_t dataRead = file.read(deflatedData, deflatedDataSize);
-    if (!wasOpen) {
-      close();
-    }
-
-    if (dataRead != deflatedDataSize) {
-      Serial.printf("[%lu] [ZIP] Failed to read data, expected %d got %d\n", millis(), deflatedDataSize, dataRead);
-      free(deflatedData);
-      free(data);
-      return nullptr;
-    }
-
-    const bool success = inflateOneShot(deflatedData, deflatedDataSize, data, inflatedDataSize);
-    free(deflatedData);
-
-    if (!success) {
-      Serial.printf("[%lu] [ZIP] Failed to inflate file\n", millis());
-      free(data);
-      return nullptr;
-    }
-
-    // Continue out of block with data set
-  } else {
-    Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
-    if (!wasOpen) {
-      close();
-    }
-    return nullptr;
-  }
-
-  if (trailingNullByte) data[inflatedDataSize] = '\0';
-  if (size) *size = inflatedDataSize;
-  return data;
-}
-
-bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t chunkSize) {
-  const bool wasOpen = isOpen();
-  if (!wasOpen && !open()) {
-    return false;
-  }
-
-  FileStatSlim fileStat = {};
-  if (!loadFileStatSlim(filename, &fileStat)) {
-    return false;
-  }
-
-  const long fileOffset = getDataOffset(fileStat);
-  if (fileOffset < 0) {
-    return false;
-  }
-
-  file.seek(fileOffset);
-  const auto deflatedDataSize = fileStat.compressedSize;
-  const auto inflatedDataSize = fileStat.uncompressedSize;
-
-  if (fileStat.method == MZ_NO_COMPRESSION) {
-    // no deflation, just read content
-    const auto buffer = static_cast<uint8_t*>(malloc(chunkSize));
-    if (!buffer) {
-      Serial.printf("[%lu] [ZIP] Failed to allocate memory for buffer\n", millis());
-      if (!wasOpen) {
-        close();
-      }
-      return false;
-    }
-
-    size_t remaining = inflatedDataSize;
-    while (remaining > 0) {
-      const size_t dataRead = file.read(buffer, remaining < chunkSize ? remaining : chunkSize);
-      if (dataRead == 0) {
-        Serial.printf("[%lu] [ZIP] Could not read more bytes\n", millis());
-        free(buffer);
-        if (!wasOpen) {
-          close();
-        }
-        return false;
-      }
-
-      out.write(buffer, dataRead);
-      remaining -= dataRead;
-    }
-
-    if (!wasOpen) {
-      close();
-    }
-    free(buffer);
-    return true;
-  }
-
-  if (fileStat.method == MZ_DEFLATED) {
-    // Setup inflator
-    const auto inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
-    if (!inflator) {
-      Serial.printf("[%lu] [ZIP] Failed to allocate memory for inflator\n", millis());
-      if (!wasOpen) {
-        close();
-      }
-      return false;
-    }
-    memset(inflator, 0, sizeof(tinfl_decompressor));
-    tinfl_init(inflator);
-
-    // Setup file read buffer
-    const auto fileReadBuffer = static_cast<uint8_t*>(malloc(chunkSize));
-    if (!fileReadBuffer) {
-      Serial.printf("[%lu] [ZIP] Failed to allocate memory for zip file read buffer\n", millis());
-      free(inflator);
-      if (!wasOpen) {
-        close();
-      }
-      return false;
-    }
-
-    const auto outputBuffer = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
-    if (!outputBuffer) {
-      Serial.printf("[%lu] [ZIP] Failed to allocate memory for dictionary\n", millis());
-      free(inflator);
-      free(fileReadBuffer);
-      if (!wasOpen) {
-        close();
-      }
-      return false;
-    }
-    memset(outputBuffer, 0, TINFL_LZ_DICT_SIZE);
-
-    size_t fileRemainingBytes = deflatedDataSize;
-    size_t processedOutputBytes = 0;
-    size_t fileReadBufferFilledBytes = 0;
-    size_t fileReadBufferCursor = 0;
-    size_t outputCursor = 0;  // Current offset in the circular dictionary
-
-    while (true) {
-      // Load more compressed bytes when needed
-      if (fileReadBufferCursor >= fileReadBufferFilledBytes) {
-        if (fileRemainingBytes == 0) {
-          // Should not be hit, but a safe protection
-          break;  // EOF
-        }
-
-        fileReadBufferFilledBytes =
-            file.read(fileReadBuffer, fileRemainingBytes < chunkSize ? fileRemainingBytes : chunkSize);
-        fileRemainingBytes -= fileReadBufferFilledBytes;
-        fileReadBufferCursor = 0;
-
-        if (fileReadBufferFilledBytes == 0) {
-          // Bad read
-          break;  // EOF
-        }
-      }
-
-      // Available bytes in fileReadBuffer to process
-      size_t inBytes = fileReadBufferFilledBytes - fileReadBufferCursor;
-      // Space remaining in outputBuffer
-      size_t outBytes = TINFL_LZ_DICT_SIZE - outputCursor;
-
-      const tinfl_status status = tinfl_decompress(inflator, fileReadBuffer + fileReadBufferCursor, &inBytes,
-                                                   outputBuffer, outputBuffer + outputCursor, &outBytes,
-                                                   fileRemainingBytes > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0);
-
-      // Update input position
-      fileReadBufferCursor += inBytes;
-
-      // Write output chunk
-      if (outBytes > 0) {
-        processedOutputBytes += outBytes;
-        if (out.write(outputBuffer + outputCursor, outBytes) != outBytes) {
-          Serial.printf("[%lu] [ZIP] Failed to write all output bytes to stream\n", millis());
-          if (!wasOpen) {
-            close();
-          }
-          free(outputBuffer);
-          free(fileReadBuffer);
-          free(inflator);
-          return false;
-        }
-        // Update output position in buffer (with wraparound)
-        outputCursor = (outputCursor + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
-      }
-
-      if (status < 0) {
-        Serial.printf("[%lu] [ZIP] tinfl_decompress() failed with status %d\n", millis(), status);
-        if (!wasOpen) {
-          close();
-        }
-        free(outputBuffer);
-        free(fileReadBuffer);
-        free(inflator);
-        return false;
-      }
-
-      if (status == TINFL_STATUS_DONE) {
-        Serial.printf("[%lu] [ZIP] Decompressed %d bytes into %d bytes\n", millis(), deflatedDataSize,
-                      inflatedDataSize);
-        if (!wasOpen) {
-          close();
-        }
-        free(inflator);
-        free(fileReadBuffer);
-        free(outputBuffer);
-        return true;
-      }
-    }
-
-    // If we get here, EOF reached without TINFL_STATUS_DONE
-    Serial.printf("[%lu] [ZIP] Unexpected EOF\n", millis());
-    if (!wasOpen) {
-      close();
-    }
-    free(outputBuffer);
-    free(fileReadBuffer);
-    free(inflator);
-    return false;
-  }
-
-  if (!wasOpen) {
-    close();
-  }
-
-  Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
-  return false;
-}
@@ -6,6 +6,9 @@
 #include <vector>
 
 class ZipFile {
+  // Reads entries through the central directory lookups and the open file kept here
+  friend class ZipSession;
+
  public:
   struct FileStatSlim {
     uint16_t method;             // Compression method
@@ -27,6 +30,30 @@ class ZipFile {
     uint16_t index;  // Caller's index (e.g. spine index)
   };
 
+  // One entry of the on-disk central directory index, sorted by (hash, len)
+  struct IndexEntry {
+    uint64_t hash;  // FNV-1a 64-bit hash of the entry name
+    uint16_t len;   // Length of the entry name
+    uint16_t method;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+    uint32_t localHeaderOffset;
+  };
+
+  // What an index records about the zip it was built for. A copy of the same size can still be a different book, so the
+  // modification time and the central directory position are part of it too.
+  struct IndexKey {
+    uint32_t zipSize;
+    uint16_t modifyDate;
+    uint16_t modifyTime;
+    uint32_t centralDirOffset;
+
+    bool operator==(const IndexKey& other) const {
+      return zipSize == other.zipSize && modifyDate == other.modifyDate && modifyTime == other.modifyTime &&
+             centralDirOffset == other.centralDirOffset;
+    }
+  };
+
   // FNV-1a 64-bit hash computed from char buffer (no std::string allocation)
   static uint64_t fnvHash64(const char* s, size_t len) {
     uint64_t hash = 14695981039346656037ull;
@@ -38,8 +65,16 @@ class ZipFile {
   }
 
  private:
+  enum class IndexLookup { Found, NotFound, Unavailable };
+
   const std::string& filePath;
+  // Central directory index built by buildIndex(), nullptr to always scan the central directory
+  const std::string* indexPath;
   FsFile file;
+  // indexPath, opened by the first lookup and kept open until close()
+  FsFile indexFile;
+  uint32_t indexEntryCount = 0;
+  bool indexUnavailable = false;
   ZipDetails zipDetails = {0, 0, false};
   std::unordered_map<std::string, FileStatSlim> fileStatSlimCache;
 
@@ -48,25 +83,29 @@ class ZipFile {
   bool lastCentralDirPosValid = false;
 
   bool loadFileStatSlim(const char* filename, FileStatSlim* fileStat);
+  bool openIndex();
+  IndexLookup lookupIndex(const char* filename, FileStatSlim* fileStat);
+  bool getIndexKey(IndexKey* key);
+  bool buildIndex(const std::string& indexPath, const IndexKey& key);
   long getDataOffset(const FileStatSlim& fileStat);
   bool loadZipDetails();
 
  public:
-  explicit ZipFile(const std::string& filePath) : filePath(filePath) {}
-  ~ZipFile() = default;
+  explicit ZipFile(const std::string& filePath, const std::string* indexPath = nullptr)
+      : filePath(filePath), indexPath(indexPath) {}
+  ~ZipFile() { close(); }
   // Zip file can be opened and closed by hand in order to allow for quick calculation of inflated file size
-  // It is NOT recommended to pre-open it for any kind of inflation due to memory constraints
   bool isOpen() const { return !!file; }
   bool open();
   bool close();
   bool loadAllFileStatSlims();
+  // Checks that the index at indexPath was built for this zip, (re)building it with one central directory scan if
+  // not. Lookups through an index are a binary search on the SD card instead of a central directory scan.
+  bool ensureIndex(const std::string& indexPath);
   bool getInflatedFileSize(const char* filename, size_t* size);
   // Batch lookup: scan ZIP central dir once and fill sizes for matching targets.
   // targets must be sorted by (hash, len). sizes[target.index] receives uncompressedSize.
   // Returns number of targets matched.
   int fillUncompressedSizes(std::vector<SizeTarget>& targets, std::vector<uint32_t>& sizes);
-  // Due to the memory required to run each of these, it is recommended to not preopen the zip file for multiple
-  // These functions will open and close the zip as needed
-  uint8_t* readFileToMemory(const char* filename, size_t* size = nullptr, bool trailingNullByte = false);
-  bool readFileToStream(const char* filename, Print& out, size_t chunkSize);
+  // Entry contents are read through a ZipSession
 };
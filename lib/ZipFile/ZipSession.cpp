@@ -0,0 +1,275 @@
+#include "ZipSession.h"
+
+#include <HardwareSerial.h>
+#include <MemTrack.h>
+#include <Trace.h>
+#if defined(PLATFORM_M5PAPER)
+#include <lgfx/utility/lgfx_miniz.h>
+using tinfl_decompressor = lgfx_tinfl_decompressor;
+using tinfl_status = lgfx_tinfl_status;
+#define tinfl_init lgfx_tinfl_init
+#define tinfl_decompress lgfx_tinfl_decompress
+#ifndef MZ_NO_COMPRESSION
+#define MZ_NO_COMPRESSION 0
+#endif
+#else
+#include <miniz.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace {
+constexpr size_t INPUT_BUFFER_SIZE = 1024;
+// Stored entries are copied through the window in pieces of this size
+constexpr size_t STORED_CHUNK_SIZE = 4096;
+}  // namespace
+
+struct ZipSession::InflateState {
+  tinfl_decompressor inflator;
+  uint8_t window[TINFL_LZ_DICT_SIZE];
+  uint8_t input[INPUT_BUFFER_SIZE];
+  memtrack::Charge charge{memtrack::Tag::ZipInflate, sizeof(InflateState)};
+};
+
+ZipSession::ZipSession(std::string filePath, const std::string* indexPath)
+    : filePath(std::move(filePath)),
+      indexPath(indexPath ? *indexPath : std::string()),
+      zip(this->filePath, this->indexPath.empty() ? nullptr : &this->indexPath) {}
+
+ZipSession::~ZipSession() { zip.close(); }
+
+bool ZipSession::prepare(std::unique_ptr<InflateState>& inflateState) {
+  if (!inflateState) {
+    inflateState.reset(new (std::nothrow) InflateState);
+    if (!inflateState) {
+      memtrack::noteFailure(memtrack::Tag::ZipInflate, sizeof(InflateState));
+      Serial.printf("[%lu] [ZIP] Failed to allocate memory for inflate state\n", millis());
+      return false;
+    }
+  }
+  return zip.isOpen() || zip.open();
+}
+
+ZipSession::Reader::Reader(ZipSession& session) {
+  if (!session.busy.exchange(true)) {
+    nested = false;
+  } else if (!session.nestedBusy.exchange(true)) {
+    nested = true;
+  } else {
+    Serial.printf("[%lu] [ZIP] Zip session busy\n", millis());
+    failed = true;
+    return;
+  }
+
+  std::unique_ptr<InflateState>& inflateState = nested ? session.nestedState : session.state;
+  if (!session.prepare(inflateState)) {
+    (nested ? session.nestedBusy : session.busy) = false;
+    failed = true;
+    return;
+  }
+  this->session = &session;
+  state = inflateState.get();
+}
+
+ZipSession::Reader::~Reader() {
+  if (!session) {
+    return;
+  }
+  if (nested) {
+    session->nestedBusy = false;
+    return;
+  }
+  // The nested state only lives as long as the read it was nested in, unless a nested read is still going
+  if (!session->nestedBusy.exchange(true)) {
+    session->nestedState.reset();
+    session->nestedBusy = false;
+  }
+  session->busy = false;
+}
+
+bool ZipSession::Reader::fail() {
+  failed = true;
+  return false;
+}
+
+bool ZipSession::Reader::open(const char* filename) {
+  TRACE_SCOPE("sd", "zip_open");
+  if (failed) {
+    return false;
+  }
+
+  ZipFile& zip = session->zip;
+  if (!zip.loadFileStatSlim(filename, &fileStat)) {
+    return fail();
+  }
+  const long dataOffset = zip.getDataOffset(fileStat);
+  if (dataOffset < 0) {
+    return fail();
+  }
+  filePosition = dataOffset;
+  if (fileStat.method != MZ_NO_COMPRESSION && fileStat.method != MZ_DEFLATED) {
+    Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
+    return fail();
+  }
+
+  compressedRemaining = fileStat.method == MZ_DEFLATED ? fileStat.compressedSize : fileStat.uncompressedSize;
+  inputPos = 0;
+  inputFilled = 0;
+  outputCursor = 0;
+  pendingLength = 0;
+  done = false;
+  tinfl_init(&state->inflator);
+  return true;
+}
+
+bool ZipSession::Reader::nextChunk(const uint8_t** data, size_t* length) {
+  if (failed || done || !state) {
+    return false;
+  }
+  TRACE_SCOPE("sd", "zip_chunk");
+  FsFile& file = session->zip.file;
+  // A nested read or a size lookup may have moved the shared file since this read last used it
+  if (compressedRemaining > 0 && file.position() != filePosition && !file.seek(filePosition)) {
+    return fail();
+  }
+
+  if (fileStat.method == MZ_NO_COMPRESSION) {
+    if (compressedRemaining == 0) {
+      done = true;
+      return false;
+    }
+    const size_t toRead = std::min<size_t>(compressedRemaining, STORED_CHUNK_SIZE);
+    if (file.read(state->window, toRead) != static_cast<int>(toRead)) {
+      Serial.printf("[%lu] [ZIP] Could not read more bytes\n", millis());
+      return fail();
+    }
+    compressedRemaining -= toRead;
+    filePosition += toRead;
+    *data = state->window;
+    *length = toRead;
+    return true;
+  }
+
+  while (true) {
+    // Load more compressed bytes when needed
+    if (inputPos >= inputFilled && compressedRemaining > 0) {
+      const size_t toRead = std::min<size_t>(compressedRemaining, INPUT_BUFFER_SIZE);
+      if (file.read(state->input, toRead) != static_cast<int>(toRead)) {
+        Serial.printf("[%lu] [ZIP] Could not read more bytes\n", millis());
+        return fail();
+      }
+      compressedRemaining -= toRead;
+      filePosition += toRead;
+      inputPos = 0;
+      inputFilled = toRead;
+    }
+
+    size_t inBytes = inputFilled - inputPos;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - outputCursor;
+    const int flags = compressedRemaining > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+    const tinfl_status status = tinfl_decompress(&state->inflator, state->input + inputPos, &inBytes, state->window,
+                                                 state->window + outputCursor, &outBytes, flags);
+    inputPos += inBytes;
+
+    if (status < 0) {
+      Serial.printf("[%lu] [ZIP] tinfl_decompress() failed with status %d\n", millis(), status);
+      return fail();
+    }
+    if (status == TINFL_STATUS_DONE) {
+      Serial.printf("[%lu] [ZIP] Decompressed %u bytes into %u bytes\n", millis(), fileStat.compressedSize,
+                    fileStat.uncompressedSize);
+      done = true;
+    } else if (outBytes == 0 && inputPos >= inputFilled && compressedRemaining == 0) {
+      Serial.printf("[%lu] [ZIP] Unexpected EOF\n", millis());
+      return fail();
+    }
+
+    if (outBytes > 0) {
+      *data = state->window + outputCursor;
+      *length = outBytes;
+      // The window is circular, tinfl wraps back to its start once the end is filled
+      outputCursor = (outputCursor + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+      return true;
+    }
+    if (done) {
+      return false;
+    }
+  }
+}
+
+size_t ZipSession::Reader::read(uint8_t* buffer, const size_t length) {
+  size_t copied = 0;
+  while (copied < length) {
+    if (pendingLength == 0 && !nextChunk(&pending, &pendingLength)) {
+      break;
+    }
+    const size_t count = std::min(length - copied, pendingLength);
+    memcpy(buffer + copied, pending, count);
+    pending += count;
+    pendingLength -= count;
+    copied += count;
+  }
+  return copied;
+}
+
+bool ZipSession::getInflatedFileSize(const char* filename, size_t* size) {
+  // Only moves the file position, which a read in progress restores before it reads on
+  ZipFile::FileStatSlim fileStat = {};
+  const bool found = (zip.isOpen() || zip.open()) && zip.loadFileStatSlim(filename, &fileStat);
+  if (found) {
+    *size = static_cast<size_t>(fileStat.uncompressedSize);
+  }
+  return found;
+}
+
+uint8_t* ZipSession::readFileToMemory(const char* filename, size_t* size, const bool trailingNullByte) {
+  Reader reader(*this);
+  if (!reader.open(filename)) {
+    return nullptr;
+  }
+
+  const size_t inflatedDataSize = reader.size();
+  const size_t dataSize = trailingNullByte ? inflatedDataSize + 1 : inflatedDataSize;
+  const auto data = static_cast<uint8_t*>(malloc(dataSize));
+  if (data == nullptr) {
+    Serial.printf("[%lu] [ZIP] Failed to allocate memory for output buffer (%zu bytes)\n", millis(), dataSize);
+    return nullptr;
+  }
+
+  // Inflated straight into the output buffer through the session window, no copy of the deflated data is needed
+  if (reader.read(data, inflatedDataSize) != inflatedDataSize) {
+    Serial.printf("[%lu] [ZIP] Failed to inflate file\n", millis());
+    free(data);
+    return nullptr;
+  }
+
+  if (trailingNullByte) data[inflatedDataSize] = '\0';
+  if (size) *size = inflatedDataSize;
+  return data;
+}
+
+bool ZipSession::readFileToStream(const char* filename, Print& out, const size_t chunkSize) {
+  Reader reader(*this);
+  if (!reader.open(filename)) {
+    return false;
+  }
+
+  const uint8_t* data;
+  size_t length;
+  while (reader.nextChunk(&data, &length)) {
+    // Sinks rely on getting at most chunkSize bytes per write, e.g. to yield between them
+    while (length > 0) {
+      const size_t count = std::min(length, chunkSize);
+      if (out.write(data, count) != count) {
+        Serial.printf("[%lu] [ZIP] Failed to write all output bytes to stream\n", millis());
+        return false;
+      }
+      data += count;
+      length -= count;
+    }
+  }
+
+  return reader.isComplete();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <Print.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "ZipFile.h"
+
+// Keeps one zip open together with a single inflate state (decompressor, 32KB window and input buffer) that is
+// allocated on first use and reused by every later read, so reading many entries in a row doesn't hit the allocator.
+// A read may start while another one is still going, e.g. an image pulled in from inside a chapter parse. That nested
+// read gets a second inflate state, which is freed again when the outer read ends. Both share the open zip, each
+// seeking back to its own place before reading. A third concurrent read fails. Callers on different tasks must not
+// interleave reads; the reader activities serialize them with their rendering mutex.
+class ZipSession {
+  struct InflateState;
+
+  std::string filePath;
+  std::string indexPath;
+  ZipFile zip;
+  std::unique_ptr<InflateState> state;
+  std::unique_ptr<InflateState> nestedState;
+  std::atomic<bool> busy{false};
+  std::atomic<bool> nestedBusy{false};
+
+  // Opens the zip and allocates inflateState if it isn't yet
+  bool prepare(std::unique_ptr<InflateState>& inflateState);
+  const std::string* getIndexPath() const { return indexPath.empty() ? nullptr : &indexPath; }
+
+ public:
+  // Streams one entry. Holds the session, or its nested slot when another read is going, until destroyed.
+  class Reader {
+    ZipSession* session = nullptr;
+    bool nested = false;
+    InflateState* state = nullptr;
+    ZipFile::FileStatSlim fileStat = {};
+    // Where this read continues in the zip, another read may have moved the shared file in between
+    uint32_t filePosition = 0;
+    uint32_t compressedRemaining = 0;
+    size_t inputPos = 0;
+    size_t inputFilled = 0;
+    size_t outputCursor = 0;
+    const uint8_t* pending = nullptr;
+    size_t pendingLength = 0;
+    bool done = false;
+    bool failed = false;
+
+    bool fail();
+
+   public:
+    explicit Reader(ZipSession& session);
+    ~Reader();
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    bool open(const char* filename);
+    uint32_t size() const { return fileStat.uncompressedSize; }
+    // Next run of inflated bytes, valid until the following call. False at the end of the entry or on error.
+    bool nextChunk(const uint8_t** data, size_t* length);
+    // Copies up to length inflated bytes into buffer, returns how many were copied (0 at the end or on error)
+    size_t read(uint8_t* buffer, size_t length);
+    bool isComplete() const { return done && !failed; }
+  };
+
+  explicit ZipSession(std::string filePath, const std::string* indexPath = nullptr);
+  ~ZipSession();
+
+  bool getInflatedFileSize(const char* filename, size_t* size);
+  uint8_t* readFileToMemory(const char* filename, size_t* size = nullptr, bool trailingNullByte = false);
+  // Writes the entry to out in pieces of at most chunkSize bytes; a short write aborts the read
+  bool readFileToStream(const char* filename, Print& out, size_t chunkSize);
+};
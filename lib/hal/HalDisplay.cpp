@@ -32,6 +32,13 @@ EInkDisplay::RefreshMode convertRefreshMode(HalDisplay::RefreshMode mode) {
 
 void HalDisplay::displayBuffer(HalDisplay::RefreshMode mode) { einkDisplay.displayBuffer(convertRefreshMode(mode)); }
 
+void HalDisplay::displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+  // The SSD1677 RAM window is addressed in whole bytes, so widen the window to 8 pixel boundaries
+  const uint16_t alignedX = x & ~7;
+  const uint16_t alignedW = ((x + w + 7) & ~7) - alignedX;
+  einkDisplay.displayWindow(alignedX, y, alignedW, h);
+}
+
 void HalDisplay::refreshDisplay(HalDisplay::RefreshMode mode, bool turnOffScreen) {
   einkDisplay.refreshDisplay(convertRefreshMode(mode), turnOffScreen);
 }
@@ -158,10 +165,25 @@ void HalDisplay::displayBuffer(HalDisplay::RefreshMode mode) {
   if (!frameBuffer) {
     return;
   }
+  // Fast refreshes only push the part of the frame that differs from what is already on the panel
+  if (mode == FAST_REFRESH) {
+    displayWindow(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    return;
+  }
   epdDisplay.setFramebuffer(frameBuffer);
   epdDisplay.displayBuffer(mapRefreshMode(mode));
 }
 
+void HalDisplay::displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+  if (!frameBuffer) {
+    return;
+  }
+  if (!epdDisplay.setFramebufferWindow(frameBuffer, &x, &y, &w, &h)) {
+    return;  // Nothing in the window changed
+  }
+  epdDisplay.displayWindow(x, y, w, h);
+}
+
 void HalDisplay::refreshDisplay(HalDisplay::RefreshMode mode, bool turnOffScreen) {
   (void)turnOffScreen;
   displayBuffer(mode);
@@ -183,6 +205,29 @@ void HalDisplay::cleanupGrayscaleBuffers(const uint8_t* bwBuffer) { (void)bwBuff
 
 void HalDisplay::displayGrayBuffer() { displayBuffer(FAST_REFRESH); }
 
+uint8_t* HalDisplay::getGrayFrameBuffer() { return epdDisplay.getFrameBuffer(); }
+
+void HalDisplay::clearGrayFrameBuffer(uint8_t color) { epdDisplay.clearScreen(color); }
+
+void HalDisplay::displayGrayFrameBuffer(HalDisplay::RefreshMode mode) {
+  epdDisplay.displayBuffer(mapRefreshMode(mode));
+
+  // Keep the 1bpp buffer in step with the panel so BW overlays drawn next (popups, menus) start from this page
+  const uint8_t* grayBuffer = epdDisplay.getFrameBuffer();
+  if (!grayBuffer || !frameBuffer) {
+    return;
+  }
+  for (uint32_t i = 0; i < BUFFER_SIZE; i++) {
+    const uint8_t* src = grayBuffer + i * 4;
+    uint8_t bits = 0;
+    for (int j = 0; j < 4; j++) {
+      bits <<= 2;
+      bits |= ((src[j] & 0x80) ? 0x02 : 0x00) | ((src[j] & 0x08) ? 0x01 : 0x00);
+    }
+    frameBuffer[i] = bits;
+  }
+}
+
 bool HalDisplay::ensureBuffer() {
   if (frameBuffer) {
     return true;
@@ -42,6 +42,8 @@ class HalDisplay {
                  bool fromProgmem = false) const;
 
   void displayBuffer(RefreshMode mode = RefreshMode::FAST_REFRESH);
+  // Fast refresh of a panel-space rectangle; the rest of the screen is left untouched
+  void displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
   void refreshDisplay(RefreshMode mode = RefreshMode::FAST_REFRESH, bool turnOffScreen = false);
 
   // Power management
@@ -57,6 +59,16 @@ class HalDisplay {
 
   void displayGrayBuffer();
 
+#ifdef PLATFORM_M5PAPER
+  // Native 4bpp grayscale target owned by the panel adapter.
+  // Two pixels per byte, first pixel in the high nibble, 0 = black .. 15 = white.
+  static constexpr uint32_t GRAY_BUFFER_SIZE = DISPLAY_WIDTH * DISPLAY_HEIGHT / 2;
+  uint8_t* getGrayFrameBuffer();
+  void clearGrayFrameBuffer(uint8_t color = 0xFF);
+  // Pushes the 4bpp buffer as-is, then thresholds it back into the 1bpp frame buffer
+  void displayGrayFrameBuffer(RefreshMode mode = RefreshMode::FAST_REFRESH);
+#endif
+
  private:
 #ifdef PLATFORM_M5PAPER
   M5PaperDisplayAdapter epdDisplay;
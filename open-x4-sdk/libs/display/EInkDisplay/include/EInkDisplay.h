@@ -43,7 +43,7 @@ class EInkDisplay {
 #endif
 
   void displayBuffer(RefreshMode mode = FAST_REFRESH);
-  // EXPERIMENTAL: Windowed update - display only a rectangular region
+  // Windowed update - fast refresh of a rectangular region, x and w must be multiples of 8
   void displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
   void displayGrayBuffer(bool turnOffScreen = false);
 
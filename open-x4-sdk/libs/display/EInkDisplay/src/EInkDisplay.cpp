@@ -452,7 +452,7 @@ void EInkDisplay::displayBuffer(RefreshMode mode) {
 #endif
 }
 
-// EXPERIMENTAL: Windowed update support
+// Windowed update support
 // Displays only a rectangular region of the frame buffer, preserving the rest of the screen.
 // Requirements: x and w must be byte-aligned (multiples of 8 pixels)
 void EInkDisplay::displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
@@ -523,6 +523,12 @@ void EInkDisplay::displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
   // Post-refresh: Sync RED RAM with current window (for next fast refresh)
   setRamArea(x, y, w, h);
   writeRamBuffer(CMD_WRITE_RAM_RED, windowBuffer.data(), windowBufferSize);
+#else
+  // Post-refresh: the window is now on screen, so it becomes part of the previous frame for the next fast refresh
+  for (uint16_t row = 0; row < h; row++) {
+    const uint32_t offset = (y + row) * DISPLAY_WIDTH_BYTES + (x / 8);
+    memcpy(&frameBufferActive[offset], &frameBuffer[offset], windowWidthBytes);
+  }
 #endif
 
   Serial.printf("[%lu]   Window display complete\n", millis());
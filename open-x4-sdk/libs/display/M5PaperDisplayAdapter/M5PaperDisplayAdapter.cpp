@@ -3,6 +3,8 @@
 #include <SPI.h>
 #include <esp32-hal-psram.h>
 
+#include <algorithm>
+
 namespace {
 // 4-bit grayscale palette (0=black .. 15=white).
 const lgfx::bgr888_t kGrayPalette4bpp[16] = {
@@ -16,6 +18,15 @@ const lgfx::bgr888_t kGrayPalette4bpp[16] = {
 
 constexpr uint32_t kDisplayWaitTimeoutMs = 4000;
 
+// Expands 8 1bpp pixels (MSB first, 1 = white) into 4 packed 4bpp bytes, first pixel in the high nibble.
+inline void expand1bppTo4bpp(const uint8_t src, uint8_t* dest) {
+  for (int i = 0; i < 4; i++) {
+    const uint8_t hi = (src & (0x80 >> (i * 2))) ? 0xF0 : 0x00;
+    const uint8_t lo = (src & (0x40 >> (i * 2))) ? 0x0F : 0x00;
+    dest[i] = hi | lo;
+  }
+}
+
 void waitDisplayWithTimeout(M5GFX* display) {
   if (!display) {
     return;
@@ -101,11 +112,28 @@ void M5PaperDisplayAdapter::displayBuffer(RefreshMode mode) {
 }
 
 void M5PaperDisplayAdapter::displayWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
-  (void)x;
-  (void)y;
-  (void)w;
-  (void)h;
-  displayBuffer(FAST_REFRESH);
+  if (!display || !ensureBuffer()) {
+    return;
+  }
+
+  if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT || w == 0 || h == 0) {
+    return;
+  }
+  if (x + w > DISPLAY_WIDTH) {
+    w = DISPLAY_WIDTH - x;
+  }
+  if (y + h > DISPLAY_HEIGHT) {
+    h = DISPLAY_HEIGHT - y;
+  }
+
+  display->setEpdMode(mapRefreshMode(FAST_REFRESH));
+  // Clip the full-frame push so only the window is transferred to the IT8951, then refresh just that area.
+  display->setClipRect(x, y, w, h);
+  display->pushImage(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, frameBuffer, lgfx::color_depth_t::grayscale_4bit,
+                     kGrayPalette4bpp);
+  display->clearClipRect();
+  display->display(x, y, w, h);
+  waitDisplayWithTimeout(display);
 }
 
 void M5PaperDisplayAdapter::deepSleep() {
@@ -121,26 +149,57 @@ void M5PaperDisplayAdapter::setFramebuffer(const uint8_t* buffer) {
   const uint32_t srcRowBytes = DISPLAY_WIDTH / 8;
   for (uint32_t y = 0; y < DISPLAY_HEIGHT; y++) {
     const uint8_t* srcRow = buffer + (y * srcRowBytes);
-    uint32_t destIndex = (y * DISPLAY_WIDTH) / 2;
+    uint8_t* destRow = frameBuffer + (y * DISPLAY_WIDTH) / 2;
     for (uint32_t xByte = 0; xByte < srcRowBytes; xByte++) {
-      const uint8_t src = srcRow[xByte];
-      const uint8_t p0 = (src & 0x80) ? 0x0F : 0x00;
-      const uint8_t p1 = (src & 0x40) ? 0x0F : 0x00;
-      const uint8_t p2 = (src & 0x20) ? 0x0F : 0x00;
-      const uint8_t p3 = (src & 0x10) ? 0x0F : 0x00;
-      const uint8_t p4 = (src & 0x08) ? 0x0F : 0x00;
-      const uint8_t p5 = (src & 0x04) ? 0x0F : 0x00;
-      const uint8_t p6 = (src & 0x02) ? 0x0F : 0x00;
-      const uint8_t p7 = (src & 0x01) ? 0x0F : 0x00;
-
       // Packed 4bpp format expected by LGFX pixelcopy: first pixel in high nibble.
-      frameBuffer[destIndex + 0] = (p0 << 4) | p1;
-      frameBuffer[destIndex + 1] = (p2 << 4) | p3;
-      frameBuffer[destIndex + 2] = (p4 << 4) | p5;
-      frameBuffer[destIndex + 3] = (p6 << 4) | p7;
-      destIndex += 4;
+      expand1bppTo4bpp(srcRow[xByte], destRow + xByte * 4);
+    }
+  }
+}
+
+bool M5PaperDisplayAdapter::setFramebufferWindow(const uint8_t* buffer, uint16_t* x, uint16_t* y, uint16_t* w,
+                                                 uint16_t* h) {
+  if (!buffer || !ensureBuffer()) {
+    return false;
+  }
+
+  // Work in whole source bytes (8 pixels)
+  const uint32_t srcRowBytes = DISPLAY_WIDTH / 8;
+  const uint32_t firstByte = *x / 8;
+  const uint32_t lastByte = std::min<uint32_t>((*x + *w + 7) / 8, srcRowBytes);
+  const uint32_t lastRow = std::min<uint32_t>(*y + *h, DISPLAY_HEIGHT);
+
+  uint32_t minByte = srcRowBytes;
+  uint32_t maxByte = 0;
+  uint32_t minRow = DISPLAY_HEIGHT;
+  uint32_t maxRow = 0;
+  for (uint32_t row = *y; row < lastRow; row++) {
+    const uint8_t* srcRow = buffer + (row * srcRowBytes);
+    uint8_t* destRow = frameBuffer + (row * DISPLAY_WIDTH) / 2;
+    for (uint32_t xByte = firstByte; xByte < lastByte; xByte++) {
+      uint8_t expanded[4];
+      expand1bppTo4bpp(srcRow[xByte], expanded);
+      uint8_t* dest = destRow + xByte * 4;
+      if (memcmp(dest, expanded, sizeof(expanded)) == 0) {
+        continue;
+      }
+      memcpy(dest, expanded, sizeof(expanded));
+      minByte = std::min(minByte, xByte);
+      maxByte = std::max(maxByte, xByte);
+      minRow = std::min(minRow, row);
+      maxRow = std::max(maxRow, row);
     }
   }
+
+  if (minByte > maxByte) {
+    return false;
+  }
+
+  *x = minByte * 8;
+  *w = (maxByte - minByte + 1) * 8;
+  *y = minRow;
+  *h = maxRow - minRow + 1;
+  return true;
 }
 
 void M5PaperDisplayAdapter::copyGrayscaleBuffers(const uint8_t* lsbBuffer, const uint8_t* msbBuffer) {
@@ -31,6 +31,9 @@ class M5PaperDisplayAdapter : public IDisplayDriver {
   void deepSleep() override;
   
   void setFramebuffer(const uint8_t* buffer) override;
+  // Converts a window of the 1bpp buffer and shrinks the window to the pixels that actually changed.
+  // Returns false when the window already matches what is in the 4bpp buffer.
+  bool setFramebufferWindow(const uint8_t* buffer, uint16_t* x, uint16_t* y, uint16_t* w, uint16_t* h);
   void copyGrayscaleBuffers(const uint8_t* lsbBuffer, const uint8_t* msbBuffer) override;
   void copyGrayscaleLsbBuffers(const uint8_t* lsbBuffer) override;
   void copyGrayscaleMsbBuffers(const uint8_t* msbBuffer) override;
@@ -66,6 +66,7 @@ void ScreenComponents::drawBattery(const GfxRenderer& renderer, const int left,
   renderer.drawLine(x + batteryWidth - 2, y + 1, x + batteryWidth - 2, y + batteryHeight - 2);
   renderer.drawPixel(x + batteryWidth - 1, y + 3);
   renderer.drawPixel(x + batteryWidth - 1, y + batteryHeight - 4);
+  renderer.markRegionDirty(x + batteryWidth - 1, y + 3, 1, batteryHeight - 6);
   renderer.drawLine(x + batteryWidth - 0, y + 4, x + batteryWidth - 0, y + batteryHeight - 5);
 
   // The +1 is to round up, so that we always fill at least one pixel
@@ -94,11 +94,8 @@ void DrawingActivity::loop() {
     // Join successive touch points with a line so quick strokes do not leave
     // dotted gaps on the slower e-paper refresh cadence.
     renderer.drawLine(lastStrokeX, lastStrokeY, logicalX, logicalY, true);
-    for (int dy = -kBrushRadius; dy <= kBrushRadius; dy++) {
-      for (int dx = -kBrushRadius; dx <= kBrushRadius; dx++) {
-        renderer.drawPixel(logicalX + dx, logicalY + dy, true);
-      }
-    }
+    renderer.fillRect(logicalX - kBrushRadius, logicalY - kBrushRadius, kBrushRadius * 2 + 1, kBrushRadius * 2 + 1,
+                      true);
     lastStrokeX = logicalX;
     lastStrokeY = logicalY;
     hasDirtyStroke = true;
@@ -118,11 +115,7 @@ void DrawingActivity::loop() {
 #elif defined(PLATFORM_M5PAPER)
   const auto detail = M5.Touch.getDetail();
   if (detail.isPressed()) {
-    for (int dy = -2; dy <= 2; dy++) {
-      for (int dx = -2; dx <= 2; dx++) {
-        renderer.drawPixel(static_cast<int>(detail.x) + dx, static_cast<int>(detail.y) + dy, true);
-      }
-    }
+    renderer.fillRect(static_cast<int>(detail.x) - 2, static_cast<int>(detail.y) - 2, 5, 5, true);
     renderer.displayBuffer();
   }
 #endif
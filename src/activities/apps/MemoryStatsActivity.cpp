@@ -0,0 +1,149 @@
+#include "MemoryStatsActivity.h"
+
+#include <Arduino.h>
+#include <GfxRenderer.h>
+#include <MemTrack.h>
+
+#include <cstdio>
+
+#include "MappedInputManager.h"
+#include "PaperS3Ui.h"
+#include "fontIds.h"
+
+namespace {
+const char* const kTagLabels[] = {"Fonts",          "Renderer BW chunks", "Zip inflate",      "Section build",
+                                  "Metadata cache", "JPEG conversion",    "WebSocket upload", "XTC page ring"};
+static_assert(sizeof(kTagLabels) / sizeof(kTagLabels[0]) == memtrack::TAG_COUNT, "One label per memtrack tag");
+
+void formatBytes(char* out, const size_t outSize, const size_t bytes) {
+  if (bytes >= 1024 * 1024) {
+    snprintf(out, outSize, "%.1f MB", bytes / (1024.0 * 1024.0));
+  } else {
+    snprintf(out, outSize, "%.1f KB", bytes / 1024.0);
+  }
+}
+
+// "12.0 KB, peak 40.0 KB"
+void formatUsage(char* out, const size_t outSize, const memtrack::TagStats& stats) {
+  char current[16];
+  char peak[16];
+  formatBytes(current, sizeof(current), stats.current);
+  formatBytes(peak, sizeof(peak), stats.peak);
+  snprintf(out, outSize, "%s, peak %s", current, peak);
+}
+
+// "PSRAM 8.0 KB, 2 failed (largest 48.0 KB)"
+void formatDetails(char* out, const size_t outSize, const memtrack::TagStats& stats) {
+  char psram[16];
+  formatBytes(psram, sizeof(psram), stats.psram);
+  if (stats.failures == 0) {
+    snprintf(out, outSize, "PSRAM %s, no failures", psram);
+    return;
+  }
+  char largest[16];
+  formatBytes(largest, sizeof(largest), stats.largestFailure);
+  snprintf(out, outSize, "PSRAM %s, %u failed (largest %s)", psram, static_cast<unsigned>(stats.failures), largest);
+}
+
+void formatTotals(char* out, const size_t outSize) {
+  char heapFree[16];
+  char heapMin[16];
+  char psramFree[16];
+  formatBytes(heapFree, sizeof(heapFree), ESP.getFreeHeap());
+  formatBytes(heapMin, sizeof(heapMin), ESP.getMinFreeHeap());
+  formatBytes(psramFree, sizeof(psramFree), ESP.getFreePsram());
+  snprintf(out, outSize, "Heap %s free (min %s), PSRAM %s free", heapFree, heapMin, psramFree);
+}
+}  // namespace
+
+MemoryStatsActivity::MemoryStatsActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
+                                         const std::function<void()>& onExit)
+    : Activity("MemoryStats", renderer, mappedInput), onExit(onExit) {}
+
+void MemoryStatsActivity::onEnter() {
+  Activity::onEnter();
+  needsRender = true;
+}
+
+void MemoryStatsActivity::loop() {
+#if defined(PLATFORM_M5PAPERS3)
+  int tapX = 0;
+  int tapY = 0;
+  if (mappedInput.wasTapped() &&
+      PaperS3Ui::rawTouchToPortrait(mappedInput.getTouchX(), mappedInput.getTouchY(), tapX, tapY)) {
+    if (PaperS3Ui::backButtonRect(renderer).contains(tapX, tapY)) {
+      if (onExit) {
+        onExit();
+      }
+      return;
+    }
+
+    if (PaperS3Ui::primaryActionRect(renderer).contains(tapX, tapY)) {
+      needsRender = true;
+    }
+  }
+#endif
+
+  if (mappedInput.wasPressed(MappedInputManager::Button::Back)) {
+    if (onExit) {
+      onExit();
+    }
+    return;
+  }
+
+  if (mappedInput.wasPressed(MappedInputManager::Button::Confirm)) {
+    needsRender = true;
+  }
+
+  if (needsRender) {
+    render();
+    needsRender = false;
+  }
+}
+
+void MemoryStatsActivity::render() {
+  char totals[96];
+  formatTotals(totals, sizeof(totals));
+
+  renderer.clearScreen();
+#if defined(PLATFORM_M5PAPERS3)
+  renderer.setOrientation(GfxRenderer::Orientation::Portrait);
+  PaperS3Ui::drawScreenHeader(renderer, "Memory", totals);
+  PaperS3Ui::drawBackButton(renderer);
+
+  for (size_t i = 0; i < memtrack::TAG_COUNT; i++) {
+    const memtrack::TagStats stats = memtrack::getStats(static_cast<memtrack::Tag>(i));
+    char usage[48];
+    char details[64];
+    formatUsage(usage, sizeof(usage), stats);
+    formatDetails(details, sizeof(details), stats);
+    PaperS3Ui::drawListRow(renderer, PaperS3Ui::listRowRect(renderer, static_cast<int>(i)), false, kTagLabels[i],
+                           usage, details);
+  }
+
+  PaperS3Ui::drawPrimaryActionButton(renderer, "Refresh");
+  renderer.displayBuffer();
+  return;
+#endif
+
+  renderer.setOrientation(GfxRenderer::Orientation::LandscapeCounterClockwise);
+  renderer.drawCenteredText(UI_12_FONT_ID, 16, "Memory");
+  renderer.drawCenteredText(UI_10_FONT_ID, 40, totals);
+
+  int y = 70;
+  for (size_t i = 0; i < memtrack::TAG_COUNT; i++) {
+    const memtrack::TagStats stats = memtrack::getStats(static_cast<memtrack::Tag>(i));
+    char usage[48];
+    char details[64];
+    formatUsage(usage, sizeof(usage), stats);
+    formatDetails(details, sizeof(details), stats);
+    renderer.drawText(UI_10_FONT_ID, 40, y, kTagLabels[i]);
+    renderer.drawText(UI_10_FONT_ID, 240, y, usage);
+    y += 20;
+    renderer.drawText(SMALL_FONT_ID, 240, y, details);
+    y += 22;
+  }
+
+  renderer.drawCenteredText(SMALL_FONT_ID, renderer.getScreenHeight() - 24, "Confirm: Refresh   Back: Menu");
+  renderer.displayBuffer();
+}
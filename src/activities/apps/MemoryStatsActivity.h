@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+
+#include "../Activity.h"
+
+// Heap and PSRAM totals plus the current, peak and failed allocations of every memtrack tag
+class MemoryStatsActivity final : public Activity {
+ public:
+  MemoryStatsActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, const std::function<void()>& onExit);
+
+  void onEnter() override;
+  void loop() override;
+
+ private:
+  std::function<void()> onExit;
+  bool needsRender = true;
+
+  void render();
+};
@@ -52,5 +52,6 @@ enum class LauncherAction : uint8_t {
   ToolsOtaUpdate,
   SettingsWifi,
   SettingsHardwareTest,
+  SettingsMemory,
   Calculator
 };
@@ -82,6 +82,7 @@ std::vector<LauncherActivity::SubmenuItem> buildSettingsMenu() {
   return {
       {"WiFi", LauncherAction::SettingsWifi},
       {"Hardware Test", LauncherAction::SettingsHardwareTest},
+      {"Memory", LauncherAction::SettingsMemory},
   };
 }
 
@@ -220,6 +221,7 @@ LauncherItemId submenuItemToIcon(const LauncherAction action) {
       return LauncherItemId::Tools;
     case LauncherAction::SettingsWifi:
     case LauncherAction::SettingsHardwareTest:
+    case LauncherAction::SettingsMemory:
       return LauncherItemId::Settings;
     case LauncherAction::Calculator:
       return LauncherItemId::Calculator;
@@ -299,6 +301,8 @@ const char* submenuBadge(const LauncherAction action) {
       return "WIFI";
     case LauncherAction::SettingsHardwareTest:
       return "HW";
+    case LauncherAction::SettingsMemory:
+      return "MEM";
     case LauncherAction::Calculator:
       return "CALC";
     case LauncherAction::None:
@@ -391,6 +395,8 @@ const char* submenuDescription(const LauncherAction action) {
       return "Manage saved Wi-Fi credentials";
     case LauncherAction::SettingsHardwareTest:
       return "Run PaperS3 hardware diagnostics";
+    case LauncherAction::SettingsMemory:
+      return "Heap and PSRAM use by subsystem";
     default:
       return "";
   }
@@ -908,6 +914,7 @@ void LauncherActivity::drawCircle(int cx, int cy, int radius, bool fill, bool co
       }
     }
   }
+  renderer.markRegionDirty(cx - radius, cy - radius, radius * 2 + 1, radius * 2 + 1);
 }
 
 void LauncherActivity::drawIconSymbol(int cx, int cy, LauncherItemId id, bool selected) const {
@@ -1109,6 +1116,13 @@ void LauncherActivity::drawSubmenuActionIcon(int cx, int cy, LauncherAction acti
       renderer.drawLine(cx, cy - 10, cx, cy + 10, black);
       renderer.drawLine(cx - 6, cy - 6, cx + 6, cy + 6, black);
       break;
+    case LauncherAction::SettingsMemory:
+      renderer.drawRect(cx - 8, cy - 10, 16, 20, black);
+      for (int pin = -6; pin <= 6; pin += 6) {
+        renderer.drawLine(cx - 12, cy + pin, cx - 8, cy + pin, black);
+        renderer.drawLine(cx + 8, cy + pin, cx + 12, cy + pin, black);
+      }
+      break;
     case LauncherAction::GamePoodle:
       drawIconSymbol(cx, cy, LauncherItemId::Games, selected);
       renderer.drawRect(cx - 4, cy - 6, 8, 12, black);
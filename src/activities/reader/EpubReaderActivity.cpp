@@ -4,14 +4,17 @@
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
 #include <SDCardManager.h>
+#include <Trace.h>
 
 #include "../apps/PaperS3Ui.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "EpubReaderChapterSelectionActivity.h"
 #include "MappedInputManager.h"
+#include "ReaderDisplay.h"
 #include "RecentBooksStore.h"
 #include "ScreenComponents.h"
+#include "activities/util/KeyboardEntryActivity.h"
 #include "fontIds.h"
 
 namespace {
@@ -20,6 +23,8 @@ constexpr unsigned long skipChapterMs = 700;
 constexpr unsigned long goHomeMs = 1000;
 constexpr int statusBarMargin = 19;
 constexpr int progressBarMarginTop = 1;
+constexpr EventBits_t LOOKAHEAD_IDLE = 1 << 0;
+constexpr EventBits_t LOOKAHEAD_NOT_BUILDING = 1 << 1;
 
 void drawPaperS3ReaderChrome(GfxRenderer& renderer) {
 #if defined(PLATFORM_M5PAPERS3)
@@ -70,8 +75,13 @@ void EpubReaderActivity::onEnter() {
 #endif
 
   renderingMutex = xSemaphoreCreateMutex();
+  lookaheadEvents = xEventGroupCreate();
+  if (lookaheadEvents) {
+    xEventGroupSetBits(lookaheadEvents, LOOKAHEAD_IDLE | LOOKAHEAD_NOT_BUILDING);
+  }
 
   epub->setupCacheDir();
+  layoutIndex.reset(new BookLayoutIndex(epub->getCachePath()));
 
   FsFile f;
   if (SdMan.openFileForRead("ERS", epub->getCachePath() + "/progress.bin", f)) {
@@ -108,6 +118,10 @@ void EpubReaderActivity::onEnter() {
   updateRequired = true;
   lastOverlayRefreshMs = millis();
 
+  if (!lookaheadEvents || !lookaheadWorker.start("EpubLookaheadTask", 8192, [this] { lookaheadTaskLoop(); })) {
+    Serial.printf("[%lu] [ERS] Failed to start the look-ahead task\n", millis());
+  }
+
 #if !defined(PLATFORM_M5PAPERS3)
   xTaskCreate(&EpubReaderActivity::taskTrampoline, "EpubReaderActivityTask",
               8192,               // Stack size
@@ -124,6 +138,8 @@ void EpubReaderActivity::onExit() {
   // Reset orientation back to portrait for the rest of the UI
   renderer.setOrientation(GfxRenderer::Orientation::Portrait);
 
+  stopLookahead();
+
   // PaperS3 renders inline on the main loop to avoid the task-vs-touch races
   // that caused reader resets on the S3. Legacy boards keep the background
   // render task because their UI is still button-driven.
@@ -136,7 +152,15 @@ void EpubReaderActivity::onExit() {
     vSemaphoreDelete(renderingMutex);
     renderingMutex = nullptr;
   }
+  if (lookaheadEvents) {
+    vEventGroupDelete(lookaheadEvents);
+    lookaheadEvents = nullptr;
+  }
   section.reset();
+  if (layoutIndex) {
+    layoutIndex->flush();
+  }
+  layoutIndex.reset();
   epub.reset();
 }
 
@@ -176,13 +200,16 @@ void EpubReaderActivity::loop() {
 
   // Enter chapter selection activity
   if (mappedInput.wasReleased(MappedInputManager::Button::Confirm) || tapMenu) {
+    // Sub activities read the book without the rendering mutex, so the look-ahead worker has to be idle first
+    cancelLookahead();
     // Don't start activity transition while rendering
     xSemaphoreTake(renderingMutex, portMAX_DELAY);
     const int currentPage = section ? section->currentPage : 0;
     const int totalPages = section ? section->pageCount : 0;
     exitActivity();
     enterNewActivity(new EpubReaderMenuActivity(
-        this->renderer, this->mappedInput, epub->getTitle(), [this]() { onReaderMenuBack(); },
+        this->renderer, this->mappedInput, epub->getTitle(), layoutIndex && layoutIndex->isComplete(),
+        [this]() { onReaderMenuBack(); },
         [this](EpubReaderMenuActivity::MenuAction action) { onReaderMenuConfirm(action); }));
     xSemaphoreGive(renderingMutex);
   }
@@ -326,6 +353,31 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
       xSemaphoreGive(renderingMutex);
       break;
     }
+    case EpubReaderMenuActivity::MenuAction::GO_TO_PAGE: {
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
+      const uint32_t totalPages = layoutIndex->getTotalPages();
+      const uint32_t currentPage = section ? layoutIndex->getGlobalPage(currentSpineIndex, section->currentPage) : 0;
+      exitActivity();
+      enterNewActivity(new KeyboardEntryActivity(
+          this->renderer, this->mappedInput, "Go to page (1-" + std::to_string(totalPages) + ")",
+          std::to_string(currentPage + 1), 10,
+          10,     // maxLength
+          false,  // not password
+          [this](const std::string& text) {
+            const unsigned long page = strtoul(text.c_str(), nullptr, 10);
+            if (page > 0) {
+              goToBookPage(static_cast<uint32_t>(page - 1));
+            }
+            exitActivity();
+            updateRequired = true;
+          },
+          [this] {
+            exitActivity();
+            updateRequired = true;
+          }));
+      xSemaphoreGive(renderingMutex);
+      break;
+    }
     case EpubReaderMenuActivity::MenuAction::GO_HOME: {
       // 2. Trigger the reader's "Go Home" callback
       if (onGoHome) {
@@ -344,7 +396,8 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
         uint16_t backupPageCount = section->pageCount;
 
         section.reset();
-        // 3. WIPE: Clear the cache directory
+        // 3. WIPE: Clear the cache directory, once the look-ahead worker has let go of its section files
+        preemptLookahead();
         epub->clearCache();
 
         // 4. RESTORE: Re-setup the directory and rewrite the progress file
@@ -361,6 +414,25 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
   }
 }
 
+// Pages past the end go to the last page. Nothing happens while the layout index is incomplete, for instance when the
+// layout changed since the menu offered the jump.
+void EpubReaderActivity::goToBookPage(const uint32_t globalPage) {
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  const uint32_t totalPages = layoutIndex ? layoutIndex->getTotalPages() : 0;
+  int spineIndex;
+  int page;
+  if (totalPages > 0 && layoutIndex->findSection(std::min(globalPage, totalPages - 1), &spineIndex, &page)) {
+    if (section && currentSpineIndex == spineIndex) {
+      section->currentPage = page;
+    } else {
+      currentSpineIndex = spineIndex;
+      nextPageNumber = page;
+      section.reset();
+    }
+  }
+  xSemaphoreGive(renderingMutex);
+}
+
 void EpubReaderActivity::displayTaskLoop() {
   while (true) {
     if (updateRequired) {
@@ -373,6 +445,165 @@ void EpubReaderActivity::displayTaskLoop() {
   }
 }
 
+void EpubReaderActivity::lookaheadTaskLoop() {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xSemaphoreTake(renderingMutex, portMAX_DELAY);
+    if (lookaheadWorker.stopRequested()) {
+      xSemaphoreGive(renderingMutex);
+      break;
+    }
+
+    lookaheadBusy = true;
+    xEventGroupClearBits(lookaheadEvents, LOOKAHEAD_IDLE);
+    const uint32_t generation = lookaheadGeneration;
+    const int baseSpineIndex = lookaheadBaseSpineIndex;
+    const SectionLayout layout = lookaheadLayout;
+    // Hand the mutex back between inflated chunks so page turns never wait on a whole chapter
+    const std::function<bool()> continueFn = [this, generation]() {
+      xSemaphoreGive(renderingMutex);
+      vTaskDelay(1);
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
+      return generation == lookaheadGeneration;
+    };
+
+    // Next chapter first, that is where the reader is most likely headed, then the previous one, then whatever the
+    // layout index is still missing, each at most once per pass. Counts are saved in batches and when the pass ends,
+    // so progress survives sleep.
+    const int neighbours[] = {baseSpineIndex + 1, baseSpineIndex - 1};
+    size_t nextNeighbour = 0;
+    int missingFrom = 0;
+    while (baseSpineIndex >= 0 && generation == lookaheadGeneration) {
+      int target;
+      if (nextNeighbour < sizeof(neighbours) / sizeof(neighbours[0])) {
+        target = neighbours[nextNeighbour++];
+        if (target < 0 || target >= epub->getSpineItemsCount()) {
+          continue;
+        }
+      } else {
+        target = layoutIndex->nextMissingSpineIndex(missingFrom);
+        if (target < 0) {
+          break;
+        }
+        missingFrom = target + 1;
+      }
+
+      Section lookahead(epub, target, renderer);
+      if (lookahead.loadSectionFile(layout.fontId, layout.lineCompression, layout.extraParagraphSpacing,
+                                    layout.paragraphAlignment, layout.viewportWidth, layout.viewportHeight,
+                                    layout.hyphenationEnabled)) {
+        layoutIndex->setSectionPageCount(target, lookahead.pageCount);
+      } else {
+        Serial.printf("[%lu] [ERS] Look-ahead indexing spine index %d\n", millis(), target);
+        const auto start = millis();
+        xEventGroupClearBits(lookaheadEvents, LOOKAHEAD_NOT_BUILDING);
+        lookaheadBuildingSpineIndex = target;
+        if (lookahead.createSectionFile(layout.fontId, layout.lineCompression, layout.extraParagraphSpacing,
+                                        layout.paragraphAlignment, layout.viewportWidth, layout.viewportHeight,
+                                        layout.hyphenationEnabled, nullptr, continueFn)) {
+          Serial.printf("[%lu] [ERS] Look-ahead indexed spine index %d in %lums\n", millis(), target,
+                        millis() - start);
+          layoutIndex->setSectionPageCount(target, lookahead.pageCount);
+        } else if (generation == lookaheadGeneration) {
+          // Left without a count, the book total would be wrong otherwise. The next pass tries it again.
+          Serial.printf("[%lu] [ERS] Look-ahead indexing of spine index %d failed\n", millis(), target);
+        } else {
+          Serial.printf("[%lu] [ERS] Look-ahead indexing of spine index %d cancelled\n", millis(), target);
+        }
+        lookaheadBuildingSpineIndex = -1;
+        xEventGroupSetBits(lookaheadEvents, LOOKAHEAD_NOT_BUILDING);
+      }
+
+      if (!continueFn()) {
+        break;
+      }
+    }
+
+    layoutIndex->flush();
+    lookaheadBusy = false;
+    xEventGroupSetBits(lookaheadEvents, LOOKAHEAD_IDLE);
+    xSemaphoreGive(renderingMutex);
+  }
+}
+
+// Caller holds renderingMutex
+void EpubReaderActivity::scheduleLookahead(const SectionLayout& layout) {
+  if (!lookaheadWorker.isStarted() || subActivity) {
+    return;
+  }
+  if (lookaheadBaseSpineIndex == currentSpineIndex && lookaheadLayout == layout) {
+    return;
+  }
+
+  // Whatever is in flight belongs to another chapter or layout
+  lookaheadGeneration++;
+  lookaheadBaseSpineIndex = currentSpineIndex;
+  lookaheadLayout = layout;
+  lookaheadWorker.notify();
+}
+
+// Caller must not hold renderingMutex; returns once the worker is off the SD card
+void EpubReaderActivity::cancelLookahead() {
+  if (!renderingMutex || !lookaheadEvents) {
+    return;
+  }
+
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  lookaheadGeneration++;
+  lookaheadBaseSpineIndex = -1;
+  xSemaphoreGive(renderingMutex);
+
+  xEventGroupWaitBits(lookaheadEvents, LOOKAHEAD_IDLE, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+// Caller must not hold renderingMutex
+void EpubReaderActivity::stopLookahead() {
+  if (!renderingMutex) {
+    return;
+  }
+
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  lookaheadGeneration++;
+  lookaheadBaseSpineIndex = -1;
+  lookaheadWorker.requestStop();
+  xSemaphoreGive(renderingMutex);
+  lookaheadWorker.join();
+}
+
+// Caller holds renderingMutex. If the worker is part way through the chapter we are about to open, let it finish (or
+// abort it when the layout changed) instead of racing it on the same section file.
+void EpubReaderActivity::waitForLookaheadBuild(const SectionLayout& layout) {
+  const int spineIndex = currentSpineIndex;
+  if (lookaheadBuildingSpineIndex != spineIndex) {
+    return;
+  }
+
+  if (lookaheadLayout != layout) {
+    lookaheadGeneration++;
+  } else {
+    ScreenComponents::drawPopup(renderer, "Indexing...");
+  }
+
+  Serial.printf("[%lu] [ERS] Waiting for look-ahead build of spine index %d\n", millis(), spineIndex);
+  xSemaphoreGive(renderingMutex);
+  xEventGroupWaitBits(lookaheadEvents, LOOKAHEAD_NOT_BUILDING, pdFALSE, pdTRUE, portMAX_DELAY);
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+}
+
+// Caller holds renderingMutex. Cancels the worker's build and waits for it to unwind before a foreground build, which
+// then has the zip session, parser and word arenas to itself. scheduleLookahead() starts the worker again afterwards.
+void EpubReaderActivity::preemptLookahead() {
+  if (!lookaheadBusy) {
+    return;
+  }
+
+  lookaheadGeneration++;
+  lookaheadBaseSpineIndex = -1;
+  xSemaphoreGive(renderingMutex);
+  xEventGroupWaitBits(lookaheadEvents, LOOKAHEAD_IDLE, pdFALSE, pdTRUE, portMAX_DELAY);
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+}
+
 void EpubReaderActivity::renderIfNeeded() {
 #if defined(PLATFORM_M5PAPERS3)
   if (!updateRequired || !renderingMutex) {
@@ -388,6 +619,7 @@ void EpubReaderActivity::renderIfNeeded() {
 
 // TODO: Failure handling
 void EpubReaderActivity::renderScreen() {
+  TRACE_SCOPE("reader", "epub_page");
   if (!epub) {
     return;
   }
@@ -432,18 +664,29 @@ void EpubReaderActivity::renderScreen() {
                             (showProgressBar ? (ScreenComponents::BOOK_PROGRESS_BAR_HEIGHT + progressBarMarginTop) : 0);
   }
 
+  const uint16_t viewportWidth = renderer.getScreenWidth() - orientedMarginLeft - orientedMarginRight;
+  const uint16_t viewportHeight = renderer.getScreenHeight() - orientedMarginTop - orientedMarginBottom;
+  SectionLayout layout;
+  layout.fontId = SETTINGS.getReaderFontId();
+  layout.lineCompression = SETTINGS.getReaderLineCompression();
+  layout.extraParagraphSpacing = SETTINGS.extraParagraphSpacing;
+  layout.paragraphAlignment = SETTINGS.paragraphAlignment;
+  layout.viewportWidth = viewportWidth;
+  layout.viewportHeight = viewportHeight;
+  layout.hyphenationEnabled = SETTINGS.hyphenationEnabled;
+
   if (!section) {
+    waitForLookaheadBuild(layout);
+
     const auto filepath = epub->getSpineItem(currentSpineIndex).href;
     Serial.printf("[%lu] [ERS] Loading file: %s, index: %d\n", millis(), filepath.c_str(), currentSpineIndex);
     section = std::unique_ptr<Section>(new Section(epub, currentSpineIndex, renderer));
 
-    const uint16_t viewportWidth = renderer.getScreenWidth() - orientedMarginLeft - orientedMarginRight;
-    const uint16_t viewportHeight = renderer.getScreenHeight() - orientedMarginTop - orientedMarginBottom;
-
     if (!section->loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
                                   SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
                                   viewportHeight, SETTINGS.hyphenationEnabled)) {
       Serial.printf("[%lu] [ERS] Cache not found, building...\n", millis());
+      preemptLookahead();
 
       const auto popupFn = [this]() { ScreenComponents::drawPopup(renderer, "Indexing..."); };
 
@@ -476,6 +719,13 @@ void EpubReaderActivity::renderScreen() {
     }
   }
 
+  // Only adopt the layout once any wait for the worker above is over, so a stale build can never be recorded into it
+  layoutIndex->begin(layout.fontId, layout.lineCompression, layout.extraParagraphSpacing, layout.paragraphAlignment,
+                     layout.viewportWidth, layout.viewportHeight, layout.hyphenationEnabled,
+                     epub->getSpineItemsCount());
+  layoutIndex->setSectionPageCount(currentSpineIndex, section->pageCount);
+  scheduleLookahead(layout);
+
   renderer.clearScreen();
 
   if (section->pageCount == 0) {
@@ -509,6 +759,8 @@ void EpubReaderActivity::renderScreen() {
     Serial.printf("[%lu] [ERS] Rendered page in %dms\n", millis(), millis() - start);
   }
   saveProgress(currentSpineIndex, section->currentPage, section->pageCount);
+  // The panel is already updating, decode the likely next pages while it does
+  section->prefetchNeighbourPages();
 }
 
 void EpubReaderActivity::saveProgress(int spineIndex, int currentPage, int pageCount) {
@@ -531,17 +783,22 @@ void EpubReaderActivity::saveProgress(int spineIndex, int currentPage, int pageC
 void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int orientedMarginTop,
                                         const int orientedMarginRight, const int orientedMarginBottom,
                                         const int orientedMarginLeft) {
+#if defined(PLATFORM_M5PAPER)
+  if (SETTINGS.textAntiAliasing) {
+    ReaderDisplay::renderGray4Page(renderer, pagesUntilFullRefresh, [&] {
+      page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+      renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
+      drawPaperS3ReaderChrome(renderer);
+    });
+    return;
+  }
+#endif
+
   const bool hasImages = page->hasImages();
   page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
   renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
   drawPaperS3ReaderChrome(renderer);
-  if (pagesUntilFullRefresh <= 1) {
-    renderer.displayBuffer(HalDisplay::HALF_REFRESH);
-    pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
-  } else {
-    renderer.displayBuffer();
-    pagesUntilFullRefresh--;
-  }
+  ReaderDisplay::pushPage(renderer, pagesUntilFullRefresh);
 
   // Save bw buffer to reset buffer state after grayscale data sync
   renderer.storeBwBuffer();
@@ -591,9 +848,20 @@ void EpubReaderActivity::renderStatusBar(const int orientedMarginRight, const in
   const auto textY = screenHeight - orientedMarginBottom - 4;
   int progressTextWidth = 0;
 
-  // Calculate progress in book
-  const float sectionChapterProg = static_cast<float>(section->currentPage) / section->pageCount;
-  const float bookProgress = epub->calculateProgress(currentSpineIndex, sectionChapterProg) * 100;
+  // Calculate progress in book, exact once every section has been laid out and estimated from sizes until then.
+  // The page counter switches from chapter pages to book pages at the same point.
+  float bookProgress;
+  int displayPage = section->currentPage + 1;
+  int displayPageCount = section->pageCount;
+  if (layoutIndex && layoutIndex->isComplete() && layoutIndex->getTotalPages() > 0) {
+    const uint32_t globalPage = layoutIndex->getGlobalPage(currentSpineIndex, section->currentPage);
+    bookProgress = static_cast<float>(globalPage) / layoutIndex->getTotalPages() * 100;
+    displayPage = static_cast<int>(globalPage) + 1;
+    displayPageCount = static_cast<int>(layoutIndex->getTotalPages());
+  } else {
+    const float sectionChapterProg = static_cast<float>(section->currentPage) / section->pageCount;
+    bookProgress = epub->calculateProgress(currentSpineIndex, sectionChapterProg) * 100;
+  }
 
   if (showProgressText || showProgressPercentage) {
     // Right aligned text for progress counter
@@ -601,10 +869,9 @@ void EpubReaderActivity::renderStatusBar(const int orientedMarginRight, const in
 
     // Hide percentage when progress bar is shown to reduce clutter
     if (showProgressPercentage) {
-      snprintf(progressStr, sizeof(progressStr), "%d/%d  %.0f%%", section->currentPage + 1, section->pageCount,
-               bookProgress);
+      snprintf(progressStr, sizeof(progressStr), "%d/%d  %.0f%%", displayPage, displayPageCount, bookProgress);
     } else {
-      snprintf(progressStr, sizeof(progressStr), "%d/%d", section->currentPage + 1, section->pageCount);
+      snprintf(progressStr, sizeof(progressStr), "%d/%d", displayPage, displayPageCount);
     }
 
     progressTextWidth = renderer.getTextWidth(SMALL_FONT_ID, progressStr);
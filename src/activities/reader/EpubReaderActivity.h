@@ -1,16 +1,42 @@
 #pragma once
 #include <Epub.h>
+#include <Epub/BookLayoutIndex.h>
 #include <Epub/Section.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <atomic>
+
 #include "EpubReaderMenuActivity.h"
+#include "ReaderWorker.h"
 #include "activities/ActivityWithSubactivity.h"
 
 class EpubReaderActivity final : public ActivityWithSubactivity {
+  // Layout parameters a section file is built for
+  struct SectionLayout {
+    int fontId = 0;
+    float lineCompression = 0;
+    bool extraParagraphSpacing = false;
+    uint8_t paragraphAlignment = 0;
+    uint16_t viewportWidth = 0;
+    uint16_t viewportHeight = 0;
+    bool hyphenationEnabled = false;
+
+    bool operator==(const SectionLayout& other) const {
+      return fontId == other.fontId && lineCompression == other.lineCompression &&
+             extraParagraphSpacing == other.extraParagraphSpacing && paragraphAlignment == other.paragraphAlignment &&
+             viewportWidth == other.viewportWidth && viewportHeight == other.viewportHeight &&
+             hyphenationEnabled == other.hyphenationEnabled;
+    }
+    bool operator!=(const SectionLayout& other) const { return !(*this == other); }
+  };
+
   std::shared_ptr<Epub> epub;
   std::unique_ptr<Section> section = nullptr;
+  // Page counts for the whole book at the current layout, guarded by renderingMutex
+  std::unique_ptr<BookLayoutIndex> layoutIndex = nullptr;
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   int currentSpineIndex = 0;
@@ -20,11 +46,29 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   int cachedChapterTotalPageCount = 0;
   bool updateRequired = false;
   unsigned long lastOverlayRefreshMs = 0;
+  // Look-ahead indexing: a low priority worker on the other core builds the neighbouring section files, then the
+  // rest of the book so layoutIndex can be completed.
+  // The job fields are guarded by renderingMutex; the worker only touches the SD card while holding it.
+  ReaderWorker lookaheadWorker;
+  int lookaheadBaseSpineIndex = -1;  // spine item being read, -1 when there is no job
+  SectionLayout lookaheadLayout;
+  std::atomic<uint32_t> lookaheadGeneration{0};  // bumped to cancel the build in flight
+  std::atomic<int> lookaheadBuildingSpineIndex{-1};
+  std::atomic<bool> lookaheadBusy{false};
+  // LOOKAHEAD_IDLE and LOOKAHEAD_NOT_BUILDING mirror the two fields above for the tasks waiting on them; an event
+  // group because the UI loop and the display task can both be waiting at once
+  EventGroupHandle_t lookaheadEvents = nullptr;
   const std::function<void()> onGoBack;
   const std::function<void()> onGoHome;
 
   static void taskTrampoline(void* param);
   [[noreturn]] void displayTaskLoop();
+  void lookaheadTaskLoop();
+  void scheduleLookahead(const SectionLayout& layout);
+  void cancelLookahead();
+  void stopLookahead();
+  void waitForLookaheadBuild(const SectionLayout& layout);
+  void preemptLookahead();
   void renderIfNeeded();
   void renderScreen();
   void renderContents(std::unique_ptr<Page> page, int orientedMarginTop, int orientedMarginRight,
@@ -33,6 +77,8 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   void saveProgress(int spineIndex, int currentPage, int pageCount);
   void onReaderMenuBack();
   void onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction action);
+  // Caller must not hold renderingMutex
+  void goToBookPage(uint32_t globalPage);
 
  public:
   explicit EpubReaderActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, std::unique_ptr<Epub> epub,
@@ -13,14 +13,23 @@
 
 class EpubReaderMenuActivity final : public ActivityWithSubactivity {
  public:
-  enum class MenuAction { SELECT_CHAPTER, GO_HOME, DELETE_CACHE };
+  enum class MenuAction { SELECT_CHAPTER, GO_TO_PAGE, GO_HOME, DELETE_CACHE };
 
+  // canGoToPage offers "Go to Page", which needs the page count of the whole book
   explicit EpubReaderMenuActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, const std::string& title,
-                                  const std::function<void()>& onBack, const std::function<void(MenuAction)>& onAction)
+                                  const bool canGoToPage, const std::function<void()>& onBack,
+                                  const std::function<void(MenuAction)>& onAction)
       : ActivityWithSubactivity("EpubReaderMenu", renderer, mappedInput),
         title(title),
         onBack(onBack),
-        onAction(onAction) {}
+        onAction(onAction) {
+    menuItems.push_back({MenuAction::SELECT_CHAPTER, "Go to Chapter"});
+    if (canGoToPage) {
+      menuItems.push_back({MenuAction::GO_TO_PAGE, "Go to Page"});
+    }
+    menuItems.push_back({MenuAction::GO_HOME, "Go Home"});
+    menuItems.push_back({MenuAction::DELETE_CACHE, "Delete Book Cache"});
+  }
 
   void onEnter() override;
   void onExit() override;
@@ -32,9 +41,7 @@ class EpubReaderMenuActivity final : public ActivityWithSubactivity {
     std::string label;
   };
 
-  const std::vector<MenuItem> menuItems = {{MenuAction::SELECT_CHAPTER, "Go to Chapter"},
-                                           {MenuAction::GO_HOME, "Go Home"},
-                                           {MenuAction::DELETE_CACHE, "Delete Book Cache"}};
+  std::vector<MenuItem> menuItems;
 
   int selectedIndex = 0;
   bool updateRequired = false;
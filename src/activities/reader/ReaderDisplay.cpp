@@ -0,0 +1,25 @@
+#include "ReaderDisplay.h"
+
+#include "CrossPointSettings.h"
+
+namespace ReaderDisplay {
+void pushPage(const GfxRenderer& renderer, int& pagesUntilFullRefresh) {
+  if (pagesUntilFullRefresh <= 1) {
+    renderer.displayBuffer(HalDisplay::HALF_REFRESH);
+    pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
+  } else {
+    renderer.displayBuffer();
+    pagesUntilFullRefresh--;
+  }
+}
+
+#if defined(PLATFORM_M5PAPER)
+void renderGray4Page(GfxRenderer& renderer, int& pagesUntilFullRefresh, const std::function<void()>& drawPage) {
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_4BPP);
+  renderer.clearScreen();
+  drawPage();
+  pushPage(renderer, pagesUntilFullRefresh);
+  renderer.setRenderMode(GfxRenderer::BW);
+}
+#endif
+}  // namespace ReaderDisplay
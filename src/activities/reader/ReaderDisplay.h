@@ -0,0 +1,17 @@
+#pragma once
+
+#include <GfxRenderer.h>
+
+#include <functional>
+
+// Page pushes shared by the EPUB and TXT readers
+namespace ReaderDisplay {
+// Fast refresh, or a half refresh once every SETTINGS.getRefreshFrequency() pages to clear the ghosting
+void pushPage(const GfxRenderer& renderer, int& pagesUntilFullRefresh);
+
+#if defined(PLATFORM_M5PAPER)
+// The panel takes 16 gray levels natively, so the anti-aliased page drawn by drawPage goes straight into the 4bpp
+// buffer and is pushed once, instead of a BW pass plus LSB/MSB passes. Leaves the renderer in BW mode.
+void renderGray4Page(GfxRenderer& renderer, int& pagesUntilFullRefresh, const std::function<void()>& drawPage);
+#endif
+}  // namespace ReaderDisplay
@@ -0,0 +1,57 @@
+#include "ReaderWorker.h"
+
+ReaderWorker::~ReaderWorker() {
+  join();
+  if (exited) {
+    vSemaphoreDelete(exited);
+  }
+}
+
+void ReaderWorker::trampoline(void* param) {
+  auto* self = static_cast<ReaderWorker*>(param);
+  self->body();
+  // The owner may be gone as soon as exited is given, nothing of it is touched afterwards
+  xSemaphoreGive(self->exited);
+  vTaskDelete(nullptr);
+}
+
+bool ReaderWorker::start(const char* name, const uint32_t stackSize, std::function<void()> taskBody) {
+  join();
+  if (!exited) {
+    exited = xSemaphoreCreateBinary();
+    if (!exited) {
+      return false;
+    }
+  }
+
+  body = std::move(taskBody);
+  stopFlag = false;
+  xTaskCreatePinnedToCore(&ReaderWorker::trampoline, name,
+                          stackSize,         // Stack size
+                          this,              // Parameters
+                          tskIDLE_PRIORITY,  // Priority
+                          &handle,           // Task handle
+                          portNUM_PROCESSORS > 1 ? 1 - xPortGetCoreID() : 0);
+  return handle != nullptr;
+}
+
+void ReaderWorker::notify() const {
+  if (handle) {
+    xTaskNotifyGive(handle);
+  }
+}
+
+void ReaderWorker::requestStop() {
+  stopFlag = true;
+  notify();
+}
+
+void ReaderWorker::join() {
+  if (!handle) {
+    return;
+  }
+
+  xSemaphoreTake(exited, portMAX_DELAY);
+  handle = nullptr;
+  body = nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <functional>
+
+// Background task a reader runs behind the page on screen (section look-ahead, page prefetch, page indexing). It
+// stays below the UI and on whichever core the UI loop is not using.
+// The body runs until it returns, either on its own or after requestStop(); join() waits for that on a semaphore the
+// task gives on its way out.
+class ReaderWorker {
+  TaskHandle_t handle = nullptr;
+  SemaphoreHandle_t exited = nullptr;
+  std::function<void()> body;
+  std::atomic<bool> stopFlag{false};
+
+  static void trampoline(void* param);
+
+ public:
+  ReaderWorker() = default;
+  ReaderWorker(const ReaderWorker&) = delete;
+  ReaderWorker& operator=(const ReaderWorker&) = delete;
+  ~ReaderWorker();
+
+  // False when the task could not be created
+  bool start(const char* name, uint32_t stackSize, std::function<void()> taskBody);
+  // Until join(), even when the body already returned
+  bool isStarted() const { return handle != nullptr; }
+  bool stopRequested() const { return stopFlag; }
+  // Wakes a body blocked in ulTaskNotifyTake()
+  void notify() const;
+  // Caller holds whatever guards the state the body checks between steps
+  void requestStop();
+  // Returns once the body has returned; caller must not hold anything the body needs to get there
+  void join();
+};
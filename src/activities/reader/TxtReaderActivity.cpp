@@ -3,12 +3,16 @@
 #include <GfxRenderer.h>
 #include <SDCardManager.h>
 #include <Serialization.h>
+#include <Trace.h>
 #include <Utf8.h>
 
+#include <algorithm>
+
 #include "../apps/PaperS3Ui.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "MappedInputManager.h"
+#include "ReaderDisplay.h"
 #include "RecentBooksStore.h"
 #include "ScreenComponents.h"
 #include "fontIds.h"
@@ -17,11 +21,15 @@ namespace {
 constexpr unsigned long goHomeMs = 1000;
 constexpr int statusBarMargin = 25;
 constexpr int progressBarMarginTop = 1;
-constexpr size_t CHUNK_SIZE = 8 * 1024;  // 8KB chunk for reading
 
 // Cache file magic and version
 constexpr uint32_t CACHE_MAGIC = 0x54585449;  // "TXTI"
-constexpr uint8_t CACHE_VERSION = 2;          // Increment when cache format changes
+constexpr uint8_t CACHE_VERSION = 4;          // Increment when cache format changes
+
+// Pages laid out per hold of renderingMutex, and how many new pages the index task collects before writing the
+// partial index out, so indexing resumes where it stopped after sleep
+constexpr int INDEX_BATCH_PAGES = 8;
+constexpr size_t INDEX_CHECKPOINT_PAGES = 256;
 
 void drawPaperS3ReaderChrome(GfxRenderer& renderer) {
 #if defined(PLATFORM_M5PAPERS3)
@@ -98,6 +106,8 @@ void TxtReaderActivity::onExit() {
   // Reset orientation back to portrait for the rest of the UI
   renderer.setOrientation(GfxRenderer::Orientation::Portrait);
 
+  stopIndexing();
+
   if (renderingMutex) {
     xSemaphoreTake(renderingMutex, portMAX_DELAY);
     if (displayTaskHandle) {
@@ -107,8 +117,9 @@ void TxtReaderActivity::onExit() {
     vSemaphoreDelete(renderingMutex);
     renderingMutex = nullptr;
   }
-  pageOffsets.clear();
+  pageIndex.reset();
   currentPageLines.clear();
+  layout.reset();
   txt.reset();
 }
 
@@ -174,11 +185,12 @@ void TxtReaderActivity::loop() {
     return;
   }
 
-  if (prevTriggered && currentPage > 0) {
-    currentPage--;
+  // The render resolves where the turn lands, the previous page may have to wait for the index
+  if (prevTriggered && initialized && currentOffset > 0) {
+    pendingPageTurn = -1;
     updateRequired = true;
-  } else if (nextTriggered && currentPage < totalPages - 1) {
-    currentPage++;
+  } else if (nextTriggered && initialized && currentNextOffset < txt->getFileSize()) {
+    pendingPageTurn = 1;
     updateRequired = true;
   }
 
@@ -247,13 +259,14 @@ void TxtReaderActivity::initializeReader() {
 
   Serial.printf("[%lu] [TRS] Viewport: %dx%d, lines per page: %d\n", millis(), viewportWidth, viewportHeight,
                 linesPerPage);
+  layout.reset(new TxtLayout(*txt, renderer, cachedFontId, viewportWidth, linesPerPage));
 
-  // Try to load cached page index first
+  // A partial index left by an earlier visit is a checkpoint, the index task carries on from its last page
   if (!loadPageIndexCache()) {
-    // Cache not found, build page index
-    buildPageIndex();
-    // Save to cache for next time
-    savePageIndexCache();
+    pageIndex.reset();
+  }
+  if (!pageIndex.isComplete()) {
+    startIndexing();
   }
 
   // Load saved progress
@@ -262,172 +275,137 @@ void TxtReaderActivity::initializeReader() {
   initialized = true;
 }
 
-void TxtReaderActivity::buildPageIndex() {
-  pageOffsets.clear();
-  pageOffsets.push_back(0);  // First page starts at offset 0
-
-  size_t offset = 0;
-  const size_t fileSize = txt->getFileSize();
-
-  Serial.printf("[%lu] [TRS] Building page index for %zu bytes...\n", millis(), fileSize);
+// Caller holds renderingMutex
+void TxtReaderActivity::startIndexing() {
+  if (!indexWorker.start("TxtIndexTask", 6144, [this] { indexTaskLoop(); })) {
+    Serial.printf("[%lu] [TRS] Failed to start the index task, indexing on demand\n", millis());
+  }
+}
 
-  ScreenComponents::drawPopup(renderer, "Indexing...");
+// Caller must not hold renderingMutex; returns once the index task has saved its checkpoint and exited
+void TxtReaderActivity::stopIndexing() {
+  if (!renderingMutex) {
+    return;
+  }
 
-  while (offset < fileSize) {
-    std::vector<std::string> tempLines;
-    size_t nextOffset = offset;
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  indexWorker.requestStop();
+  xSemaphoreGive(renderingMutex);
+  indexWorker.join();
+}
 
-    if (!loadPageAtOffset(offset, tempLines, nextOffset)) {
-      break;
-    }
+void TxtReaderActivity::indexTaskLoop() {
+  {
+    TRACE_SCOPE("txt", "index_build");
+    // A layout of its own, the reader's layout reuses one chunk buffer for every page it renders
+    const TxtLayout indexLayout(*txt, renderer, cachedFontId, viewportWidth, linesPerPage);
+    const auto start = millis();
+    size_t uncheckpointedPages = 0;
 
-    if (nextOffset <= offset) {
-      // No progress made, avoid infinite loop
-      break;
-    }
+    xSemaphoreTake(renderingMutex, portMAX_DELAY);
+    Serial.printf("[%lu] [TRS] Indexing %zu bytes from page %zu\n", millis(), txt->getFileSize(),
+                  pageIndex.getPageCount());
+    while (!pageIndex.isComplete() && !indexWorker.stopRequested()) {
+      const size_t indexedPages = pageIndex.getPageCount();
+      pageIndex.extend(indexLayout, INDEX_BATCH_PAGES);
+      uncheckpointedPages += pageIndex.getPageCount() - indexedPages;
+      if (pageIndex.hasFailed()) {
+        // Not the end of the book: keep what was indexed as a partial index, the next visit carries on from it
+        Serial.printf("[%lu] [TRS] Indexing stopped at page %zu, the file could not be read\n", millis(),
+                      pageIndex.getPageCount());
+        break;
+      }
+      if (pageIndex.isComplete() || uncheckpointedPages >= INDEX_CHECKPOINT_PAGES) {
+        savePageIndexCache();
+        uncheckpointedPages = 0;
+      }
 
-    offset = nextOffset;
-    if (offset < fileSize) {
-      pageOffsets.push_back(offset);
+      // Hand the mutex back between batches so page turns never wait on the index
+      xSemaphoreGive(renderingMutex);
+      vTaskDelay(1);
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
     }
 
-    // Yield to other tasks periodically
-    if (pageOffsets.size() % 20 == 0) {
-      vTaskDelay(1);
+    if (pageIndex.isComplete()) {
+      Serial.printf("[%lu] [TRS] Built page index: %zu pages (%zu checkpoints) in %lums\n", millis(),
+                    pageIndex.getPageCount(), pageIndex.getCheckpointCount(), millis() - start);
+      // Redraw so the status bar gets the page count
+      updateRequired = true;
+    } else if (uncheckpointedPages > 0) {
+      savePageIndexCache();
     }
+    xSemaphoreGive(renderingMutex);
   }
-
-  totalPages = pageOffsets.size();
-  Serial.printf("[%lu] [TRS] Built page index: %d pages\n", millis(), totalPages);
 }
 
-bool TxtReaderActivity::loadPageAtOffset(size_t offset, std::vector<std::string>& outLines, size_t& nextOffset) {
-  outLines.clear();
-  const size_t fileSize = txt->getFileSize();
-
-  if (offset >= fileSize) {
-    return false;
-  }
-
-  // Read a chunk from file
-  size_t chunkSize = std::min(CHUNK_SIZE, fileSize - offset);
-  auto* buffer = static_cast<uint8_t*>(malloc(chunkSize + 1));
-  if (!buffer) {
-    Serial.printf("[%lu] [TRS] Failed to allocate %zu bytes\n", millis(), chunkSize);
-    return false;
-  }
-
-  if (!txt->readContent(buffer, offset, chunkSize)) {
-    free(buffer);
-    return false;
+// Caller holds renderingMutex. Hands the mutex to the index task until ready() holds or the index is done, laying
+// pages out here instead when there is no index task.
+void TxtReaderActivity::waitForIndex(const std::function<bool()>& ready) {
+  if (pageIndex.isComplete() || ready()) {
+    return;
   }
-  buffer[chunkSize] = '\0';
 
-  // Parse lines from buffer
-  size_t pos = 0;
-
-  while (pos < chunkSize && static_cast<int>(outLines.size()) < linesPerPage) {
-    // Find end of line
-    size_t lineEnd = pos;
-    while (lineEnd < chunkSize && buffer[lineEnd] != '\n') {
-      lineEnd++;
-    }
-
-    // Check if we have a complete line
-    bool lineComplete = (lineEnd < chunkSize) || (offset + lineEnd >= fileSize);
-
-    if (!lineComplete && static_cast<int>(outLines.size()) > 0) {
-      // Incomplete line and we already have some lines, stop here
+  ScreenComponents::drawPopup(renderer, "Indexing...");
+  while (!pageIndex.isComplete() && !ready()) {
+    if (indexWorker.stopRequested() || pageIndex.hasFailed()) {
       break;
+    } else if (indexWorker.isStarted()) {
+      xSemaphoreGive(renderingMutex);
+      vTaskDelay(20 / portTICK_PERIOD_MS);
+      xSemaphoreTake(renderingMutex, portMAX_DELAY);
+    } else {
+      pageIndex.extend(*layout, INDEX_BATCH_PAGES);
     }
+  }
+}
 
-    // Calculate the actual length of line content in the buffer (excluding newline)
-    size_t lineContentLen = lineEnd - pos;
-
-    // Check for carriage return
-    bool hasCR = (lineContentLen > 0 && buffer[pos + lineContentLen - 1] == '\r');
-    size_t displayLen = hasCR ? lineContentLen - 1 : lineContentLen;
-
-    // Extract line content for display (without CR/LF)
-    std::string line(reinterpret_cast<char*>(buffer + pos), displayLen);
-
-    // Track position within this source line (in bytes from pos)
-    size_t lineBytePos = 0;
-
-    // Word wrap if needed
-    while (!line.empty() && static_cast<int>(outLines.size()) < linesPerPage) {
-      int lineWidth = renderer.getTextWidth(cachedFontId, line.c_str());
+// Caller holds renderingMutex
+void TxtReaderActivity::applyPendingPageTurn() {
+  const int turn = pendingPageTurn;
+  pendingPageTurn = 0;
 
-      if (lineWidth <= viewportWidth) {
-        outLines.push_back(line);
-        lineBytePos = displayLen;  // Consumed entire display content
-        line.clear();
-        break;
-      }
-
-      // Find break point
-      size_t breakPos = line.length();
-      while (breakPos > 0 && renderer.getTextWidth(cachedFontId, line.substr(0, breakPos).c_str()) > viewportWidth) {
-        // Try to break at space
-        size_t spacePos = line.rfind(' ', breakPos - 1);
-        if (spacePos != std::string::npos && spacePos > 0) {
-          breakPos = spacePos;
-        } else {
-          // Break at character boundary for UTF-8
-          breakPos--;
-          // Make sure we don't break in the middle of a UTF-8 sequence
-          while (breakPos > 0 && (line[breakPos] & 0xC0) == 0x80) {
-            breakPos--;
-          }
-        }
-      }
-
-      if (breakPos == 0) {
-        breakPos = 1;
+  if (turn > 0 && currentNextOffset > currentOffset && currentNextOffset < txt->getFileSize()) {
+    // The next page is wherever this one ends, indexed or not
+    currentOffset = currentNextOffset;
+    if (currentPage >= 0) {
+      currentPage++;
+    }
+  } else if (turn < 0 && currentOffset > 0) {
+    size_t page;
+    size_t pageOffset;
+    if (pageIndex.isComplete() || pageIndex.getLastPageOffset() >= currentOffset) {
+      // The previous page is the last indexed one starting before this one
+      if (pageIndex.findPage(*layout, currentOffset - 1, page, pageOffset)) {
+        currentPage = static_cast<int>(page);
+        currentOffset = pageOffset;
       }
-
-      outLines.push_back(line.substr(0, breakPos));
-
-      // Skip space at break point
-      size_t skipChars = breakPos;
-      if (breakPos < line.length() && line[breakPos] == ' ') {
-        skipChars++;
+    } else if (layout->previousPageStart(currentOffset, pageOffset)) {
+      // Ahead of the index (opened at a saved position), lay the previous page out here instead of waiting for it
+      currentOffset = pageOffset;
+      if (currentPage > 0) {
+        currentPage--;
       }
-      lineBytePos += skipChars;
-      line = line.substr(skipChars);
-    }
-
-    // Determine how much of the source buffer we consumed
-    if (line.empty()) {
-      // Fully consumed this source line, move past the newline
-      pos = lineEnd + 1;
-    } else {
-      // Partially consumed - page is full mid-line
-      // Move pos to where we stopped in the line (NOT past the line)
-      pos = pos + lineBytePos;
-      break;
     }
   }
+}
 
-  // Ensure we make progress even if calculations go wrong
-  if (pos == 0 && !outLines.empty()) {
-    // Fallback: at minimum, consume something to avoid infinite loop
-    pos = 1;
+// Caller holds renderingMutex. Numbers the page on screen once the index has got that far. A page that is no page
+// start in this layout (a saved position from other fonts or margins, or a page laid out backward ahead of the index)
+// takes the number of the indexed page it starts in but stays where it is, so the text never moves under the reader.
+void TxtReaderActivity::resolveCurrentPage() {
+  if (currentPage >= 0 || (!pageIndex.isComplete() && pageIndex.getLastPageOffset() < currentOffset)) {
+    return;
   }
 
-  nextOffset = offset + pos;
-
-  // Make sure we don't go past the file
-  if (nextOffset > fileSize) {
-    nextOffset = fileSize;
+  size_t page;
+  size_t pageOffset;
+  if (pageIndex.findPage(*layout, currentOffset, page, pageOffset)) {
+    currentPage = static_cast<int>(page);
   }
-
-  free(buffer);
-
-  return !outLines.empty();
 }
 
 void TxtReaderActivity::renderScreen() {
+  TRACE_SCOPE("reader", "txt_page");
   if (!txt) {
     return;
   }
@@ -437,7 +415,7 @@ void TxtReaderActivity::renderScreen() {
     initializeReader();
   }
 
-  if (pageOffsets.empty()) {
+  if (txt->getFileSize() == 0) {
     renderer.clearScreen();
     renderer.drawCenteredText(UI_12_FONT_ID, 300, "Empty file", true, EpdFontFamily::BOLD);
     drawPaperS3ReaderChrome(renderer);
@@ -445,15 +423,14 @@ void TxtReaderActivity::renderScreen() {
     return;
   }
 
-  // Bounds check
-  if (currentPage < 0) currentPage = 0;
-  if (currentPage >= totalPages) currentPage = totalPages - 1;
+  applyPendingPageTurn();
+  resolveCurrentPage();
 
   // Load current page content
-  size_t offset = pageOffsets[currentPage];
-  size_t nextOffset;
   currentPageLines.clear();
-  loadPageAtOffset(offset, currentPageLines, nextOffset);
+  if (!layout->layoutPage(currentOffset, currentPageLines, currentNextOffset)) {
+    currentNextOffset = txt->getFileSize();
+  }
 
   renderer.clearScreen();
   renderPage();
@@ -513,18 +490,22 @@ void TxtReaderActivity::renderPage() {
     }
   };
 
+#if defined(PLATFORM_M5PAPER)
+  if (SETTINGS.textAntiAliasing) {
+    ReaderDisplay::renderGray4Page(renderer, pagesUntilFullRefresh, [&] {
+      renderLines();
+      renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
+      drawPaperS3ReaderChrome(renderer);
+    });
+    return;
+  }
+#endif
+
   // First pass: BW rendering
   renderLines();
   renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
   drawPaperS3ReaderChrome(renderer);
-
-  if (pagesUntilFullRefresh <= 1) {
-    renderer.displayBuffer(HalDisplay::HALF_REFRESH);
-    pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
-  } else {
-    renderer.displayBuffer();
-    pagesUntilFullRefresh--;
-  }
+  ReaderDisplay::pushPage(renderer, pagesUntilFullRefresh);
 
   // Grayscale rendering pass (for anti-aliased fonts)
   if (SETTINGS.textAntiAliasing) {
@@ -569,11 +550,25 @@ void TxtReaderActivity::renderStatusBar(const int orientedMarginRight, const int
   const auto textY = screenHeight - orientedMarginBottom - 4;
   int progressTextWidth = 0;
 
-  const float progress = totalPages > 0 ? (currentPage + 1) * 100.0f / totalPages : 0;
+  // Until the index is done there is no page count, progress goes by how far into the file the page starts
+  const int totalPages = static_cast<int>(pageIndex.getPageCount());
+  const size_t fileSize = txt->getFileSize();
+  const bool pageCountKnown = pageIndex.isComplete() && currentPage >= 0;
+  const float progress = pageCountKnown ? (currentPage + 1) * 100.0f / totalPages
+                         : fileSize > 0 ? currentOffset * 100.0f / fileSize
+                                        : 0;
 
   if (showProgressText || showProgressPercentage) {
     char progressStr[32];
-    if (showProgressPercentage) {
+    if (currentPage < 0) {
+      snprintf(progressStr, sizeof(progressStr), "%.0f%%", progress);
+    } else if (!pageCountKnown) {
+      if (showProgressPercentage) {
+        snprintf(progressStr, sizeof(progressStr), "%d/... %.0f%%", currentPage + 1, progress);
+      } else {
+        snprintf(progressStr, sizeof(progressStr), "%d/...", currentPage + 1);
+      }
+    } else if (showProgressPercentage) {
       snprintf(progressStr, sizeof(progressStr), "%d/%d %.0f%%", currentPage + 1, totalPages, progress);
     } else {
       snprintf(progressStr, sizeof(progressStr), "%d/%d", currentPage + 1, totalPages);
@@ -614,32 +609,54 @@ void TxtReaderActivity::renderStatusBar(const int orientedMarginRight, const int
 void TxtReaderActivity::saveProgress() const {
   FsFile f;
   if (SdMan.openFileForWrite("TRS", txt->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    data[0] = currentPage & 0xFF;
-    data[1] = (currentPage >> 8) & 0xFF;
+    // Page number (0 when not known yet), 2 reserved bytes, then the byte offset the page starts at
+    const int page = std::max(currentPage, 0);
+    uint8_t data[8];
+    data[0] = page & 0xFF;
+    data[1] = (page >> 8) & 0xFF;
     data[2] = 0;
     data[3] = 0;
-    f.write(data, 4);
+    data[4] = currentOffset & 0xFF;
+    data[5] = (currentOffset >> 8) & 0xFF;
+    data[6] = (currentOffset >> 16) & 0xFF;
+    data[7] = (currentOffset >> 24) & 0xFF;
+    f.write(data, 8);
     f.close();
   }
 }
 
+// Caller holds renderingMutex
 void TxtReaderActivity::loadProgress() {
   FsFile f;
-  if (SdMan.openFileForRead("TRS", txt->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
-      currentPage = data[0] + (data[1] << 8);
-      if (currentPage >= totalPages) {
-        currentPage = totalPages - 1;
-      }
-      if (currentPage < 0) {
-        currentPage = 0;
-      }
-      Serial.printf("[%lu] [TRS] Loaded progress: page %d/%d\n", millis(), currentPage, totalPages);
+  if (!SdMan.openFileForRead("TRS", txt->getCachePath() + "/progress.bin", f)) {
+    return;
+  }
+  uint8_t data[8];
+  const int dataSize = f.read(data, 8);
+  f.close();
+
+  if (dataSize == 8) {
+    const size_t savedOffset = data[4] | (data[5] << 8) | (data[6] << 16) | (static_cast<uint32_t>(data[7]) << 24);
+    if (savedOffset >= txt->getFileSize()) {
+      return;
     }
-    f.close();
+    // Open at the saved offset straight away, the page number follows once the index reaches it
+    currentOffset = savedOffset;
+    currentPage = -1;
+    resolveCurrentPage();
+  } else if (dataSize == 4) {
+    // Saved before progress had offsets, the index has to get to the page first
+    const int savedPage = data[0] + (data[1] << 8);
+    waitForIndex([this, savedPage] { return static_cast<int>(pageIndex.getPageCount()) > savedPage; });
+    currentPage = std::min(savedPage, static_cast<int>(pageIndex.getPageCount()) - 1);
+    if (!pageIndex.getPageOffset(*layout, currentPage, currentOffset)) {
+      currentPage = 0;
+      currentOffset = 0;
+    }
+  } else {
+    return;
   }
+  Serial.printf("[%lu] [TRS] Loaded progress: page %d at offset %zu\n", millis(), currentPage, currentOffset);
 }
 
 bool TxtReaderActivity::loadPageIndexCache() {
@@ -652,8 +669,8 @@ bool TxtReaderActivity::loadPageIndexCache() {
   // - int32_t: font ID (to invalidate cache on font change)
   // - int32_t: screen margin (to invalidate cache on margin change)
   // - uint8_t: paragraph alignment (to invalidate cache on alignment change)
-  // - uint32_t: total pages count
-  // - N * uint32_t: page offsets
+  // - TxtPageIndex: whether it covers the whole file (else the index task resumes from it), page count, stride, last
+  //   page offset, then the offset of every stride-th page
 
   std::string cachePath = txt->getCachePath() + "/index.bin";
   FsFile f;
@@ -727,22 +744,15 @@ bool TxtReaderActivity::loadPageIndexCache() {
     return false;
   }
 
-  uint32_t numPages;
-  serialization::readPod(f, numPages);
-
-  // Read page offsets
-  pageOffsets.clear();
-  pageOffsets.reserve(numPages);
-
-  for (uint32_t i = 0; i < numPages; i++) {
-    uint32_t offset;
-    serialization::readPod(f, offset);
-    pageOffsets.push_back(offset);
+  if (!pageIndex.deserialize(f)) {
+    Serial.printf("[%lu] [TRS] Cache page index truncated, rebuilding\n", millis());
+    f.close();
+    return false;
   }
 
   f.close();
-  totalPages = pageOffsets.size();
-  Serial.printf("[%lu] [TRS] Loaded page index cache: %d pages\n", millis(), totalPages);
+  Serial.printf("[%lu] [TRS] Loaded page index cache: %zu pages%s, stride %u\n", millis(), pageIndex.getPageCount(),
+                pageIndex.isComplete() ? "" : " so far", static_cast<unsigned>(pageIndex.getStride()));
   return true;
 }
 
@@ -763,13 +773,9 @@ void TxtReaderActivity::savePageIndexCache() const {
   serialization::writePod(f, static_cast<int32_t>(cachedFontId));
   serialization::writePod(f, static_cast<int32_t>(cachedScreenMargin));
   serialization::writePod(f, cachedParagraphAlignment);
-  serialization::writePod(f, static_cast<uint32_t>(pageOffsets.size()));
-
-  // Write page offsets
-  for (size_t offset : pageOffsets) {
-    serialization::writePod(f, static_cast<uint32_t>(offset));
-  }
+  pageIndex.serialize(f);
 
   f.close();
-  Serial.printf("[%lu] [TRS] Saved page index cache: %d pages\n", millis(), totalPages);
+  Serial.printf("[%lu] [TRS] Saved page index cache: %zu pages in %zu checkpoints\n", millis(),
+                pageIndex.getPageCount(), pageIndex.getCheckpointCount());
 }
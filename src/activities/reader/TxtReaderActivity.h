@@ -1,29 +1,41 @@
 #pragma once
 
 #include <Txt.h>
+#include <TxtLayout.h>
+#include <TxtPageIndex.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <functional>
 #include <vector>
 
 #include "CrossPointSettings.h"
+#include "ReaderWorker.h"
 #include "activities/ActivityWithSubactivity.h"
 
 class TxtReaderActivity final : public ActivityWithSubactivity {
   std::unique_ptr<Txt> txt;
+  // Wraps the text into pages, created once the viewport is known
+  std::unique_ptr<TxtLayout> layout;
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
+  // The page on screen is the one starting at currentOffset. currentPage is its number, -1 until the index gets far
+  // enough to tell (when the saved position is ahead of it).
+  size_t currentOffset = 0;
+  size_t currentNextOffset = 0;  // Where the page after the one on screen starts
   int currentPage = 0;
-  int totalPages = 1;
+  int pendingPageTurn = 0;  // +1/-1 from loop(), applied by the next render
   int pagesUntilFullRefresh = 0;
   bool updateRequired = false;
   unsigned long lastOverlayRefreshMs = 0;
   const std::function<void()> onGoBack;
   const std::function<void()> onGoHome;
 
-  // Streaming text reader - stores file offsets for each page
-  std::vector<size_t> pageOffsets;  // File offset for start of each page
+  // Streaming text reader - pages are addressed by the file offset they start at. Grown by the index task while
+  // reading, guarded by renderingMutex.
+  TxtPageIndex pageIndex;
+  ReaderWorker indexWorker;
   std::vector<std::string> currentPageLines;
   int linesPerPage = 0;
   int viewportWidth = 0;
@@ -42,8 +54,12 @@ class TxtReaderActivity final : public ActivityWithSubactivity {
   void renderStatusBar(int orientedMarginRight, int orientedMarginBottom, int orientedMarginLeft) const;
 
   void initializeReader();
-  bool loadPageAtOffset(size_t offset, std::vector<std::string>& outLines, size_t& nextOffset);
-  void buildPageIndex();
+  void indexTaskLoop();
+  void startIndexing();
+  void stopIndexing();
+  void waitForIndex(const std::function<bool()>& ready);
+  void applyPendingPageTurn();
+  void resolveCurrentPage();
   bool loadPageIndexCache();
   void savePageIndexCache() const;
   void saveProgress() const;
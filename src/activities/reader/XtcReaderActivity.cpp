@@ -9,7 +9,9 @@
 
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
+#include <MemTrack.h>
 #include <SDCardManager.h>
+#include <Trace.h>
 
 #include "../apps/PaperS3Ui.h"
 #include "CrossPointSettings.h"
@@ -23,6 +25,13 @@ namespace {
 constexpr unsigned long skipPageMs = 700;
 constexpr unsigned long goHomeMs = 1000;
 
+// XTG (1-bit): Row-major, ((width+7)/8) * height bytes
+// XTH (2-bit): Two bit planes, column-major, ((width * height + 7) / 8) * 2 bytes
+// Compressed pages are stored only when smaller, so this fits any page as stored too
+size_t getPageBufferSize(const Xtc& xtc) {
+  return xtc::PageBands::getBitmapSize(xtc.getPageWidth(), xtc.getPageHeight(), xtc.getBitDepth());
+}
+
 void drawPaperS3ReaderChrome(GfxRenderer& renderer) {
 #if defined(PLATFORM_M5PAPERS3)
   PaperS3Ui::drawBackButton(renderer, "Library");
@@ -56,6 +65,8 @@ void XtcReaderActivity::onEnter() {
   // Load saved progress
   loadProgress();
 
+  startPrefetch();
+
   // Save current XTC as last opened book and add to recent books
   APP_STATE.openEpubPath = xtc->getPath();
   APP_STATE.saveToFile();
@@ -88,6 +99,7 @@ void XtcReaderActivity::onExit() {
     vSemaphoreDelete(renderingMutex);
     renderingMutex = nullptr;
   }
+  stopPrefetch();
   xtc.reset();
 }
 
@@ -133,6 +145,7 @@ void XtcReaderActivity::loop() {
           },
           [this](const uint32_t newPage) {
             currentPage = newPage;
+            lastTurnBackward = false;
             exitActivity();
             updateRequired = true;
           }));
@@ -183,6 +196,7 @@ void XtcReaderActivity::loop() {
   const bool skipPages = SETTINGS.longPressChapterSkip && mappedInput.getHeldTime() > skipPageMs;
   const int skipAmount = skipPages ? 10 : 1;
 
+  lastTurnBackward = prevTriggered;
   if (prevTriggered) {
     if (currentPage >= static_cast<uint32_t>(skipAmount)) {
       currentPage -= skipAmount;
@@ -227,6 +241,7 @@ void XtcReaderActivity::renderIfNeeded() {
 }
 
 void XtcReaderActivity::renderScreen() {
+  TRACE_SCOPE("reader", "xtc_page");
   if (!xtc) {
     return;
   }
@@ -250,32 +265,30 @@ void XtcReaderActivity::renderPage() {
   const uint16_t pageHeight = xtc->getPageHeight();
   const uint8_t bitDepth = xtc->getBitDepth();
 
-  // Calculate buffer size for one page
-  // XTG (1-bit): Row-major, ((width+7)/8) * height bytes
-  // XTH (2-bit): Two bit planes, column-major, ((width * height + 7) / 8) * 2 bytes
-  size_t pageBufferSize;
-  if (bitDepth == 2) {
-    pageBufferSize = ((static_cast<size_t>(pageWidth) * pageHeight + 7) / 8) * 2;
+  // Take the page from the prefetch ring, or read it into a buffer of its own when there is no ring
+  size_t bytesRead = 0;
+  uint8_t compression = xtc::COMPRESSION_NONE;
+  uint8_t* ownedBuffer = nullptr;
+  const uint8_t* pageBuffer = nullptr;
+  if (prefetchMemory) {
+    pageBuffer = acquirePage(currentPage, &bytesRead, &compression);
   } else {
-    pageBufferSize = ((pageWidth + 7) / 8) * pageHeight;
-  }
-
-  // Allocate page buffer
-  uint8_t* pageBuffer = static_cast<uint8_t*>(malloc(pageBufferSize));
-  if (!pageBuffer) {
-    Serial.printf("[%lu] [XTR] Failed to allocate page buffer (%lu bytes)\n", millis(), pageBufferSize);
-    renderer.clearScreen();
-    renderer.drawCenteredText(UI_12_FONT_ID, 300, "Memory error", true, EpdFontFamily::BOLD);
-    drawPaperS3ReaderChrome(renderer);
-    renderer.displayBuffer();
-    return;
+    ownedBuffer = static_cast<uint8_t*>(malloc(pageBufferSize));
+    if (!ownedBuffer) {
+      Serial.printf("[%lu] [XTR] Failed to allocate page buffer (%lu bytes)\n", millis(), pageBufferSize);
+      renderer.clearScreen();
+      renderer.drawCenteredText(UI_12_FONT_ID, 300, "Memory error", true, EpdFontFamily::BOLD);
+      drawPaperS3ReaderChrome(renderer);
+      renderer.displayBuffer();
+      return;
+    }
+    bytesRead = xtc->loadPagePayload(currentPage, ownedBuffer, pageBufferSize, compression);
+    pageBuffer = ownedBuffer;
   }
 
-  // Load page data
-  size_t bytesRead = xtc->loadPage(currentPage, pageBuffer, pageBufferSize);
   if (bytesRead == 0) {
     Serial.printf("[%lu] [XTR] Failed to load page %lu\n", millis(), currentPage);
-    free(pageBuffer);
+    free(ownedBuffer);
     renderer.clearScreen();
     renderer.drawCenteredText(UI_12_FONT_ID, 300, "Page load error", true, EpdFontFamily::BOLD);
     drawPaperS3ReaderChrome(renderer);
@@ -286,9 +299,33 @@ void XtcReaderActivity::renderPage() {
   // Clear screen first
   renderer.clearScreen();
 
-  // Copy page bitmap using GfxRenderer's drawPixel
+  // Blit the page bitmap straight into the framebuffer, a band at a time. Compressed pages are decoded band by band
+  // as they are drawn, an uncompressed page is a single band.
   // XTC/XTCH pages are pre-rendered with status bar included, so render full page
-  const uint16_t maxSrcY = pageHeight;
+  // pixelCounts (XTH only) tallies the pixel distribution along the way
+  const auto drawPage = [&](const uint8_t selectedValues, const bool state, uint32_t* pixelCounts) {
+    xtc::PageBands bands(pageBuffer, bytesRead, compression, pageWidth, pageHeight, bitDepth);
+    xtc::PageBand band;
+    while (bands.next(band)) {
+      if (bitDepth != 2) {
+        renderer.drawPackedRows(band.data, band.x, band.y, band.width, band.height, true, true);
+        continue;
+      }
+      renderer.drawPackedColumnPlanes(band.data, band.plane2, band.x, band.y, band.width, band.height, selectedValues,
+                                      state);
+      if (pixelCounts) {
+        const size_t bandBytes = (static_cast<size_t>(band.width) * band.height + 7) / 8;
+        for (size_t i = 0; i < bandBytes; i++) {
+          pixelCounts[1] += __builtin_popcount(~band.data[i] & band.plane2[i] & 0xFF);
+          pixelCounts[2] += __builtin_popcount(band.data[i] & ~band.plane2[i] & 0xFF);
+          pixelCounts[3] += __builtin_popcount(band.data[i] & band.plane2[i]);
+        }
+      }
+    }
+    if (bands.failed()) {
+      Serial.printf("[%lu] [XTR] Page %lu data is corrupt, drew what there was\n", millis(), currentPage);
+    }
+  };
 
   if (bitDepth == 2) {
     // XTH 2-bit mode: Two bit planes, column-major order
@@ -298,44 +335,21 @@ void XtcReaderActivity::renderPage() {
     // - Pixel value = (bit1 << 1) | bit2
     // - Grayscale: 0=White, 1=Dark Grey, 2=Light Grey, 3=Black
 
-    const size_t planeSize = (static_cast<size_t>(pageWidth) * pageHeight + 7) / 8;
-    const uint8_t* plane1 = pageBuffer;              // Bit1 plane
-    const uint8_t* plane2 = pageBuffer + planeSize;  // Bit2 plane
-    const size_t colBytes = (pageHeight + 7) / 8;    // Bytes per column (100 for 800 height)
-
-    // Lambda to get pixel value at (x, y)
-    auto getPixelValue = [&](uint16_t x, uint16_t y) -> uint8_t {
-      const size_t colIndex = pageWidth - 1 - x;
-      const size_t byteInCol = y / 8;
-      const size_t bitInByte = 7 - (y % 8);
-      const size_t byteOffset = colIndex * colBytes + byteInCol;
-      const uint8_t bit1 = (plane1[byteOffset] >> bitInByte) & 1;
-      const uint8_t bit2 = (plane2[byteOffset] >> bitInByte) & 1;
-      return (bit1 << 1) | bit2;
-    };
+    // Pixel values selected by each pass, bit v set to draw value v
+    constexpr uint8_t NON_WHITE = 0b1110;
+    constexpr uint8_t DARK_GREY = 0b0010;
+    constexpr uint8_t ANY_GREY = 0b0110;
 
     // Optimized grayscale rendering without storeBwBuffer (saves 48KB peak memory)
     // Flow: BW display → LSB/MSB passes → grayscale display → re-render BW for next frame
 
-    // Count pixel distribution for debugging
+    // Pass 1: BW buffer - draw all non-white pixels as black, counting pixel distribution for debugging on the way
     uint32_t pixelCounts[4] = {0, 0, 0, 0};
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        pixelCounts[getPixelValue(x, y)]++;
-      }
-    }
+    drawPage(NON_WHITE, true, pixelCounts);
+    pixelCounts[0] = static_cast<uint32_t>(pageWidth) * pageHeight - pixelCounts[1] - pixelCounts[2] - pixelCounts[3];
     Serial.printf("[%lu] [XTR] Pixel distribution: White=%lu, DarkGrey=%lu, LightGrey=%lu, Black=%lu\n", millis(),
                   pixelCounts[0], pixelCounts[1], pixelCounts[2], pixelCounts[3]);
 
-    // Pass 1: BW buffer - draw all non-white pixels as black
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        if (getPixelValue(x, y) >= 1) {
-          renderer.drawPixel(x, y, true);
-        }
-      }
-    }
-
     // Display BW with conditional refresh based on pagesUntilFullRefresh
     drawPaperS3ReaderChrome(renderer);
     if (pagesUntilFullRefresh <= 1) {
@@ -349,26 +363,13 @@ void XtcReaderActivity::renderPage() {
     // Pass 2: LSB buffer - mark DARK gray only (XTH value 1)
     // In LUT: 0 bit = apply gray effect, 1 bit = untouched
     renderer.clearScreen(0x00);
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        if (getPixelValue(x, y) == 1) {  // Dark grey only
-          renderer.drawPixel(x, y, false);
-        }
-      }
-    }
+    drawPage(DARK_GREY, false, nullptr);
     renderer.copyGrayscaleLsbBuffers();
 
     // Pass 3: MSB buffer - mark LIGHT AND DARK gray (XTH value 1 or 2)
     // In LUT: 0 bit = apply gray effect, 1 bit = untouched
     renderer.clearScreen(0x00);
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        const uint8_t pv = getPixelValue(x, y);
-        if (pv == 1 || pv == 2) {  // Dark grey or Light grey
-          renderer.drawPixel(x, y, false);
-        }
-      }
-    }
+    drawPage(ANY_GREY, false, nullptr);
     renderer.copyGrayscaleMsbBuffers();
 
     // Display grayscale overlay
@@ -376,44 +377,23 @@ void XtcReaderActivity::renderPage() {
 
     // Pass 4: Re-render BW to framebuffer (restore for next frame, instead of restoreBwBuffer)
     renderer.clearScreen();
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        if (getPixelValue(x, y) >= 1) {
-          renderer.drawPixel(x, y, true);
-        }
-      }
-    }
+    drawPage(NON_WHITE, true, nullptr);
 
     // Cleanup grayscale buffers with current frame buffer
     renderer.cleanupGrayscaleWithFrameBuffer();
 
-    free(pageBuffer);
+    free(ownedBuffer);
 
     Serial.printf("[%lu] [XTR] Rendered page %lu/%lu (2-bit grayscale)\n", millis(), currentPage + 1,
                   xtc->getPageCount());
     return;
   } else {
-    // 1-bit mode: 8 pixels per byte, MSB first
-    const size_t srcRowBytes = (pageWidth + 7) / 8;  // 60 bytes for 480 width
-
-    for (uint16_t srcY = 0; srcY < maxSrcY; srcY++) {
-      const size_t srcRowStart = srcY * srcRowBytes;
-
-      for (uint16_t srcX = 0; srcX < pageWidth; srcX++) {
-        // Read source pixel (MSB first, bit 7 = leftmost pixel)
-        const size_t srcByte = srcRowStart + srcX / 8;
-        const size_t srcBit = 7 - (srcX % 8);
-        const bool isBlack = !((pageBuffer[srcByte] >> srcBit) & 1);  // XTC: 0 = black, 1 = white
-
-        if (isBlack) {
-          renderer.drawPixel(srcX, srcY, true);
-        }
-      }
-    }
+    // 1-bit mode: 8 pixels per byte, MSB first, 0 = black and 1 = white
+    drawPage(0, true, nullptr);
   }
   // White pixels are already cleared by clearScreen()
 
-  free(pageBuffer);
+  free(ownedBuffer);
 
   // XTC pages already have status bar pre-rendered, no need to add our own
 
@@ -432,6 +412,9 @@ void XtcReaderActivity::renderPage() {
 }
 
 void XtcReaderActivity::saveProgress() const {
+  if (pageMutex) {
+    xSemaphoreTake(pageMutex, portMAX_DELAY);
+  }
   FsFile f;
   if (SdMan.openFileForWrite("XTR", xtc->getCachePath() + "/progress.bin", f)) {
     uint8_t data[4];
@@ -442,6 +425,9 @@ void XtcReaderActivity::saveProgress() const {
     f.write(data, 4);
     f.close();
   }
+  if (pageMutex) {
+    xSemaphoreGive(pageMutex);
+  }
 }
 
 void XtcReaderActivity::loadProgress() {
@@ -460,3 +446,148 @@ void XtcReaderActivity::loadProgress() {
     f.close();
   }
 }
+
+void XtcReaderActivity::startPrefetch() {
+  pageBufferSize = getPageBufferSize(*xtc);
+  pageMutex = xSemaphoreCreateMutex();
+
+  // One slot for the page on screen and one on either side of it
+  const size_t ringSize = PREFETCH_SLOTS * pageBufferSize;
+  prefetchMemory = static_cast<uint8_t*>(ps_malloc(ringSize));
+  if (!prefetchMemory) {
+    Serial.printf("[%lu] [XTR] No PSRAM for the page ring (%lu bytes), loading pages on demand\n", millis(),
+                  ringSize);
+    return;
+  }
+  memtrack::charge(memtrack::Tag::XtcPages, ringSize, true);
+  for (int i = 0; i < PREFETCH_SLOTS; i++) {
+    prefetchSlots[i] = PrefetchSlot();
+    prefetchSlots[i].data = prefetchMemory + i * pageBufferSize;
+  }
+  displayedPage = UINT32_MAX;
+
+  if (!prefetchWorker.start("XtcPrefetchTask", 4096, [this] { prefetchTaskLoop(); })) {
+    Serial.printf("[%lu] [XTR] Failed to start the prefetch task, loading pages on demand\n", millis());
+  }
+}
+
+// Caller must not hold pageMutex
+void XtcReaderActivity::stopPrefetch() {
+  if (!pageMutex) {
+    return;
+  }
+
+  xSemaphoreTake(pageMutex, portMAX_DELAY);
+  prefetchWorker.requestStop();
+  xSemaphoreGive(pageMutex);
+  prefetchWorker.join();
+
+  vSemaphoreDelete(pageMutex);
+  pageMutex = nullptr;
+  if (prefetchMemory) {
+    free(prefetchMemory);
+    memtrack::discharge(memtrack::Tag::XtcPages, PREFETCH_SLOTS * pageBufferSize, true);
+    prefetchMemory = nullptr;
+  }
+  for (auto& slot : prefetchSlots) {
+    slot = PrefetchSlot();
+  }
+}
+
+void XtcReaderActivity::prefetchTaskLoop() {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xSemaphoreTake(pageMutex, portMAX_DELAY);
+    if (prefetchWorker.stopRequested()) {
+      xSemaphoreGive(pageMutex);
+      break;
+    }
+
+    // The next page first, that is where the reader is most likely headed, then the previous one when reading back
+    const uint32_t page = displayedPage;
+    const uint32_t targets[] = {page + 1, prefetchBackward && page > 0 ? page - 1 : UINT32_MAX};
+    for (const uint32_t target : targets) {
+      if (page == UINT32_MAX || target >= xtc->getPageCount() || findSlot(target)) {
+        continue;
+      }
+
+      PrefetchSlot* slot = pickFreeSlot();
+      slot->page = UINT32_MAX;
+      {
+        TRACE_SCOPE("xtc", "prefetch");
+        slot->size = xtc->loadPagePayload(target, slot->data, pageBufferSize, slot->compression);
+      }
+      if (slot->size == 0) {
+        Serial.printf("[%lu] [XTR] Prefetching page %lu failed\n", millis(), target);
+        break;
+      }
+      slot->page = target;
+
+      // Let a page turn or a progress save in between the two reads
+      xSemaphoreGive(pageMutex);
+      vTaskDelay(1);
+      xSemaphoreTake(pageMutex, portMAX_DELAY);
+      if (prefetchWorker.stopRequested() || displayedPage != page) {
+        break;
+      }
+    }
+    xSemaphoreGive(pageMutex);
+  }
+}
+
+// Caller holds pageMutex
+XtcReaderActivity::PrefetchSlot* XtcReaderActivity::findSlot(const uint32_t page) {
+  for (auto& slot : prefetchSlots) {
+    if (slot.page == page) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+// Caller holds pageMutex. An empty slot, else the one holding the page farthest from the one on screen, which is
+// never handed out.
+XtcReaderActivity::PrefetchSlot* XtcReaderActivity::pickFreeSlot() {
+  PrefetchSlot* best = nullptr;
+  uint32_t bestDistance = 0;
+  for (auto& slot : prefetchSlots) {
+    if (slot.page == UINT32_MAX) {
+      return &slot;
+    }
+    if (slot.page == displayedPage) {
+      continue;
+    }
+    const uint32_t distance = slot.page > displayedPage ? slot.page - displayedPage : displayedPage - slot.page;
+    if (!best || distance > bestDistance) {
+      best = &slot;
+      bestDistance = distance;
+    }
+  }
+  return best;
+}
+
+// The page's data from the ring as stored (see xtc::PageBands), read now when the prefetcher has not got to it (nullptr
+// if that fails). It stays valid until the next call. Sets the prefetcher off on the pages around it, which it reads
+// while this one is drawn and the panel refreshes.
+const uint8_t* XtcReaderActivity::acquirePage(const uint32_t page, size_t* size, uint8_t* compression) {
+  xSemaphoreTake(pageMutex, portMAX_DELAY);
+  displayedPage = page;
+  PrefetchSlot* slot = findSlot(page);
+  if (slot) {
+    TRACE_INSTANT("xtc", "prefetch_hit");
+  } else {
+    slot = pickFreeSlot();
+    slot->page = UINT32_MAX;
+    slot->size = xtc->loadPagePayload(page, slot->data, pageBufferSize, slot->compression);
+    if (slot->size > 0) {
+      slot->page = page;
+    }
+  }
+  *size = slot->page == page ? slot->size : 0;
+  *compression = slot->compression;
+
+  prefetchBackward = lastTurnBackward;
+  prefetchWorker.notify();
+  xSemaphoreGive(pageMutex);
+  return *size > 0 ? slot->data : nullptr;
+}
@@ -12,6 +12,7 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include "ReaderWorker.h"
 #include "activities/ActivityWithSubactivity.h"
 
 class XtcReaderActivity final : public ActivityWithSubactivity {
@@ -21,6 +22,26 @@ class XtcReaderActivity final : public ActivityWithSubactivity {
   uint32_t currentPage = 0;
   int pagesUntilFullRefresh = 0;
   bool updateRequired = false;
+
+  // Page prefetch: a task on the other core reads the page after the one on screen (and the one before it after a
+  // backward turn) into a small PSRAM ring while the panel refreshes, so most turns start from a page in memory.
+  // pageMutex serializes every SD access of the activity between the two tasks and guards the ring. Pages are kept
+  // as stored, compressed ones are only decoded while they are drawn.
+  struct PrefetchSlot {
+    uint32_t page = UINT32_MAX;  // UINT32_MAX while empty
+    size_t size = 0;
+    uint8_t compression = xtc::COMPRESSION_NONE;
+    uint8_t* data = nullptr;
+  };
+  static constexpr int PREFETCH_SLOTS = 3;
+  PrefetchSlot prefetchSlots[PREFETCH_SLOTS];
+  uint8_t* prefetchMemory = nullptr;
+  size_t pageBufferSize = 0;
+  SemaphoreHandle_t pageMutex = nullptr;
+  ReaderWorker prefetchWorker;
+  uint32_t displayedPage = UINT32_MAX;  // Its slot is being drawn from and is never reused by the prefetcher
+  bool prefetchBackward = false;
+  bool lastTurnBackward = false;
   const std::function<void()> onGoBack;
   const std::function<void()> onGoHome;
 
@@ -31,6 +52,12 @@ class XtcReaderActivity final : public ActivityWithSubactivity {
   void renderPage();
   void saveProgress() const;
   void loadProgress();
+  void prefetchTaskLoop();
+  void startPrefetch();
+  void stopPrefetch();
+  PrefetchSlot* findSlot(uint32_t page);
+  PrefetchSlot* pickFreeSlot();
+  const uint8_t* acquirePage(uint32_t page, size_t* size, uint8_t* compression);
 
  public:
   explicit XtcReaderActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, std::unique_ptr<Xtc> xtc,
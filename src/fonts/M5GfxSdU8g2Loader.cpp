@@ -3,17 +3,11 @@
 #if defined(M5PAPER_HARDWARE)
 
 #include <HardwareSerial.h>
+#include <MemTrack.h>
 #include <SDCardManager.h>
-#include <esp32-hal-psram.h>
 
 namespace {
-void* fontAlloc(size_t size) {
-  void* ptr = ps_malloc(size);
-  if (!ptr) {
-    ptr = malloc(size);
-  }
-  return ptr;
-}
+void* fontAlloc(const size_t size) { return memtrack::allocate(memtrack::Tag::Fonts, size, true); }
 }  // namespace
 
 namespace M5GfxSdU8g2Loader {
@@ -50,7 +44,7 @@ bool loadFont(const char* path, U8g2FontHandle& out, size_t maxSize) {
   file.close();
   if (readBytes != static_cast<int>(size)) {
     Serial.printf("[%lu] [M5GFX] Failed to read font data: %s\n", millis(), path);
-    free(buffer);
+    memtrack::release(buffer);
     return false;
   }
 
@@ -66,7 +60,7 @@ void unloadFont(U8g2FontHandle& out) {
     delete out.font;
   }
   if (out.data) {
-    free(out.data);
+    memtrack::release(out.data);
   }
   out.font = nullptr;
   out.data = nullptr;
@@ -2,8 +2,8 @@
 
 #include <GfxRenderer.h>
 #include <HardwareSerial.h>
+#include <MemTrack.h>
 #include <SDCardManager.h>
-#include <esp32-hal-psram.h>
 
 #include <cstring>
 
@@ -52,23 +52,17 @@ struct LoadedFontFamily {
   bool hasBoldItalic = false;
 };
 
-void* fontAlloc(const size_t size) {
-  void* ptr = ps_malloc(size);
-  if (!ptr) {
-    ptr = malloc(size);
-  }
-  return ptr;
-}
+void* fontAlloc(const size_t size) { return memtrack::allocate(memtrack::Tag::Fonts, size, true); }
 
 void resetLoadedFont(LoadedFont& font) {
   if (font.bitmap) {
-    free(font.bitmap);
+    memtrack::release(font.bitmap);
   }
   if (font.glyphs) {
-    free(font.glyphs);
+    memtrack::release(font.glyphs);
   }
   if (font.intervals) {
-    free(font.intervals);
+    memtrack::release(font.intervals);
   }
   font.bitmap = nullptr;
   font.glyphs = nullptr;
@@ -5,6 +5,7 @@
 #include <HalGPIO.h>
 #include <SDCardManager.h>
 #include <SPI.h>
+#include <Trace.h>
 #include <esp_sleep.h>
 
 #include <memory>
@@ -53,6 +54,7 @@
 #include "activities/apps/I2cEepromDumpActivity.h"
 #include "activities/apps/ImageViewerActivity.h"
 #include "activities/apps/KeyboardHostActivity.h"
+#include "activities/apps/MemoryStatsActivity.h"
 #include "activities/apps/MinesweeperActivity.h"
 #include "activities/apps/NotesActivity.h"
 #include "activities/apps/OptionalDevicesActivity.h"
@@ -632,6 +634,10 @@ void handleLauncherAction(LauncherAction action) {
       exitActivity();
       enterNewActivity(new HardwareTestActivity(renderer, mappedInputManager, gpio, onGoLauncher));
       break;
+    case LauncherAction::SettingsMemory:
+      exitActivity();
+      enterNewActivity(new MemoryStatsActivity(renderer, mappedInputManager, onGoLauncher));
+      break;
     case LauncherAction::Calculator:
       exitActivity();
       enterNewActivity(new CalculatorActivity(renderer, mappedInputManager, onGoLauncher));
@@ -970,6 +976,8 @@ void setup() {
   }
 #endif
 
+  trace::begin();
+
   // SD Card Initialization
   // We need 6 open files concurrently when parsing a new chapter
   if (!SdMan.begin()) {
@@ -1087,6 +1095,10 @@ void loop() {
   const unsigned long activityDuration = millis() - activityStartTime;
 
   const unsigned long loopDuration = millis() - loopStartTime;
+  if (loopDuration > 50) {
+    // Tracing every iteration would flush the ring within seconds, so only the slow ones are marked
+    TRACE_INSTANT("loop", "slow_loop");
+  }
   if (loopDuration > maxLoopDuration) {
     maxLoopDuration = loopDuration;
     if (maxLoopDuration > 50) {
@@ -3,7 +3,9 @@
 #include <ArduinoJson.h>
 #include <Epub.h>
 #include <FsHelpers.h>
+#include <MemTrack.h>
 #include <SDCardManager.h>
+#include <Trace.h>
 #include <WiFi.h>
 #include <esp_task_wdt.h>
 
@@ -49,6 +51,37 @@ constexpr WebUiAppEntry WEB_UI_APPS[] = {{"dashboard", "Dashboard"},
                                          {"hardware-test", "Hardware Test"}};
 constexpr size_t WEB_UI_APPS_COUNT = sizeof(WEB_UI_APPS) / sizeof(WEB_UI_APPS[0]);
 
+// Collects small writes into chunks of a streamed (CONTENT_LENGTH_UNKNOWN) response
+class ChunkedResponsePrint final : public Print {
+  WebServer& server;
+  char buffer[1024];
+  size_t used = 0;
+
+ public:
+  explicit ChunkedResponsePrint(WebServer& server) : server(server) {}
+
+  size_t write(const uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, const size_t size) override {
+    for (size_t remaining = size; remaining > 0;) {
+      const size_t toCopy = std::min(remaining, sizeof(buffer) - used);
+      memcpy(buffer + used, data, toCopy);
+      used += toCopy;
+      data += toCopy;
+      remaining -= toCopy;
+      if (used == sizeof(buffer)) {
+        flush();
+      }
+    }
+    return size;
+  }
+  void flush() override {
+    if (used > 0) {
+      server.sendContent(buffer, used);
+      used = 0;
+    }
+  }
+};
+
 // Static pointer for WebSocket callback (WebSocketsServer requires C-style callback)
 CrossPointWebServer* wsInstance = nullptr;
 
@@ -128,10 +161,14 @@ void CrossPointWebServer::begin() {
   server->on("/files", HTTP_GET, [this] { handleFileList(); });
 
   server->on("/api/status", HTTP_GET, [this] { handleStatus(); });
+  server->on("/api/memory", HTTP_GET, [this] { handleMemory(); });
+  server->on("/api/memory", HTTP_POST, [this] { handleMemory(); });
   server->on("/api/apps", HTTP_GET, [this] { handleAppList(); });
   server->on("/api/apps/launch", HTTP_POST, [this] { handleLaunchApp(); });
   server->on("/api/reader/open", HTTP_POST, [this] { handleOpenReader(); });
   server->on("/api/files", HTTP_GET, [this] { handleFileListData(); });
+  server->on("/api/trace", HTTP_GET, [this] { handleTrace(); });
+  server->on("/api/trace", HTTP_POST, [this] { handleTrace(); });
   server->on("/download", HTTP_GET, [this] { handleDownload(); });
 
   // Upload endpoint with special handling for multipart form data
@@ -312,6 +349,40 @@ void CrossPointWebServer::handleStatus() const {
   server->send(200, "application/json", json);
 }
 
+void CrossPointWebServer::handleMemory() const {
+  // GET only reads; POST lowers every peak to the current value first
+  if (server->method() == HTTP_POST) {
+    memtrack::resetPeaks();
+  }
+
+  JsonDocument doc;
+  JsonObject heap = doc["heap"].to<JsonObject>();
+  heap["free"] = ESP.getFreeHeap();
+  heap["total"] = ESP.getHeapSize();
+  heap["minFree"] = ESP.getMinFreeHeap();
+  heap["maxAlloc"] = ESP.getMaxAllocHeap();
+  JsonObject psram = doc["psram"].to<JsonObject>();
+  psram["free"] = ESP.getFreePsram();
+  psram["total"] = ESP.getPsramSize();
+
+  JsonArray tags = doc["tags"].to<JsonArray>();
+  for (size_t i = 0; i < memtrack::TAG_COUNT; i++) {
+    const auto tag = static_cast<memtrack::Tag>(i);
+    const memtrack::TagStats stats = memtrack::getStats(tag);
+    JsonObject entry = tags.add<JsonObject>();
+    entry["name"] = memtrack::getTagName(tag);
+    entry["current"] = stats.current;
+    entry["peak"] = stats.peak;
+    entry["psram"] = stats.psram;
+    entry["failures"] = stats.failures;
+    entry["largestFailure"] = stats.largestFailure;
+  }
+
+  String json;
+  serializeJson(doc, json);
+  server->send(200, "application/json", json);
+}
+
 void CrossPointWebServer::handleAppList() const {
   JsonDocument doc;
   JsonArray apps = doc["apps"].to<JsonArray>();
@@ -508,6 +579,26 @@ void CrossPointWebServer::handleFileListData() const {
   Serial.printf("[%lu] [WEB] Served file listing page for path: %s\n", millis(), currentPath.c_str());
 }
 
+void CrossPointWebServer::handleTrace() const {
+  if (!trace::isEnabled()) {
+    server->send(503, "text/plain", "Tracing is not available");
+    return;
+  }
+
+  server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server->send(200, "application/json", "");
+  ChunkedResponsePrint out(*server);
+  const size_t events = trace::writeChromeJson(out);
+  out.flush();
+  // End of streamed response, empty chunk to signal client
+  server->sendContent("");
+  // GET only reads; POST drops the exported events so the next export starts a fresh recording
+  if (server->method() == HTTP_POST) {
+    trace::clear();
+  }
+  Serial.printf("[%lu] [WEB] Served %u trace events\n", millis(), static_cast<unsigned>(events));
+}
+
 void CrossPointWebServer::handleDownload() const {
   if (!server->hasArg("path")) {
     server->send(400, "text/plain", "Missing path");
@@ -996,6 +1087,9 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
         return;
       }
 
+      // The frame sits in a buffer the WebSocket library allocated for it until this handler returns
+      const memtrack::Charge frameCharge(memtrack::Tag::WebUpload, length);
+
       // Write binary data directly to file
       esp_task_wdt_reset();
       size_t written = wsUploadFile.write(payload, length);
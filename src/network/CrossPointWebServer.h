@@ -78,11 +78,13 @@ class CrossPointWebServer {
   void handleRoot() const;
   void handleNotFound() const;
   void handleStatus() const;
+  void handleMemory() const;
   void handleAppList() const;
   void handleLaunchApp() const;
   void handleOpenReader() const;
   void handleFileList() const;
   void handleFileListData() const;
+  void handleTrace() const;
   void handleDownload() const;
   void handleUpload() const;
   void handleUploadPost() const;
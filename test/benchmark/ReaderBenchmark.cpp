@@ -0,0 +1,481 @@
+// Runs a corpus of EPUB, TXT and XTC books through the reader code paths on the host and reports per-stage timing
+// percentiles as JSON, along with the peak bytes of every memtrack tag. Built by the host CMake build (see
+// CMakeLists.txt):
+//
+//   ReaderBenchmark --corpus <dir> [--generate] [--iterations N] [--max-sections N] [--max-pages N] [--json <file>]
+//                   [--trace <file>] [--require-stage <name>]...
+//
+// The corpus directory stands in for the SD card, books are picked up from its top level. --generate first writes a
+// synthetic corpus (a deflated EPUB with a JPEG cover, a TXT with long paragraphs, a 1-bit XTC and a 2-bit XTCH) into
+// it. --trace records the TRACE_SCOPE spans of the run and writes them as Chrome trace-event JSON, like /api/trace on
+// a device. --require-stage fails the run when that stage recorded no samples, so a path the corpus stops reaching
+// is noticed rather than silently missing from the report.
+#include <Epub.h>
+#include <Epub/Page.h>
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <HalDisplay.h>
+#include <MemTrack.h>
+#include <SDCardManager.h>
+#include <Trace.h>
+#include <Txt.h>
+#include <TxtLayout.h>
+#include <TxtPageIndex.h>
+#include <Xtc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../support/ReaderHarness.h"
+#include "../support/SyntheticBooks.h"
+
+using harness::READER_FONT_ID;
+
+namespace {
+constexpr const char* CACHE_DIR = "/.bench-cache";
+constexpr size_t TRACE_CAPACITY = 1 << 16;
+// Few enough that the synthetic TXT gets a sparse index, so page seeks lay out from checkpoints like a huge file would
+constexpr size_t SEEK_INDEX_CHECKPOINTS = 16;
+
+struct Options {
+  std::string corpus;
+  std::string jsonPath;
+  std::string tracePath;
+  std::vector<std::string> requiredStages;
+  bool generate = false;
+  int iterations = 3;
+  int maxSections = 8;
+  int maxPages = 40;
+};
+
+// Timings of one stage in microseconds
+using Samples = std::vector<double>;
+using StageSamples = std::map<std::string, Samples>;
+
+struct BookResult {
+  std::string path;
+  const char* type;
+  bool ok = true;
+  StageSamples stages;
+};
+
+class Stopwatch {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+ public:
+  double elapsedUs() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+// Nearest-rank percentile of sorted samples
+double percentile(const Samples& sorted, const double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+  return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+void writeStages(FILE* out, const StageSamples& stages, const char* indent) {
+  fprintf(out, "{");
+  bool first = true;
+  for (const auto& [name, samples] : stages) {
+    Samples sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (const double s : sorted) {
+      total += s;
+    }
+    const double mean = sorted.empty() ? 0 : total / static_cast<double>(sorted.size());
+    fprintf(out,
+            "%s\n%s  \"%s\": {\"count\": %zu, \"min_us\": %.1f, \"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, "
+            "\"max_us\": %.1f, \"mean_us\": %.1f, \"total_us\": %.1f}",
+            first ? "" : ",", indent, name.c_str(), sorted.size(), sorted.empty() ? 0 : sorted.front(),
+            percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 99),
+            sorted.empty() ? 0 : sorted.back(), mean, total);
+    first = false;
+  }
+  fprintf(out, "\n%s}", indent);
+}
+
+void removeHostTree(const std::string& sdPath) {
+  std::error_code ec;
+  std::filesystem::remove_all(SdFat::hostPath(sdPath.c_str()), ec);
+}
+
+void benchEpub(BookResult& result, GfxRenderer& renderer, const Options& options) {
+  auto& stages = result.stages;
+  auto epub = std::make_shared<Epub>(result.path, CACHE_DIR);
+  removeHostTree(epub->getCachePath());
+
+  {
+    Stopwatch sw;
+    if (!epub->load()) {
+      result.ok = false;
+      return;
+    }
+    stages["epub_metadata_build"].push_back(sw.elapsedUs());
+  }
+  {
+    Epub cached(result.path, CACHE_DIR);
+    Stopwatch sw;
+    if (cached.load(false)) {
+      stages["epub_open_cached"].push_back(sw.elapsedUs());
+    }
+  }
+
+  const harness::Viewport viewport = harness::getViewport(renderer);
+  const int sectionCount = std::min(epub->getSpineItemsCount(), options.maxSections);
+  for (int i = 0; i < sectionCount; i++) {
+    Section section(epub, i, renderer);
+    {
+      Stopwatch sw;
+      if (!section.createSectionFile(READER_FONT_ID, harness::LINE_COMPRESSION, false, 0, viewport.width,
+                                     viewport.height, true)) {
+        result.ok = false;
+        continue;
+      }
+      stages["epub_section_build"].push_back(sw.elapsedUs());
+    }
+
+    const int pageCount = std::min<int>(section.pageCount, options.maxPages);
+    for (int p = 0; p < pageCount; p++) {
+      section.currentPage = p;
+      std::unique_ptr<Page> page;
+      {
+        Stopwatch sw;
+        page = section.loadPageFromSectionFile();
+        if (!page) {
+          result.ok = false;
+          break;
+        }
+        stages["epub_page_deserialize"].push_back(sw.elapsedUs());
+      }
+      {
+        Stopwatch sw;
+        harness::renderPageBw(renderer, *page, viewport);
+        stages["epub_page_render_bw"].push_back(sw.elapsedUs());
+      }
+      if (!page->hasImages()) {
+        Stopwatch sw;
+        harness::renderPageGrayPlanes(renderer, *page, viewport);
+        stages["epub_page_render_gray_planes"].push_back(sw.elapsedUs());
+      }
+      Stopwatch sw;
+      harness::renderPageGray4(renderer, *page, viewport);
+      stages["epub_page_render_gray_4bpp"].push_back(sw.elapsedUs());
+    }
+  }
+
+  Stopwatch sw;
+  if (epub->generateCoverBmp()) {
+    stages["cover_jpeg_convert"].push_back(sw.elapsedUs());
+  }
+}
+
+void benchTxt(BookResult& result, GfxRenderer& renderer) {
+  auto& stages = result.stages;
+  Txt txt(result.path, CACHE_DIR);
+  if (!txt.load()) {
+    result.ok = false;
+    return;
+  }
+
+  const harness::Viewport viewport = harness::getViewport(renderer);
+  const int linesPerPage = std::max(1, viewport.height / renderer.getLineHeight(READER_FONT_ID));
+  const TxtLayout layout(txt, renderer, READER_FONT_ID, viewport.width, linesPerPage);
+  // The index the reader builds in the background, timed as a whole
+  TxtPageIndex sparseIndex(SEEK_INDEX_CHECKPOINTS);
+  {
+    Stopwatch sw;
+    while (!sparseIndex.extend(layout, 64) && !sparseIndex.hasFailed()) {
+    }
+    stages["txt_index_build"].push_back(sw.elapsedUs());
+  }
+  if (!sparseIndex.isComplete()) {
+    result.ok = false;
+    return;
+  }
+  // Every page start, laid out one after another, to check the sparse index against
+  std::vector<size_t> pageOffsets(1, 0);
+  size_t nextOffset;
+  while (layout.nextPageStart(pageOffsets.back(), nextOffset) == TxtLayout::PageStep::Next) {
+    pageOffsets.push_back(nextOffset);
+  }
+  if (sparseIndex.getPageCount() != pageOffsets.size()) {
+    result.ok = false;
+    return;
+  }
+
+  // Spread the page layouts over the whole file, long paragraphs sit anywhere
+  const size_t step = std::max<size_t>(1, pageOffsets.size() / 32);
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < pageOffsets.size(); i += step) {
+    Stopwatch sw;
+    layout.layoutPage(pageOffsets[i], lines, nextOffset);
+    stages["txt_page_layout"].push_back(sw.elapsedUs());
+  }
+
+  // Walk backwards, like paging back through the book, every seek must agree with the full index
+  for (size_t i = pageOffsets.size(); i-- > 0;) {
+    size_t offset = 0;
+    Stopwatch sw;
+    const bool found = sparseIndex.getPageOffset(layout, i, offset);
+    stages["txt_page_seek"].push_back(sw.elapsedUs());
+    if (!found || offset != pageOffsets[i]) {
+      result.ok = false;
+      return;
+    }
+  }
+
+  // Paging back where the index hasn't got to yet lays the previous page out from its paragraph instead, the page
+  // found that way has to end right where the current one starts
+  for (size_t i = 1; i < pageOffsets.size(); i += step) {
+    size_t previousOffset = 0;
+    Stopwatch sw;
+    const bool found = layout.previousPageStart(pageOffsets[i], previousOffset);
+    stages["txt_page_back"].push_back(sw.elapsedUs());
+    if (!found || !layout.layoutPage(previousOffset, lines, nextOffset) || nextOffset != pageOffsets[i]) {
+      result.ok = false;
+      return;
+    }
+  }
+}
+
+void benchXtc(BookResult& result, GfxRenderer& renderer, const Options& options) {
+  auto& stages = result.stages;
+  Xtc xtc(result.path, CACHE_DIR);
+  {
+    Stopwatch sw;
+    if (!xtc.load()) {
+      result.ok = false;
+      return;
+    }
+    stages["xtc_open"].push_back(sw.elapsedUs());
+  }
+
+  const uint16_t pageWidth = xtc.getPageWidth();
+  const uint16_t pageHeight = xtc.getPageHeight();
+  const uint8_t bitDepth = xtc.getBitDepth();
+  std::vector<uint8_t> pageBuffer(harness::getXtcPageBufferSize(pageWidth, pageHeight, bitDepth));
+  const uint32_t pageCount = std::min<uint32_t>(xtc.getPageCount(), options.maxPages);
+  for (uint32_t p = 0; p < pageCount; p++) {
+    uint8_t compression = 0;
+    size_t payloadSize = 0;
+    {
+      Stopwatch sw;
+      payloadSize = xtc.loadPagePayload(p, pageBuffer.data(), pageBuffer.size(), compression);
+      if (payloadSize == 0) {
+        result.ok = false;
+        break;
+      }
+      stages["xtc_page_load"].push_back(sw.elapsedUs());
+    }
+    Stopwatch sw;
+    // BW pass only, the gray passes of XTCH pages repeat the same walk. Compressed pages decode as they draw.
+    if (!harness::drawXtcPage(renderer, pageBuffer.data(), payloadSize, compression, pageWidth, pageHeight, bitDepth,
+                              harness::XtcPass::Bw)) {
+      result.ok = false;
+      break;
+    }
+    stages["xtc_page_blit"].push_back(sw.elapsedUs());
+  }
+}
+
+const char* bookType(const std::string& name) {
+  std::string ext = std::filesystem::path(name).extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](const unsigned char c) { return std::tolower(c); });
+  if (ext == ".epub") return "epub";
+  if (ext == ".txt") return "txt";
+  if (ext == ".xtc" || ext == ".xtch") return "xtc";
+  return nullptr;
+}
+
+class FilePrint final : public Print {
+  FILE* file;
+
+ public:
+  explicit FilePrint(FILE* file) : file(file) {}
+  size_t write(const uint8_t c) override { return fputc(c, file) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buffer, const size_t size) override { return fwrite(buffer, 1, size, file); }
+};
+
+bool writeTrace(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+  FilePrint out(file);
+  trace::writeChromeJson(out);
+  return fclose(file) == 0;
+}
+
+bool parseOptions(const int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--corpus" && hasValue) {
+      options->corpus = argv[++i];
+    } else if (arg == "--json" && hasValue) {
+      options->jsonPath = argv[++i];
+    } else if (arg == "--trace" && hasValue) {
+      options->tracePath = argv[++i];
+    } else if (arg == "--iterations" && hasValue) {
+      options->iterations = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--max-sections" && hasValue) {
+      options->maxSections = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--max-pages" && hasValue) {
+      options->maxPages = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--require-stage" && hasValue) {
+      options->requiredStages.push_back(argv[++i]);
+    } else if (arg == "--generate") {
+      options->generate = true;
+    } else {
+      return false;
+    }
+  }
+  return !options->corpus.empty();
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "Usage: %s --corpus <dir> [--generate] [--iterations N] [--max-sections N] [--max-pages N] "
+            "[--json <file>] [--trace <file>] [--require-stage <name>]...\n",
+            argv[0]);
+    return 2;
+  }
+  if (options.generate && !harness::generateCorpus(options.corpus)) {
+    fprintf(stderr, "Failed to generate the synthetic corpus in %s\n", options.corpus.c_str());
+    return 1;
+  }
+
+  SdFat::setRoot(options.corpus);
+  SdMan.begin();
+  std::vector<std::string> books;
+  for (const auto& entry : std::filesystem::directory_iterator(options.corpus)) {
+    const std::string name = entry.path().filename().string();
+    if (entry.is_regular_file() && bookType(name)) {
+      books.push_back("/" + name);
+    }
+  }
+  std::sort(books.begin(), books.end());
+  if (books.empty()) {
+    fprintf(stderr, "No .epub, .txt, .xtc or .xtch files in %s\n", options.corpus.c_str());
+    return 1;
+  }
+
+  HalDisplay display;
+  display.begin();
+  GfxRenderer renderer(display);
+  harness::insertReaderFont(renderer);
+
+  std::vector<BookResult> results;
+  for (const auto& book : books) {
+    results.push_back({book, bookType(book)});
+  }
+
+  if (!options.tracePath.empty() && !trace::begin(TRACE_CAPACITY)) {
+    fprintf(stderr, "Failed to allocate the trace buffer\n");
+    return 1;
+  }
+
+  // Logging stays on until the books are in, then is muted so it doesn't show up in the timings
+  Serial.end();
+  for (int iteration = 0; iteration < options.iterations; iteration++) {
+    removeHostTree(CACHE_DIR);
+    SdMan.mkdir(CACHE_DIR);
+    for (auto& result : results) {
+      if (strcmp(result.type, "epub") == 0) {
+        benchEpub(result, renderer, options);
+      } else if (strcmp(result.type, "txt") == 0) {
+        benchTxt(result, renderer);
+      } else {
+        benchXtc(result, renderer, options);
+      }
+    }
+  }
+  Serial.begin(115200);
+  removeHostTree(CACHE_DIR);
+
+  StageSamples combined;
+  bool allOk = true;
+  for (const auto& result : results) {
+    allOk = allOk && result.ok;
+    for (const auto& [name, samples] : result.stages) {
+      combined[name].insert(combined[name].end(), samples.begin(), samples.end());
+    }
+  }
+
+  for (const auto& stage : options.requiredStages) {
+    if (combined[stage].empty()) {
+      fprintf(stderr, "Stage %s recorded no samples\n", stage.c_str());
+      allOk = false;
+    }
+  }
+
+  FILE* out = options.jsonPath.empty() ? stdout : fopen(options.jsonPath.c_str(), "w");
+  if (!out) {
+    fprintf(stderr, "Failed to open %s\n", options.jsonPath.c_str());
+    return 1;
+  }
+  fprintf(out, "{\n  \"iterations\": %d,\n  \"max_sections\": %d,\n  \"max_pages\": %d,\n  \"stages\": ",
+          options.iterations, options.maxSections, options.maxPages);
+  writeStages(out, combined, "  ");
+  fprintf(out, ",\n  \"memory_peaks\": {");
+  for (size_t i = 0; i < memtrack::TAG_COUNT; i++) {
+    const auto tag = static_cast<memtrack::Tag>(i);
+    const memtrack::TagStats stats = memtrack::getStats(tag);
+    fprintf(out, "%s\n    \"%s\": {\"peak\": %zu, \"failures\": %u}", i == 0 ? "" : ",", memtrack::getTagName(tag),
+            stats.peak, static_cast<unsigned>(stats.failures));
+  }
+  fprintf(out, "\n  },\n  \"books\": [");
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& result = results[i];
+    fprintf(out, "%s\n    {\"path\": \"%s\", \"type\": \"%s\", \"ok\": %s, \"stages\": ", i == 0 ? "" : ",",
+            jsonEscape(result.path).c_str(), result.type, result.ok ? "true" : "false");
+    writeStages(out, result.stages, "    ");
+    fprintf(out, "}");
+  }
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  if (!options.tracePath.empty() && !writeTrace(options.tracePath)) {
+    fprintf(stderr, "Failed to write %s\n", options.tracePath.c_str());
+    return 1;
+  }
+
+  // Any book failing to open or lay out, or a required stage without samples, fails the run, so CI notices breakage
+  // as well as slowdowns
+  return allOk ? 0 : 1;
+}
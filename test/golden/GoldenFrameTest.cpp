@@ -0,0 +1,315 @@
+// Renders fixed pages of the synthetic books into the host frame buffers and compares a hash of every frame (BW, the
+// LSB/MSB gray planes and the 4bpp gray buffer) against test/golden/frames.txt. Any pixel drift in layout or
+// rendering fails the run and names the frames that moved.
+//
+//   GoldenFrameTest --corpus <dir> --goldens <file> [--update] [--dump <dir>]
+//
+// --update rewrites the goldens from this run, --dump writes every frame as PBM/PGM for a visual diff.
+#include <Epub.h>
+#include <Epub/Page.h>
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <HalDisplay.h>
+#include <SDCardManager.h>
+#include <Txt.h>
+#include <TxtLayout.h>
+#include <Xtc.h>
+#include <ZipFile.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../support/ReaderHarness.h"
+#include "../support/SyntheticBooks.h"
+
+using harness::READER_FONT_ID;
+
+namespace {
+constexpr const char* CACHE_DIR = "/.golden-cache";
+constexpr int EPUB_SECTIONS = 2;
+constexpr int PAGES_PER_BOOK = 3;
+
+enum class FrameKind { Bw, Lsb, Msb, Gray4 };
+
+struct Options {
+  std::string corpus;
+  std::string goldensPath;
+  std::string dumpDir;
+  bool update = false;
+};
+
+class FrameRecorder {
+  HalDisplay& display;
+  const Options& options;
+  std::map<std::string, uint64_t> hashes;
+
+ public:
+  FrameRecorder(HalDisplay& display, const Options& options) : display(display), options(options) {}
+
+  void record(const std::string& name, const FrameKind kind) {
+    const uint8_t* buffer;
+    size_t size = HalDisplay::BUFFER_SIZE;
+    switch (kind) {
+      case FrameKind::Bw:
+        buffer = display.getFrameBuffer();
+        break;
+      case FrameKind::Lsb:
+        buffer = display.getGrayscaleLsbBuffer();
+        break;
+      case FrameKind::Msb:
+        buffer = display.getGrayscaleMsbBuffer();
+        break;
+      case FrameKind::Gray4:
+      default:
+        buffer = display.getGrayFrameBuffer();
+        size = HalDisplay::GRAY_BUFFER_SIZE;
+        break;
+    }
+    hashes[name] = ZipFile::fnvHash64(reinterpret_cast<const char*>(buffer), size);
+
+    if (!options.dumpDir.empty()) {
+      const std::string path = options.dumpDir + "/" + name + (kind == FrameKind::Gray4 ? ".pgm" : ".pbm");
+      const bool saved = kind == FrameKind::Gray4 ? HalDisplay::saveGrayBufferAsPGM(buffer, path.c_str())
+                                                  : HalDisplay::saveBufferAsPBM(buffer, path.c_str());
+      if (!saved) {
+        fprintf(stderr, "Failed to write %s\n", path.c_str());
+      }
+    }
+  }
+
+  const std::map<std::string, uint64_t>& getHashes() const { return hashes; }
+};
+
+bool renderEpub(GfxRenderer& renderer, FrameRecorder& frames) {
+  auto epub = std::make_shared<Epub>("/synthetic.epub", CACHE_DIR);
+  if (!epub->load()) {
+    return false;
+  }
+  const harness::Viewport viewport = harness::getViewport(renderer);
+  for (int s = 0; s < EPUB_SECTIONS && s < epub->getSpineItemsCount(); s++) {
+    Section section(epub, s, renderer);
+    if (!section.createSectionFile(READER_FONT_ID, harness::LINE_COMPRESSION, false, 0, viewport.width,
+                                   viewport.height, true)) {
+      return false;
+    }
+    for (int p = 0; p < PAGES_PER_BOOK && p < section.pageCount; p++) {
+      section.currentPage = p;
+      const auto page = section.loadPageFromSectionFile();
+      if (!page) {
+        return false;
+      }
+      const std::string name = "epub_s" + std::to_string(s) + "_p" + std::to_string(p);
+      harness::renderPageBw(renderer, *page, viewport);
+      frames.record(name + "_bw", FrameKind::Bw);
+      harness::renderPageGrayPlanes(renderer, *page, viewport);
+      frames.record(name + "_lsb", FrameKind::Lsb);
+      frames.record(name + "_msb", FrameKind::Msb);
+      harness::renderPageGray4(renderer, *page, viewport);
+      frames.record(name + "_gray4", FrameKind::Gray4);
+    }
+  }
+  return true;
+}
+
+bool renderTxt(GfxRenderer& renderer, FrameRecorder& frames) {
+  Txt txt("/synthetic.txt", CACHE_DIR);
+  if (!txt.load()) {
+    return false;
+  }
+  const harness::Viewport viewport = harness::getViewport(renderer);
+  const int linesPerPage = std::max(1, viewport.height / renderer.getLineHeight(READER_FONT_ID));
+  const TxtLayout layout(txt, renderer, READER_FONT_ID, viewport.width, linesPerPage);
+  size_t offset = 0;
+  std::vector<std::string> lines;
+  for (int p = 0; p < PAGES_PER_BOOK; p++) {
+    size_t nextOffset;
+    if (!layout.layoutPage(offset, lines, nextOffset)) {
+      return false;
+    }
+    offset = nextOffset;
+    const std::string name = "txt_p" + std::to_string(p);
+    renderer.clearScreen();
+    harness::drawTxtLines(renderer, lines, viewport);
+    frames.record(name + "_bw", FrameKind::Bw);
+    renderer.setRenderMode(GfxRenderer::GRAYSCALE_4BPP);
+    renderer.clearScreen();
+    harness::drawTxtLines(renderer, lines, viewport);
+    renderer.setRenderMode(GfxRenderer::BW);
+    frames.record(name + "_gray4", FrameKind::Gray4);
+  }
+  return true;
+}
+
+bool renderXtc(GfxRenderer& renderer, FrameRecorder& frames, const char* path, const char* prefix) {
+  Xtc xtc(path, CACHE_DIR);
+  if (!xtc.load()) {
+    return false;
+  }
+  const uint16_t pageWidth = xtc.getPageWidth();
+  const uint16_t pageHeight = xtc.getPageHeight();
+  const uint8_t bitDepth = xtc.getBitDepth();
+  std::vector<uint8_t> pageBuffer(harness::getXtcPageBufferSize(pageWidth, pageHeight, bitDepth));
+  for (uint32_t p = 0; p < PAGES_PER_BOOK && p < xtc.getPageCount(); p++) {
+    uint8_t compression = 0;
+    const size_t payloadSize = xtc.loadPagePayload(p, pageBuffer.data(), pageBuffer.size(), compression);
+    if (payloadSize == 0) {
+      return false;
+    }
+    const auto draw = [&](const harness::XtcPass pass) {
+      return harness::drawXtcPage(renderer, pageBuffer.data(), payloadSize, compression, pageWidth, pageHeight,
+                                  bitDepth, pass);
+    };
+    const std::string name = std::string(prefix) + "_p" + std::to_string(p);
+    if (!draw(harness::XtcPass::Bw)) {
+      return false;
+    }
+    frames.record(name + "_bw", FrameKind::Bw);
+    if (bitDepth == 2) {
+      if (!draw(harness::XtcPass::Lsb)) {
+        return false;
+      }
+      renderer.copyGrayscaleLsbBuffers();
+      frames.record(name + "_lsb", FrameKind::Lsb);
+      if (!draw(harness::XtcPass::Msb)) {
+        return false;
+      }
+      renderer.copyGrayscaleMsbBuffers();
+      frames.record(name + "_msb", FrameKind::Msb);
+    }
+  }
+  return true;
+}
+
+// One "<frame> <hash>" per line, '#' starts a comment
+bool loadGoldens(const std::string& path, std::map<std::string, uint64_t>* goldens) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string name, hash;
+    if (fields >> name >> hash) {
+      (*goldens)[name] = std::stoull(hash, nullptr, 16);
+    }
+  }
+  return true;
+}
+
+bool saveGoldens(const std::string& path, const std::map<std::string, uint64_t>& hashes) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+  fprintf(file, "# FNV-1a 64 of each frame buffer, written by GoldenFrameTest --update\n");
+  for (const auto& [name, hash] : hashes) {
+    fprintf(file, "%s %016" PRIx64 "\n", name.c_str(), hash);
+  }
+  return fclose(file) == 0;
+}
+
+bool parseOptions(const int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--corpus" && hasValue) {
+      options->corpus = argv[++i];
+    } else if (arg == "--goldens" && hasValue) {
+      options->goldensPath = argv[++i];
+    } else if (arg == "--dump" && hasValue) {
+      options->dumpDir = argv[++i];
+    } else if (arg == "--update") {
+      options->update = true;
+    } else {
+      return false;
+    }
+  }
+  return !options->corpus.empty() && !options->goldensPath.empty();
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr, "Usage: %s --corpus <dir> --goldens <file> [--update] [--dump <dir>]\n", argv[0]);
+    return 2;
+  }
+  if (!harness::generateCorpus(options.corpus)) {
+    fprintf(stderr, "Failed to generate the synthetic corpus in %s\n", options.corpus.c_str());
+    return 1;
+  }
+  if (!options.dumpDir.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(options.dumpDir, ec);
+  }
+
+  SdFat::setRoot(options.corpus);
+  SdMan.begin();
+  std::error_code ec;
+  std::filesystem::remove_all(SdFat::hostPath(CACHE_DIR), ec);
+  SdMan.mkdir(CACHE_DIR);
+
+  HalDisplay display;
+  display.begin();
+  GfxRenderer renderer(display);
+  harness::insertReaderFont(renderer);
+  FrameRecorder frames(display, options);
+
+  Serial.end();
+  const bool rendered = renderEpub(renderer, frames) && renderTxt(renderer, frames) &&
+                        renderXtc(renderer, frames, "/synthetic.xtc", "xtc") &&
+                        renderXtc(renderer, frames, "/synthetic.xtch", "xtch") &&
+                        renderXtc(renderer, frames, "/synthetic_packbits.xtc", "xtc_packbits") &&
+                        renderXtc(renderer, frames, "/synthetic_packbits.xtch", "xtch_packbits");
+  Serial.begin(115200);
+  std::filesystem::remove_all(SdFat::hostPath(CACHE_DIR), ec);
+  if (!rendered) {
+    fprintf(stderr, "Failed to open or lay out a synthetic book\n");
+    return 1;
+  }
+
+  if (options.update) {
+    if (!saveGoldens(options.goldensPath, frames.getHashes())) {
+      fprintf(stderr, "Failed to write %s\n", options.goldensPath.c_str());
+      return 1;
+    }
+    printf("Wrote %zu golden frames to %s\n", frames.getHashes().size(), options.goldensPath.c_str());
+    return 0;
+  }
+
+  std::map<std::string, uint64_t> goldens;
+  if (!loadGoldens(options.goldensPath, &goldens)) {
+    fprintf(stderr, "Failed to read %s, run with --update to create it\n", options.goldensPath.c_str());
+    return 1;
+  }
+  int failures = 0;
+  for (const auto& [name, hash] : frames.getHashes()) {
+    const auto golden = goldens.find(name);
+    if (golden == goldens.end()) {
+      printf("NEW      %s %016" PRIx64 "\n", name.c_str(), hash);
+      failures++;
+    } else if (golden->second != hash) {
+      printf("CHANGED  %s %016" PRIx64 " (golden %016" PRIx64 ")\n", name.c_str(), hash, golden->second);
+      failures++;
+    }
+  }
+  for (const auto& [name, hash] : goldens) {
+    if (frames.getHashes().count(name) == 0) {
+      printf("MISSING  %s\n", name.c_str());
+      failures++;
+    }
+  }
+  printf("%zu frames, %d mismatched\n", frames.getHashes().size(), failures);
+  return failures == 0 ? 0 : 1;
+}
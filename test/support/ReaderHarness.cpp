@@ -0,0 +1,101 @@
+#include "ReaderHarness.h"
+
+#include <Epub/Page.h>
+#include <Xtc/XtcPageBands.h>
+#include <builtinFonts/bookerly_14_bold.h>
+#include <builtinFonts/bookerly_14_bolditalic.h>
+#include <builtinFonts/bookerly_14_italic.h>
+#include <builtinFonts/bookerly_14_regular.h>
+
+namespace harness {
+namespace {
+EpdFont bookerly14RegularFont(&bookerly_14_regular);
+EpdFont bookerly14BoldFont(&bookerly_14_bold);
+EpdFont bookerly14ItalicFont(&bookerly_14_italic);
+EpdFont bookerly14BoldItalicFont(&bookerly_14_bolditalic);
+EpdFontFamily bookerly14FontFamily(&bookerly14RegularFont, &bookerly14BoldFont, &bookerly14ItalicFont,
+                                   &bookerly14BoldItalicFont);
+}  // namespace
+
+void insertReaderFont(GfxRenderer& renderer) { renderer.insertFont(READER_FONT_ID, bookerly14FontFamily); }
+
+Viewport getViewport(const GfxRenderer& renderer) {
+  int marginTop, marginRight, marginBottom, marginLeft;
+  renderer.getOrientedViewableTRBL(&marginTop, &marginRight, &marginBottom, &marginLeft);
+  Viewport viewport;
+  viewport.top = marginTop + SCREEN_MARGIN;
+  viewport.left = marginLeft + SCREEN_MARGIN;
+  viewport.width = renderer.getScreenWidth() - viewport.left - marginRight - SCREEN_MARGIN;
+  viewport.height = renderer.getScreenHeight() - viewport.top - marginBottom - SCREEN_MARGIN;
+  return viewport;
+}
+
+void renderPageBw(GfxRenderer& renderer, const Page& page, const Viewport& viewport) {
+  renderer.setRenderMode(GfxRenderer::BW);
+  renderer.clearScreen();
+  page.render(renderer, READER_FONT_ID, viewport.left, viewport.top);
+}
+
+void renderPageGrayPlanes(GfxRenderer& renderer, const Page& page, const Viewport& viewport) {
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
+  page.render(renderer, READER_FONT_ID, viewport.left, viewport.top);
+  renderer.copyGrayscaleLsbBuffers();
+
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+  page.render(renderer, READER_FONT_ID, viewport.left, viewport.top);
+  renderer.copyGrayscaleMsbBuffers();
+  renderer.setRenderMode(GfxRenderer::BW);
+}
+
+void renderPageGray4(GfxRenderer& renderer, const Page& page, const Viewport& viewport) {
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_4BPP);
+  renderer.clearScreen();
+  page.render(renderer, READER_FONT_ID, viewport.left, viewport.top);
+  renderer.setRenderMode(GfxRenderer::BW);
+}
+
+void drawTxtLines(const GfxRenderer& renderer, const std::vector<std::string>& lines, const Viewport& viewport) {
+  const int lineHeight = renderer.getLineHeight(READER_FONT_ID);
+  int y = viewport.top;
+  for (const auto& line : lines) {
+    if (!line.empty()) {
+      renderer.drawText(READER_FONT_ID, viewport.left, y, line.c_str());
+    }
+    y += lineHeight;
+  }
+}
+
+bool drawXtcPage(const GfxRenderer& renderer, const uint8_t* payload, const size_t payloadSize,
+                 const uint8_t compression, const uint16_t pageWidth, const uint16_t pageHeight, const uint8_t bitDepth,
+                 const XtcPass pass) {
+  renderer.clearScreen(pass == XtcPass::Bw ? 0xFF : 0x00);
+  // XTG has no gray planes
+  if (bitDepth != 2 && pass != XtcPass::Bw) {
+    return true;
+  }
+
+  // XTG: row-major, MSB first, 0 = black. XTH: two bit planes, columns right to left, 8 vertical pixels per byte.
+  // 0 = white, 1 = dark gray, 2 = light gray, 3 = black.
+  const uint8_t mask = pass == XtcPass::Bw ? 0b1110 : pass == XtcPass::Lsb ? 0b0010 : 0b0110;
+  xtc::PageBands bands(payload, payloadSize, compression, pageWidth, pageHeight, bitDepth);
+  xtc::PageBand band;
+  while (bands.next(band)) {
+    if (bitDepth != 2) {
+      renderer.drawPackedRows(band.data, band.x, band.y, band.width, band.height, true, true);
+    } else {
+      renderer.drawPackedColumnPlanes(band.data, band.plane2, band.x, band.y, band.width, band.height, mask,
+                                      pass == XtcPass::Bw);
+    }
+  }
+  return !bands.failed();
+}
+
+size_t getXtcPageBufferSize(const uint16_t pageWidth, const uint16_t pageHeight, const uint8_t bitDepth) {
+  if (bitDepth == 2) {
+    return ((static_cast<size_t>(pageWidth) * pageHeight + 7) / 8) * 2;
+  }
+  return ((pageWidth + 7) / 8) * static_cast<size_t>(pageHeight);
+}
+}  // namespace harness
@@ -0,0 +1,44 @@
+#pragma once
+// Reader-side drawing shared by the host tools, following what the reader activities do for each book format
+#include <GfxRenderer.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Page;
+
+namespace harness {
+constexpr int READER_FONT_ID = 1;
+constexpr int SCREEN_MARGIN = 20;
+constexpr float LINE_COMPRESSION = 1.0f;
+
+// Registers Bookerly 14 as READER_FONT_ID
+void insertReaderFont(GfxRenderer& renderer);
+
+// Viewport of a book page, laid out like the reader does with a uniform margin instead of the settings
+struct Viewport {
+  int top;
+  int left;
+  int width;
+  int height;
+};
+Viewport getViewport(const GfxRenderer& renderer);
+
+// The passes of EpubReaderActivity::renderContents: BW, then the LSB/MSB planes on boards with a 2-bit LUT, or a
+// single 4bpp pass on the M5 panels. Each leaves the renderer in BW mode.
+void renderPageBw(GfxRenderer& renderer, const Page& page, const Viewport& viewport);
+void renderPageGrayPlanes(GfxRenderer& renderer, const Page& page, const Viewport& viewport);
+void renderPageGray4(GfxRenderer& renderer, const Page& page, const Viewport& viewport);
+
+// Left-aligned lines of a TXT page, as TxtReaderActivity::renderPage draws them
+void drawTxtLines(const GfxRenderer& renderer, const std::vector<std::string>& lines, const Viewport& viewport);
+
+// One pass of XtcReaderActivity::renderPage over a page as Xtc::loadPagePayload() returns it. Bw clears to white and
+// draws every non-white pixel black; Lsb and Msb clear to black and mark the dark (Lsb) or dark and light (Msb) gray
+// pixels. False if a compressed page turned out to be broken.
+enum class XtcPass { Bw, Lsb, Msb };
+bool drawXtcPage(const GfxRenderer& renderer, const uint8_t* payload, size_t payloadSize, uint8_t compression,
+                 uint16_t pageWidth, uint16_t pageHeight, uint8_t bitDepth, XtcPass pass);
+size_t getXtcPageBufferSize(uint16_t pageWidth, uint16_t pageHeight, uint8_t bitDepth);
+}  // namespace harness
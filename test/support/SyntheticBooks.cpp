@@ -0,0 +1,435 @@
+#include "SyntheticBooks.h"
+
+#include <Xtc/XtcPageBands.h>
+#include <Xtc/XtcTypes.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+namespace harness {
+namespace {
+class Rng {
+  uint32_t state;
+
+ public:
+  explicit Rng(const uint32_t seed) : state(seed) {}
+  uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  }
+  uint32_t below(const uint32_t n) { return next() % n; }
+};
+
+const char* const WORDS[] = {"the",       "of",          "and",     "a",        "to",      "in",       "is",
+                             "reader",    "page",        "chapter", "paper",    "ink",     "river",    "quietly",
+                             "mountain",  "unremarkable", "window", "evening",  "letters", "remember", "through",
+                             "whispered", "extraordinary", "light", "between",  "under",   "her",      "his",
+                             "they",      "afterwards",  "notwithstanding", "glass", "old", "road",    "north"};
+
+std::string paragraph(Rng& rng, const int words) {
+  std::string out;
+  for (int w = 0; w < words; w++) {
+    if (w > 0) {
+      out += ' ';
+    }
+    out += WORDS[rng.below(sizeof(WORDS) / sizeof(WORDS[0]))];
+  }
+  out += '.';
+  return out;
+}
+
+// Baseline grayscale JPEG with the example tables of the JPEG spec (Annex K), enough for the cover converter
+class JpegWriter {
+  std::string out;
+  uint32_t bitBuffer = 0;
+  int bitCount = 0;
+  uint16_t dcCodes[12] = {};
+  uint8_t dcLengths[12] = {};
+  uint16_t acCodes[256] = {};
+  uint8_t acLengths[256] = {};
+  // cosines[u][x] = C(u) * cos((2x + 1) * u * pi / 16) / 2, so a 2D coefficient is a product of two of them
+  float cosines[8][8] = {};
+
+  static constexpr uint8_t ZIGZAG[64] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+                                         12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+                                         35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+                                         58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+  static constexpr uint8_t QUANT[64] = {16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+                                        14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+                                        18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+                                        49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+  static constexpr uint8_t DC_BITS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+  static constexpr uint8_t DC_VALUES[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  static constexpr uint8_t AC_BITS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+  static constexpr uint8_t AC_VALUES[162] = {
+      0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+      0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+      0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+      0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+      0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+      0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+      0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+      0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+      0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+  // Canonical codes in the order of the values, as a decoder rebuilds them from the bit counts
+  static void buildCodes(const uint8_t* bits, const uint8_t* values, uint16_t* codes, uint8_t* lengths) {
+    uint16_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+      for (int i = 0; i < bits[length - 1]; i++) {
+        codes[values[k]] = code++;
+        lengths[values[k]] = static_cast<uint8_t>(length);
+        k++;
+      }
+      code <<= 1;
+    }
+  }
+
+  void marker(const uint8_t type, const std::string& payload) {
+    out += static_cast<char>(0xFF);
+    out += static_cast<char>(type);
+    out += static_cast<char>((payload.size() + 2) >> 8);
+    out += static_cast<char>((payload.size() + 2) & 0xFF);
+    out += payload;
+  }
+
+  static std::string huffmanTable(const uint8_t tableClass, const uint8_t* bits, const uint8_t* values) {
+    std::string table(1, static_cast<char>(tableClass << 4));
+    table.append(reinterpret_cast<const char*>(bits), 16);
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+      count += bits[i];
+    }
+    table.append(reinterpret_cast<const char*>(values), count);
+    return table;
+  }
+
+  void putBits(const uint32_t value, const int length) {
+    bitBuffer = (bitBuffer << length) | (value & ((1u << length) - 1));
+    bitCount += length;
+    while (bitCount >= 8) {
+      const auto byte = static_cast<uint8_t>(bitBuffer >> (bitCount - 8));
+      out += static_cast<char>(byte);
+      if (byte == 0xFF) {
+        out += '\0';  // Byte stuffing
+      }
+      bitCount -= 8;
+    }
+  }
+
+  // Bits needed for the magnitude, which is also the Huffman symbol (or its low nibble for AC)
+  static int category(const int value) {
+    int magnitude = std::abs(value);
+    int bits = 0;
+    while (magnitude) {
+      bits++;
+      magnitude >>= 1;
+    }
+    return bits;
+  }
+
+  // Extra bits after a symbol, negative values are stored one's complement style
+  void putValue(const int value) {
+    const int bits = category(value);
+    if (bits > 0) {
+      putBits(value < 0 ? value - 1 : value, bits);
+    }
+  }
+
+  void encodeBlock(const float* samples, int* previousDc) {
+    // Separable forward DCT: rows first, then columns
+    float rows[64];
+    for (int y = 0; y < 8; y++) {
+      for (int u = 0; u < 8; u++) {
+        float sum = 0;
+        for (int x = 0; x < 8; x++) {
+          sum += samples[y * 8 + x] * cosines[u][x];
+        }
+        rows[y * 8 + u] = sum;
+      }
+    }
+    int quantized[64];
+    for (int v = 0; v < 8; v++) {
+      for (int u = 0; u < 8; u++) {
+        float sum = 0;
+        for (int y = 0; y < 8; y++) {
+          sum += rows[y * 8 + u] * cosines[v][y];
+        }
+        quantized[v * 8 + u] = static_cast<int>(std::lround(sum / QUANT[v * 8 + u]));
+      }
+    }
+
+    const int dcDelta = quantized[0] - *previousDc;
+    *previousDc = quantized[0];
+    putBits(dcCodes[category(dcDelta)], dcLengths[category(dcDelta)]);
+    putValue(dcDelta);
+
+    int zeroRun = 0;
+    for (int k = 1; k < 64; k++) {
+      const int value = quantized[ZIGZAG[k]];
+      if (value == 0) {
+        zeroRun++;
+        continue;
+      }
+      for (; zeroRun >= 16; zeroRun -= 16) {
+        putBits(acCodes[0xF0], acLengths[0xF0]);
+      }
+      const int symbol = (zeroRun << 4) | category(value);
+      putBits(acCodes[symbol], acLengths[symbol]);
+      putValue(value);
+      zeroRun = 0;
+    }
+    if (zeroRun > 0) {
+      putBits(acCodes[0x00], acLengths[0x00]);
+    }
+  }
+
+ public:
+  // pixel(x, y) gives the gray value, width and height are multiples of 8
+  std::string encode(const int width, const int height, const std::function<uint8_t(int, int)>& pixel) {
+    buildCodes(DC_BITS, DC_VALUES, dcCodes, dcLengths);
+    buildCodes(AC_BITS, AC_VALUES, acCodes, acLengths);
+    const double pi = std::acos(-1.0);
+    for (int u = 0; u < 8; u++) {
+      for (int x = 0; x < 8; x++) {
+        cosines[u][x] = static_cast<float>((u == 0 ? std::sqrt(0.5) : 1.0) * std::cos((2 * x + 1) * u * pi / 16) / 2);
+      }
+    }
+
+    out = "\xFF\xD8";
+    std::string quant(1, '\0');
+    for (const uint8_t index : ZIGZAG) {
+      quant += static_cast<char>(QUANT[index]);
+    }
+    marker(0xDB, quant);
+    const char frame[] = {8,
+                          static_cast<char>(height >> 8),
+                          static_cast<char>(height & 0xFF),
+                          static_cast<char>(width >> 8),
+                          static_cast<char>(width & 0xFF),
+                          1,
+                          1,
+                          0x11,
+                          0};
+    marker(0xC0, std::string(frame, sizeof(frame)));
+    marker(0xC4, huffmanTable(0, DC_BITS, DC_VALUES));
+    marker(0xC4, huffmanTable(1, AC_BITS, AC_VALUES));
+    marker(0xDA, std::string("\x01\x01\x00\x00\x3f\x00", 6));
+
+    int previousDc = 0;
+    float samples[64];
+    for (int blockY = 0; blockY < height; blockY += 8) {
+      for (int blockX = 0; blockX < width; blockX += 8) {
+        for (int i = 0; i < 64; i++) {
+          samples[i] = static_cast<float>(pixel(blockX + i % 8, blockY + i / 8)) - 128;
+        }
+        encodeBlock(samples, &previousDc);
+      }
+    }
+    putBits(0x7F, 7);  // Pads the last byte with ones
+    out += "\xFF\xD9";
+    return out;
+  }
+};
+}  // namespace
+
+bool writeSyntheticEpub(const std::string& hostPath, const int chapters, const int paragraphsPerChapter) {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, hostPath.c_str(), 0)) {
+    return false;
+  }
+  auto add = [&](const char* name, const std::string& data, const mz_uint level) {
+    return mz_zip_writer_add_mem(&zip, name, data.data(), data.size(), level) != 0;
+  };
+  bool ok = add("mimetype", "application/epub+zip", MZ_NO_COMPRESSION);
+  ok = ok && add("META-INF/container.xml",
+                 "<?xml version=\"1.0\"?><container version=\"1.0\" "
+                 "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+                 "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles>"
+                 "</container>",
+                 MZ_DEFAULT_LEVEL);
+
+  // 600x800 so the cover converter scales it down to the panel: a frame and a dark title band on a gradient
+  const std::string cover = JpegWriter().encode(600, 800, [](const int x, const int y) -> uint8_t {
+    if (x < 24 || x >= 576 || y < 24 || y >= 776) {
+      return 235;
+    }
+    if (x < 32 || x >= 568 || y < 32 || y >= 768 || (y >= 160 && y < 300)) {
+      return 40;
+    }
+    return static_cast<uint8_t>(220 - y / 6);
+  });
+  ok = ok && add("OEBPS/cover.jpg", cover, MZ_NO_COMPRESSION);
+
+  std::string manifest, spine, navPoints;
+  Rng rng(42);
+  for (int c = 0; c < chapters && ok; c++) {
+    const std::string id = "ch" + std::to_string(c);
+    manifest += "<item id=\"" + id + "\" href=\"" + id + ".xhtml\" media-type=\"application/xhtml+xml\"/>";
+    spine += "<itemref idref=\"" + id + "\"/>";
+    navPoints += "<navPoint id=\"n" + id + "\" playOrder=\"" + std::to_string(c + 1) + "\"><navLabel><text>Chapter " +
+                 std::to_string(c + 1) + "</text></navLabel><content src=\"" + id + ".xhtml\"/></navPoint>";
+
+    std::string body = "<?xml version=\"1.0\" encoding=\"utf-8\"?><html xmlns=\"http://www.w3.org/1999/xhtml\"><head>"
+                       "<title>Chapter</title></head><body><h1>Chapter " +
+                       std::to_string(c + 1) + "</h1>";
+    for (int p = 0; p < paragraphsPerChapter; p++) {
+      body += "<p>" + paragraph(rng, 20 + static_cast<int>(rng.below(160)));
+      if (p % 5 == 0) {
+        body += " <i>" + paragraph(rng, 6) + "</i> <b>" + paragraph(rng, 3) + "</b>";
+      }
+      body += "</p>\n";
+    }
+    body += "</body></html>";
+    ok = add(("OEBPS/" + id + ".xhtml").c_str(), body, MZ_DEFAULT_LEVEL);
+  }
+
+  ok = ok && add("OEBPS/content.opf",
+                 "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\" "
+                 "unique-identifier=\"id\"><metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>Synthetic"
+                 "</dc:title><dc:creator>Benchmark</dc:creator><dc:language>en</dc:language><dc:identifier id=\"id\">"
+                 "bench</dc:identifier><meta name=\"cover\" content=\"cover\"/></metadata><manifest><item id=\"ncx\" "
+                 "href=\"toc.ncx\" media-type=\"application/x-dtbncx+xml\"/><item id=\"cover\" href=\"cover.jpg\" "
+                 "media-type=\"image/jpeg\"/>" +
+                     manifest + "</manifest><spine toc=\"ncx\">" + spine + "</spine></package>",
+                 MZ_DEFAULT_LEVEL);
+  ok = ok && add("OEBPS/toc.ncx",
+                 "<?xml version=\"1.0\"?><ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\" version=\"2005-1\">"
+                 "<navMap>" +
+                     navPoints + "</navMap></ncx>",
+                 MZ_DEFAULT_LEVEL);
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  mz_zip_writer_end(&zip);
+  return ok;
+}
+
+bool writeSyntheticTxt(const std::string& hostPath, const size_t size) {
+  std::ofstream out(hostPath, std::ios::binary);
+  Rng rng(7);
+  size_t written = 0;
+  while (out && written < size) {
+    // Mostly ordinary paragraphs with the odd very long one, which is where wrapping costs the most
+    const std::string text = paragraph(rng, rng.below(25) == 0 ? 300 : 10 + static_cast<int>(rng.below(120)));
+    out << text << "\r\n\r\n";
+    written += text.size() + 4;
+  }
+  return static_cast<bool>(out);
+}
+
+// Pages of dark word-shaped runs on text lines, with anti-aliased edges on 2-bit pages
+bool writeSyntheticXtc(const std::string& hostPath, const uint16_t pageCount, const uint8_t bitDepth,
+                       const bool packBits) {
+  constexpr uint16_t width = xtc::DISPLAY_WIDTH;
+  constexpr uint16_t height = xtc::DISPLAY_HEIGHT;
+  const size_t bitmapSize = bitDepth == 2 ? ((static_cast<size_t>(width) * height + 7) / 8) * 2
+                                          : ((width + 7) / 8) * static_cast<size_t>(height);
+
+  xtc::XtcHeader header = {};
+  header.magic = bitDepth == 2 ? xtc::XTCH_MAGIC : xtc::XTC_MAGIC;
+  header.versionMajor = 1;
+  header.pageCount = pageCount;
+  header.pageTableOffset = sizeof(xtc::XtcHeader);
+  header.dataOffset = header.pageTableOffset + sizeof(xtc::PageTableEntry) * pageCount;
+
+  // Pages are built first, compressed ones are only known in size once encoded
+  std::vector<std::vector<uint8_t>> pages(pageCount);
+  Rng rng(pageCount * 31 + bitDepth);
+  std::vector<uint8_t> levels(static_cast<size_t>(width) * height);
+  std::vector<uint8_t> bitmap(bitmapSize);
+  for (uint16_t i = 0; i < pageCount; i++) {
+    std::fill(levels.begin(), levels.end(), 0);
+    for (int lineTop = 40; lineTop + 24 < height - 40; lineTop += 32) {
+      for (int x = 30; x < width - 30;) {
+        const int wordWidth = 12 + static_cast<int>(rng.below(60));
+        for (int y = lineTop; y < lineTop + 22; y++) {
+          for (int wx = x; wx < std::min(x + wordWidth, width - 30); wx++) {
+            const bool edge = y == lineTop || y == lineTop + 21 || wx == x;
+            levels[static_cast<size_t>(y) * width + wx] = edge ? static_cast<uint8_t>(1 + rng.below(2)) : 3;
+          }
+        }
+        x += wordWidth + 8;
+      }
+    }
+
+    std::fill(bitmap.begin(), bitmap.end(), 0);
+    if (bitDepth == 2) {
+      // Column-major from the right, 8 vertical pixels per byte, plane 1 holds the high bit
+      const size_t planeSize = bitmapSize / 2;
+      const size_t colBytes = (height + 7) / 8;
+      for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+          const uint8_t level = levels[static_cast<size_t>(y) * width + x];
+          const size_t byteOffset = (width - 1 - x) * colBytes + y / 8;
+          const uint8_t bit = 1 << (7 - (y % 8));
+          if (level & 2) bitmap[byteOffset] |= bit;
+          if (level & 1) bitmap[planeSize + byteOffset] |= bit;
+        }
+      }
+    } else {
+      // Row-major, MSB first, 1 = white
+      const size_t rowBytes = (width + 7) / 8;
+      for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+          if (levels[static_cast<size_t>(y) * width + x] < 2) {
+            bitmap[y * rowBytes + x / 8] |= 1 << (7 - (x % 8));
+          }
+        }
+      }
+    }
+
+    xtc::XtgPageHeader pageHeader = {};
+    pageHeader.magic = bitDepth == 2 ? xtc::XTH_MAGIC : xtc::XTG_MAGIC;
+    pageHeader.width = width;
+    pageHeader.height = height;
+    std::vector<uint8_t>& page = pages[i];
+    page.resize(sizeof(pageHeader));
+    if (packBits) {
+      xtc::packBitsEncode(bitmap.data(), bitmap.size(), page);
+    }
+    // Like any writer, keep the page raw unless PackBits made it smaller
+    if (packBits && page.size() - sizeof(pageHeader) < bitmap.size()) {
+      pageHeader.compression = xtc::COMPRESSION_PACKBITS;
+    } else {
+      page.resize(sizeof(pageHeader));
+      page.insert(page.end(), bitmap.begin(), bitmap.end());
+    }
+    pageHeader.dataSize = page.size() - sizeof(pageHeader);
+    std::memcpy(page.data(), &pageHeader, sizeof(pageHeader));
+  }
+
+  std::ofstream out(hostPath, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t dataOffset = header.dataOffset;
+  for (const auto& page : pages) {
+    xtc::PageTableEntry entry = {};
+    entry.dataOffset = dataOffset;
+    entry.dataSize = page.size();
+    entry.width = width;
+    entry.height = height;
+    out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    dataOffset += page.size();
+  }
+  for (const auto& page : pages) {
+    out.write(reinterpret_cast<const char*>(page.data()), page.size());
+  }
+  return static_cast<bool>(out);
+}
+
+bool generateCorpus(const std::string& dir) {
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  return writeSyntheticEpub(dir + "/synthetic.epub", 12, 120) &&
+         writeSyntheticTxt(dir + "/synthetic.txt", 256 * 1024) &&
+         writeSyntheticXtc(dir + "/synthetic.xtc", 24, 1) && writeSyntheticXtc(dir + "/synthetic.xtch", 12, 2) &&
+         writeSyntheticXtc(dir + "/synthetic_packbits.xtc", 24, 1, true) &&
+         writeSyntheticXtc(dir + "/synthetic_packbits.xtch", 12, 2, true);
+}
+}  // namespace harness
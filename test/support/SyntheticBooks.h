@@ -0,0 +1,19 @@
+#pragma once
+// Deterministic books for the host tools: the same arguments always produce byte-identical files
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace harness {
+// Paths are host paths. EPUB chapters are deflated XHTML with some inline bold and italic, the cover a stored
+// baseline grayscale JPEG.
+bool writeSyntheticEpub(const std::string& hostPath, int chapters, int paragraphsPerChapter);
+// Mostly ordinary paragraphs with the odd long one, CRLF line endings
+bool writeSyntheticTxt(const std::string& hostPath, size_t size);
+// 480x800 pages of word-shaped runs, bitDepth 1 writes an XTC and 2 an XTCH with gray word edges. packBits stores the
+// pages PackBits compressed wherever that is smaller.
+bool writeSyntheticXtc(const std::string& hostPath, uint16_t pageCount, uint8_t bitDepth, bool packBits = false);
+// synthetic.epub, synthetic.txt, synthetic.xtc and synthetic.xtch in dir, plus PackBits compressed copies of the last
+// two (synthetic_packbits.xtc/.xtch). dir is created if needed.
+bool generateCorpus(const std::string& dir);
+}  // namespace harness
@@ -0,0 +1,136 @@
+// Fills a whole-book layout index (layout.bin, see BookLayoutIndex.h) the way the look-ahead pass does, checks the
+// global page lookups both ways, and that counts reach the file in batches and survive a reload.
+//
+//   BookLayoutIndexTest --dir <scratch dir>
+#include <Epub/BookLayoutIndex.h>
+#include <SDCardManager.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+#define CHECK(condition)                                                            \
+  do {                                                                              \
+    if (!(condition)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                                   \
+    }                                                                               \
+  } while (0)
+
+const std::string CACHE_PATH = "/cache";
+// Two empty spine items, one at the start and one in the middle, more items than one save batch
+const std::vector<uint16_t> PAGE_COUNTS = {0, 12, 3, 40, 0, 7, 1, 25, 9, 18, 2};
+
+bool begin(BookLayoutIndex& index, const int fontId = 1) {
+  return index.begin(fontId, 1.0f, false, 0, 480, 800, true, static_cast<int>(PAGE_COUNTS.size()));
+}
+
+// What a reader opening the book afterwards would find on the card
+int missingOnDisk() {
+  BookLayoutIndex reloaded(CACHE_PATH);
+  if (!begin(reloaded)) {
+    return -1;
+  }
+  int missing = 0;
+  for (int i = reloaded.nextMissingSpineIndex(); i >= 0; i = reloaded.nextMissingSpineIndex(i + 1)) {
+    missing++;
+  }
+  return missing;
+}
+
+void testBatchedSaves() {
+  SdMan.remove((CACHE_PATH + "/layout.bin").c_str());
+  BookLayoutIndex index(CACHE_PATH);
+  CHECK(begin(index));
+  CHECK(!index.isComplete());
+  CHECK(index.nextMissingSpineIndex() == 0);
+
+  const int total = static_cast<int>(PAGE_COUNTS.size());
+  for (int i = 0; i < BookLayoutIndex::SAVE_INTERVAL - 1; i++) {
+    CHECK(index.setSectionPageCount(i, PAGE_COUNTS[i]));
+  }
+  // Nothing written before the first batch is full
+  CHECK(!SdMan.exists((CACHE_PATH + "/layout.bin").c_str()));
+  CHECK(index.setSectionPageCount(BookLayoutIndex::SAVE_INTERVAL - 1, PAGE_COUNTS[BookLayoutIndex::SAVE_INTERVAL - 1]));
+  CHECK(missingOnDisk() == total - BookLayoutIndex::SAVE_INTERVAL);
+
+  // A count that doesn't change is not a new one
+  CHECK(index.setSectionPageCount(0, PAGE_COUNTS[0]));
+  CHECK(index.nextMissingSpineIndex() == BookLayoutIndex::SAVE_INTERVAL);
+  CHECK(index.nextMissingSpineIndex(total) == -1);
+
+  CHECK(index.setSectionPageCount(BookLayoutIndex::SAVE_INTERVAL, PAGE_COUNTS[BookLayoutIndex::SAVE_INTERVAL]));
+  CHECK(missingOnDisk() == total - BookLayoutIndex::SAVE_INTERVAL);
+  CHECK(index.flush());
+  CHECK(missingOnDisk() == total - BookLayoutIndex::SAVE_INTERVAL - 1);
+
+  // The last count completes the index and saves it straight away
+  for (int i = BookLayoutIndex::SAVE_INTERVAL + 1; i < total; i++) {
+    CHECK(index.setSectionPageCount(i, PAGE_COUNTS[i]));
+  }
+  CHECK(index.isComplete());
+  CHECK(missingOnDisk() == 0);
+}
+
+void testPageLookups() {
+  BookLayoutIndex index(CACHE_PATH);
+  CHECK(begin(index));
+  CHECK(index.isComplete());
+
+  uint32_t total = 0;
+  for (const uint16_t count : PAGE_COUNTS) {
+    total += count;
+  }
+  CHECK(index.getTotalPages() == total);
+
+  // Every global page maps back to the spine item and page it came from, never to an empty item
+  uint32_t globalPage = 0;
+  for (size_t spineIndex = 0; spineIndex < PAGE_COUNTS.size(); spineIndex++) {
+    for (int page = 0; page < PAGE_COUNTS[spineIndex]; page++, globalPage++) {
+      CHECK(index.getGlobalPage(static_cast<int>(spineIndex), page) == globalPage);
+      int foundSpineIndex = -1;
+      int foundPage = -1;
+      if (!index.findSection(globalPage, &foundSpineIndex, &foundPage) ||
+          foundSpineIndex != static_cast<int>(spineIndex) || foundPage != page) {
+        fprintf(stderr, "global page %u found at %d/%d, expected %zu/%d\n", globalPage, foundSpineIndex, foundPage,
+                spineIndex, page);
+        failures++;
+      }
+    }
+  }
+  int spineIndex;
+  int page;
+  CHECK(!index.findSection(total, &spineIndex, &page));
+
+  // Another layout starts over and has nothing to look up
+  CHECK(begin(index, 2));
+  CHECK(!index.isComplete());
+  CHECK(!index.findSection(0, &spineIndex, &page));
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  if (argc != 3 || std::string(argv[1]) != "--dir") {
+    fprintf(stderr, "Usage: %s --dir <scratch dir>\n", argv[0]);
+    return 2;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(argv[2], ec);
+  SdFat::setRoot(argv[2]);
+  SdMan.begin();
+  SdMan.mkdir(CACHE_PATH.c_str());
+
+  testBatchedSaves();
+  testPageLookups();
+
+  if (failures > 0) {
+    fprintf(stderr, "%d layout index checks failed\n", failures);
+    return 1;
+  }
+  printf("Layout index OK (%zu spine items)\n", PAGE_COUNTS.size());
+  return 0;
+}
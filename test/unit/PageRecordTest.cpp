@@ -0,0 +1,119 @@
+// Round-trips EPUB page records (see Page.h) through a file and checks that every truncated or padded copy of a record
+// is rejected rather than partly loaded.
+//
+//   PageRecordTest --dir <scratch dir>
+#include <Epub/Page.h>
+#include <SDCardManager.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+#define CHECK(condition)                                                            \
+  do {                                                                              \
+    if (!(condition)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                                   \
+    }                                                                               \
+  } while (0)
+
+Page makePage() {
+  Page page;
+  const std::string words = std::string("Lorem") + '\0' + "ipsum" + '\0' + "dolor" + '\0';
+  const std::vector<uint16_t> xpos = {0, 64, 140};
+  const std::vector<EpdFontFamily::Style> styles = {EpdFontFamily::REGULAR, EpdFontFamily::BOLD,
+                                                    EpdFontFamily::ITALIC};
+  page.elements.push_back(std::make_shared<PageLine>(
+      std::make_shared<TextBlock>(words, xpos, styles, TextBlock::JUSTIFIED), 12, 40));
+  page.elements.push_back(std::make_shared<PageImage>("/.cache/img_3.bmp", 20, 80, 300, 200));
+  page.elements.push_back(std::make_shared<PageLine>(
+      std::make_shared<TextBlock>(std::string("end") + '\0', std::vector<uint16_t>{8},
+                                  std::vector<EpdFontFamily::Style>{EpdFontFamily::REGULAR}, TextBlock::LEFT_ALIGN),
+      12, 300));
+  return page;
+}
+
+std::vector<uint8_t> serialize(const Page& page) {
+  FsFile file;
+  if (!SdMan.openFileForWrite("TST", "/page.bin", file)) {
+    return {};
+  }
+  page.serialize(file);
+  file.close();
+  std::ifstream in(SdFat::hostPath("/page.bin"), std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+std::unique_ptr<Page> deserialize(const std::vector<uint8_t>& bytes, const size_t size) {
+  {
+    std::ofstream out(SdFat::hostPath("/page.bin"), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  }
+  FsFile file;
+  if (!SdMan.openFileForRead("TST", "/page.bin", file)) {
+    return nullptr;
+  }
+  auto page = Page::deserialize(file, size);
+  file.close();
+  return page;
+}
+
+void testRoundTrip(const std::vector<uint8_t>& record) {
+  CHECK(!record.empty());
+  const auto page = deserialize(record, record.size());
+  CHECK(page != nullptr);
+  if (!page) {
+    return;
+  }
+  CHECK(page->elements.size() == 3);
+  CHECK(page->elements[0]->tag() == TAG_PageLine && page->elements[0]->xPos == 12 && page->elements[0]->yPos == 40);
+  CHECK(page->elements[1]->tag() == TAG_PageImage && page->elements[1]->xPos == 20 && page->elements[1]->yPos == 80);
+  CHECK(page->hasImages());
+  // Lines are views into the loaded buffer, writing them back must give the same bytes
+  CHECK(serialize(*page) == record);
+}
+
+void testTruncated(const std::vector<uint8_t>& record) {
+  for (size_t size = 0; size < record.size(); size++) {
+    const std::vector<uint8_t> truncated(record.begin(), record.begin() + size);
+    if (deserialize(truncated, size)) {
+      fprintf(stderr, "record cut to %zu of %zu bytes was accepted\n", size, record.size());
+      failures++;
+    }
+  }
+}
+
+void testTrailing(std::vector<uint8_t> record) {
+  record.push_back(0);
+  CHECK(deserialize(record, record.size()) == nullptr);
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  if (argc != 3 || std::string(argv[1]) != "--dir") {
+    fprintf(stderr, "Usage: %s --dir <scratch dir>\n", argv[0]);
+    return 2;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(argv[2], ec);
+  SdFat::setRoot(argv[2]);
+  SdMan.begin();
+
+  const std::vector<uint8_t> record = serialize(makePage());
+  testRoundTrip(record);
+  testTruncated(record);
+  testTrailing(record);
+
+  if (failures > 0) {
+    fprintf(stderr, "%d page record checks failed\n", failures);
+    return 1;
+  }
+  printf("Page records OK (%zu bytes)\n", record.size());
+  return 0;
+}
@@ -0,0 +1,146 @@
+// Builds the central directory index (zip.idx, see ZipFile::ensureIndex) for a zip with more entries than one sort run,
+// reads entries through it, and checks that a different zip of the same size, or a damaged index, gets a fresh index.
+//
+//   ZipIndexTest --dir <scratch dir>
+#include <SDCardManager.h>
+#include <ZipFile.h>
+#include <ZipSession.h>
+#include <miniz.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+namespace {
+int failures = 0;
+
+#define CHECK(condition)                                                            \
+  do {                                                                              \
+    if (!(condition)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                                   \
+    }                                                                               \
+  } while (0)
+
+// More than the 1024 entries sorted in RAM at a time, so the index is merged from several runs
+constexpr int ENTRY_COUNT = 2500;
+const std::string ZIP_PATH = "/book.zip";
+const std::string INDEX_PATH = "/zip.idx";
+
+std::string entryName(const int i) {
+  char name[40];
+  snprintf(name, sizeof(name), "OEBPS/text/entry%04d.xhtml", i);
+  return name;
+}
+
+std::string entryContent(const int i) {
+  std::string content;
+  for (int repeat = 0; repeat <= i % 7; repeat++) {
+    content += "<p>entry " + std::to_string(i) + "</p>";
+  }
+  return content;
+}
+
+// Every other entry deflated. reversed writes the same entries back to front: the zip keeps its size and central
+// directory offset, but every local header moves.
+bool writeZip(const bool reversed, const std::filesystem::file_time_type modified) {
+  const std::string hostPath = SdFat::hostPath(ZIP_PATH.c_str());
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, hostPath.c_str(), 0)) {
+    return false;
+  }
+  bool ok = true;
+  for (int n = 0; n < ENTRY_COUNT && ok; n++) {
+    const int i = reversed ? ENTRY_COUNT - 1 - n : n;
+    const std::string content = entryContent(i);
+    ok = mz_zip_writer_add_mem(&zip, entryName(i).c_str(), content.data(), content.size(),
+                               i % 2 ? MZ_DEFAULT_LEVEL : MZ_NO_COMPRESSION) != 0;
+  }
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  mz_zip_writer_end(&zip);
+  std::error_code ec;
+  std::filesystem::last_write_time(hostPath, modified, ec);
+  return ok && !ec;
+}
+
+void checkEntries(const char* label) {
+  ZipSession session(ZIP_PATH, &INDEX_PATH);
+  for (const int i : {0, 1, 1023, 1024, 1025, 2047, 2048, ENTRY_COUNT - 1}) {
+    const std::string expected = entryContent(i);
+    size_t size = 0;
+    uint8_t* data = session.readFileToMemory(entryName(i).c_str(), &size);
+    if (!data || size != expected.size() || expected.compare(0, size, reinterpret_cast<char*>(data), size) != 0) {
+      fprintf(stderr, "%s: %s read wrong\n", label, entryName(i).c_str());
+      failures++;
+    }
+    free(data);
+  }
+  size_t size = 0;
+  CHECK(session.getInflatedFileSize(entryName(ENTRY_COUNT / 2).c_str(), &size) &&
+        size == entryContent(ENTRY_COUNT / 2).size());
+  CHECK(!session.getInflatedFileSize("OEBPS/text/missing.xhtml", &size));
+}
+
+std::filesystem::file_time_type indexWriteTime() {
+  std::error_code ec;
+  return std::filesystem::last_write_time(SdFat::hostPath(INDEX_PATH.c_str()), ec);
+}
+
+void testBuildAndLookup(const std::filesystem::file_time_type modified) {
+  CHECK(writeZip(false, modified));
+  SdMan.remove(INDEX_PATH.c_str());
+  CHECK(ZipFile(ZIP_PATH).ensureIndex(INDEX_PATH));
+  CHECK(SdMan.exists(INDEX_PATH.c_str()));
+  checkEntries("fresh index");
+
+  // A matching index is reused as is
+  const auto builtAt = indexWriteTime();
+  std::filesystem::last_write_time(SdFat::hostPath(INDEX_PATH.c_str()), builtAt - std::chrono::hours(1));
+  CHECK(ZipFile(ZIP_PATH).ensureIndex(INDEX_PATH));
+  CHECK(indexWriteTime() == builtAt - std::chrono::hours(1));
+}
+
+void testSameSizeZip(const std::filesystem::file_time_type modified) {
+  const uint64_t sizeBefore = std::filesystem::file_size(SdFat::hostPath(ZIP_PATH.c_str()));
+  CHECK(writeZip(true, modified));
+  CHECK(std::filesystem::file_size(SdFat::hostPath(ZIP_PATH.c_str())) == sizeBefore);
+  CHECK(ZipFile(ZIP_PATH).ensureIndex(INDEX_PATH));
+  // Offsets from the old index would point at the wrong local headers
+  checkEntries("same size zip");
+}
+
+void testDamagedIndex() {
+  const std::string hostPath = SdFat::hostPath(INDEX_PATH.c_str());
+  const uint64_t size = std::filesystem::file_size(hostPath);
+  std::filesystem::resize_file(hostPath, size - 1);
+  CHECK(ZipFile(ZIP_PATH).ensureIndex(INDEX_PATH));
+  CHECK(std::filesystem::file_size(hostPath) == size);
+  checkEntries("rebuilt index");
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  if (argc != 3 || std::string(argv[1]) != "--dir") {
+    fprintf(stderr, "Usage: %s --dir <scratch dir>\n", argv[0]);
+    return 2;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(argv[2], ec);
+  SdFat::setRoot(argv[2]);
+  SdMan.begin();
+
+  // Whole minutes apart, well clear of the 2 second FAT time resolution
+  const auto now = std::filesystem::file_time_type::clock::now();
+  testBuildAndLookup(now - std::chrono::minutes(10));
+  testSameSizeZip(now - std::chrono::minutes(5));
+  testDamagedIndex();
+
+  if (failures > 0) {
+    fprintf(stderr, "%d zip index checks failed\n", failures);
+    return 1;
+  }
+  printf("Zip index OK (%d entries)\n", ENTRY_COUNT);
+  return 0;
+}